@@ -0,0 +1,241 @@
+#include "AssetPack.hpp"
+#include "data_path.hpp"
+#include "Load.hpp"
+
+#include <zlib.h>
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+std::unique_ptr< MappedFile > MappedFile::open(std::string const &filename) {
+	std::unique_ptr< MappedFile > ret(new MappedFile);
+	#if defined(_WIN32)
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return nullptr;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	if (file_size.QuadPart == 0) { //(can't map an empty file)
+		CloseHandle(file);
+		return ret;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping) throw std::runtime_error("Failed to map '" + filename + "'.");
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping); //(view keeps the mapping alive)
+	if (!view) throw std::runtime_error("Failed to map '" + filename + "'.");
+	ret->data = reinterpret_cast< char const * >(view);
+	ret->size = size_t(file_size.QuadPart);
+	#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return nullptr;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	if (st.st_size == 0) { //(can't map an empty file)
+		close(fd);
+		return ret;
+	}
+	void *view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //(mapping keeps the file alive)
+	if (view == MAP_FAILED) throw std::runtime_error("Failed to map '" + filename + "'.");
+	//ask for the whole file to be read ahead now, as one big sequential read:
+	posix_madvise(view, size_t(st.st_size), POSIX_MADV_WILLNEED);
+	ret->data = reinterpret_cast< char const * >(view);
+	ret->size = size_t(st.st_size);
+	#endif
+	return ret;
+}
+
+MappedFile::~MappedFile() {
+	if (!data) return;
+	#if defined(_WIN32)
+	UnmapViewOfFile(data);
+	#else
+	munmap(const_cast< char * >(data), size);
+	#endif
+}
+
+namespace {
+	//The mapped pack file (if there is one):
+	struct AssetPack {
+		std::unique_ptr< MappedFile > file;
+		char const *data = nullptr;
+		size_t size = 0;
+		std::string root; //data_path("") -- asset names are relative to this
+
+		AssetPackHeader header;
+		AssetPackEntry const *entries = nullptr;
+		uint32_t const *buckets = nullptr;
+		char const *names = nullptr;
+
+		//map 'filename'; returns false (and leaves the pack empty) if there is no such file:
+		bool map(std::string const &filename) {
+			file = MappedFile::open(filename);
+			if (!file) return false;
+			data = file->data;
+			size = file->size;
+			return true;
+		}
+
+		//check that the index makes sense (so lookups can trust it):
+		void validate(std::string const &filename) {
+			auto fail = [&filename](std::string const &why) {
+				throw std::runtime_error("Asset pack '" + filename + "' is corrupt: " + why);
+			};
+			auto in_file = [this](uint64_t offset, uint64_t bytes) {
+				return offset <= size && bytes <= size - offset;
+			};
+
+			if (size < sizeof(AssetPackHeader)) fail("too small for a header");
+			std::memcpy(&header, data, sizeof(header));
+			if (std::memcmp(header.magic, AssetPackHeader().magic, 4) != 0) fail("bad magic");
+			if (header.version != AssetPackVersion) fail("version " + std::to_string(header.version) + " (expecting " + std::to_string(AssetPackVersion) + ")");
+			if (header.bucket_count == 0 || (header.bucket_count & (header.bucket_count - 1)) != 0) fail("bucket count isn't a power of two");
+			if (header.bucket_count <= header.entry_count) fail("not enough buckets");
+			if (!in_file(header.entries_offset, uint64_t(header.entry_count) * sizeof(AssetPackEntry))
+			 || !in_file(header.buckets_offset, uint64_t(header.bucket_count) * sizeof(uint32_t))
+			 || !in_file(header.names_offset, header.names_size)) fail("index is out of range");
+			if (header.entries_offset % alignof(AssetPackEntry) != 0 || header.buckets_offset % alignof(uint32_t) != 0) fail("index is misaligned");
+
+			entries = reinterpret_cast< AssetPackEntry const * >(data + header.entries_offset);
+			buckets = reinterpret_cast< uint32_t const * >(data + header.buckets_offset);
+			names = data + header.names_offset;
+
+			for (uint32_t i = 0; i < header.entry_count; ++i) {
+				AssetPackEntry const &entry = entries[i];
+				if (!in_file(entry.offset, entry.stored_size)) fail("entry " + std::to_string(i) + " is out of range");
+				if (entry.name_begin > entry.name_end || entry.name_end > header.names_size) fail("entry " + std::to_string(i) + " has a bad name");
+				if (!(entry.flags & AssetPackDeflate) && entry.stored_size != entry.size) fail("entry " + std::to_string(i) + " has mismatched sizes");
+			}
+			for (uint32_t b = 0; b < header.bucket_count; ++b) {
+				if (buckets[b] != AssetPackEmptyBucket && buckets[b] >= header.entry_count) fail("bucket " + std::to_string(b) + " is out of range");
+			}
+		}
+
+		AssetPackEntry const *find(std::string const &name) const {
+			if (!entries) return nullptr;
+			uint64_t hash = asset_pack_hash(name.data(), name.data() + name.size());
+			uint32_t mask = header.bucket_count - 1;
+			for (uint32_t b = uint32_t(hash) & mask; buckets[b] != AssetPackEmptyBucket; b = (b + 1) & mask) {
+				AssetPackEntry const &entry = entries[buckets[b]];
+				if (entry.hash == hash
+				 && entry.name_end - entry.name_begin == name.size()
+				 && std::memcmp(names + entry.name_begin, name.data(), name.size()) == 0) {
+					return &entry;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	AssetPack const &get_pack() {
+		//n.b. never freed, so views into the mapping stay valid through static destruction:
+		static AssetPack *pack = [](){
+			AssetPack *ret = new AssetPack;
+			ret->root = data_path("");
+			std::string filename = data_path("data.pack");
+			try {
+				if (ret->map(filename)) {
+					ret->validate(filename);
+				}
+			} catch (std::exception &e) {
+				std::cerr << "WARNING: " << e.what() << " Reading loose files instead." << std::endl;
+				ret->entries = nullptr;
+			}
+			return ret;
+		}();
+		return *pack;
+	}
+}
+
+bool asset_pack_loaded() {
+	return get_pack().entries != nullptr;
+}
+
+AssetView asset_view(std::string const &path) {
+	AssetPack const &pack = get_pack();
+
+	//packed? (names are relative to the executable's directory)
+	if (path.compare(0, pack.root.size(), pack.root) == 0) {
+		if (AssetPackEntry const *entry = pack.find(path.substr(pack.root.size()))) {
+			AssetView view;
+			view.from_pack = true;
+			load_report_bytes_read(size_t(entry->stored_size));
+			if (entry->flags & AssetPackDeflate) {
+				view.storage = std::make_shared< std::vector< char > >(size_t(entry->size));
+				uLongf size = uLongf(entry->size);
+				int err = uncompress(reinterpret_cast< Bytef * >(view.storage->data()), &size,
+					reinterpret_cast< Bytef const * >(pack.data + entry->offset), uLong(entry->stored_size));
+				if (err != Z_OK || size != entry->size) {
+					throw std::runtime_error("Failed to decompress '" + path + "' from asset pack (zlib error " + std::to_string(err) + ").");
+				}
+				view.data = view.storage->data();
+			} else {
+				view.data = pack.data + entry->offset;
+			}
+			view.size = size_t(entry->size);
+			return view;
+		}
+	}
+
+	//loose file:
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + path + "'" + (pack.entries ? " (not in asset pack, either)." : "."));
+	}
+	file.seekg(0, std::ios::end);
+	std::streamoff size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	AssetView view;
+	view.storage = std::make_shared< std::vector< char > >(size_t(size));
+	if (!file.read(view.storage->data(), size)) {
+		throw std::runtime_error("Failed to read '" + path + "'.");
+	}
+	load_report_bytes_read(size_t(size));
+	view.data = view.storage->data();
+	view.size = view.storage->size();
+	return view;
+}
+
+AssetStreamBuf::AssetStreamBuf(AssetView const &view_) : view(view_) {
+	//(streambuf wants non-const pointers, but never writes through get-area pointers)
+	char *begin = const_cast< char * >(view.data);
+	setg(begin, begin, begin + view.size);
+}
+
+AssetStreamBuf::pos_type AssetStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+	if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+	off_type base = 0;
+	if (dir == std::ios_base::cur) base = gptr() - eback();
+	else if (dir == std::ios_base::end) base = egptr() - eback();
+	return seekpos(pos_type(base + off), which);
+}
+
+AssetStreamBuf::pos_type AssetStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+	off_type at = off_type(pos);
+	if (!(which & std::ios_base::in) || at < 0 || at > egptr() - eback()) return pos_type(off_type(-1));
+	setg(eback(), eback() + at, egptr());
+	return pos;
+}
+
+AssetStream::AssetStream(std::string const &path) : std::istream(nullptr), buf(new AssetStreamBuf(asset_view(path))) {
+	rdbuf(buf.get());
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+/*
+ * Asset packs bundle everything under dist/data/ into one file (dist/data.pack)
+ * that is memory-mapped once at startup, so reading an asset is a hash lookup
+ * instead of a path lookup + open + a pile of small reads.
+ *
+ * Packs are built offline by the 'pack-assets' tool:
+ *   ./pack-assets dist/data.pack dist data
+ *
+ * At runtime, read assets by the same path you would have opened:
+ *
+ * AssetView view = asset_view(data_path("data/scene1.png"));
+ * //view.data, view.size are the file's bytes (straight out of the mapping if stored uncompressed)
+ *
+ * AssetStream file(data_path("data/emptyscene.scene")); //drop-in for std::ifstream
+ *
+ * Paths that aren't in the pack (or all paths, if there is no pack) are read
+ * from loose files as before, so the pack only needs rebuilding for shipping.
+ *
+ */
+
+#include <streambuf>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//----- file format -----
+// (all values little-endian)
+// header | entry data (each entry starts at a multiple of AssetPackAlign) | entries | buckets | names
+
+constexpr uint32_t AssetPackVersion = 1;
+constexpr uint64_t AssetPackAlign = 64;
+
+struct AssetPackHeader {
+	char magic[4] = {'a','p','a','k'};
+	uint32_t version = AssetPackVersion;
+	uint32_t entry_count = 0;
+	uint32_t bucket_count = 0; //power of two; open addressing with linear probing
+	uint64_t entries_offset = 0; //AssetPackEntry[entry_count]
+	uint64_t buckets_offset = 0; //uint32_t[bucket_count], entry index or AssetPackEmptyBucket
+	uint64_t names_offset = 0; //char[], referred to by AssetPackEntry::name_*
+	uint64_t names_size = 0;
+};
+static_assert(sizeof(AssetPackHeader) == 4 + 4 + 4 + 4 + 8 * 4, "AssetPackHeader is packed.");
+
+enum AssetPackFlags : uint32_t {
+	AssetPackDeflate = 1, //entry is zlib-compressed
+};
+
+struct AssetPackEntry {
+	uint64_t hash = 0; //asset_pack_hash() of name
+	uint64_t offset = 0; //from start of file
+	uint64_t stored_size = 0; //bytes in file
+	uint64_t size = 0; //bytes once decompressed
+	uint32_t name_begin = 0;
+	uint32_t name_end = 0;
+	uint32_t flags = 0;
+	uint32_t padding = 0;
+};
+static_assert(sizeof(AssetPackEntry) == 8 * 4 + 4 * 4, "AssetPackEntry is packed.");
+
+constexpr uint32_t AssetPackEmptyBucket = 0xffffffff;
+
+//64-bit FNV-1a of an asset name (e.g. "data/scene1.png"):
+inline uint64_t asset_pack_hash(char const *begin, char const *end) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (char const *c = begin; c != end; ++c) {
+		hash = (hash ^ uint64_t(uint8_t(*c))) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+//----- runtime -----
+
+//Read-only memory mapping of an entire file:
+struct MappedFile {
+	//returns nullptr if there is no such file; throws if it exists but can't be mapped:
+	static std::unique_ptr< MappedFile > open(std::string const &filename);
+	~MappedFile();
+	MappedFile(MappedFile const &) = delete;
+
+	char const *data = nullptr;
+	size_t size = 0;
+private:
+	MappedFile() = default;
+};
+
+//Bytes of an asset; valid for as long as the view (or a copy of it) is alive:
+struct AssetView {
+	char const *data = nullptr;
+	size_t size = 0;
+	bool from_pack = false; //if false, came from a loose file
+	std::shared_ptr< std::vector< char > > storage; //owns 'data' when it isn't part of the mapped pack
+};
+
+//Read an asset by path (usually the result of data_path()):
+// (throws if it can't be found in the pack or on disk)
+AssetView asset_view(std::string const &path);
+
+//Is there a pack mapped? (the pack is opened on first use of asset_view())
+bool asset_pack_loaded();
+
+//std::istream over an AssetView (for code written against std::ifstream):
+struct AssetStreamBuf : std::streambuf {
+	explicit AssetStreamBuf(AssetView const &view);
+	AssetView view;
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
+struct AssetStream : std::istream {
+	//opens the asset; throws (like asset_view()) if it can't be found:
+	explicit AssetStream(std::string const &path);
+	std::unique_ptr< AssetStreamBuf > buf;
+};
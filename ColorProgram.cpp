@@ -3,7 +3,8 @@
 #include "gl_compile_program.hpp"
 #include "gl_errors.hpp"
 
-Load< ColorProgram > color_program(LoadTagEarly);
+//only DrawLines uses this, so it is compiled the first time something is drawn:
+Load< ColorProgram > color_program(LoadTagEarly, LoadInfo("ColorProgram", {}, LoadLazy), nullptr, new_T< ColorProgram >);
 
 ColorProgram::ColorProgram() {
 	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
@@ -1,23 +1,30 @@
 #include "DrawLines.hpp"
 #include "PathFont.hpp"
 #include "ColorProgram.hpp"
+#include "PathFontProgram.hpp"
+#include "WireBoxProgram.hpp"
+#include "WideLineProgram.hpp"
+#include "StreamRing.hpp"
 
 #include "gl_errors.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
-//All DrawLines instances share a vertex array object and vertex buffer, initialized at load time:
+#include <cstring>
+#include <iterator>
+
+//All DrawLines instances share a vertex array object and a streaming vertex buffer, initialized (lazily) the first time lines are drawn:
+// (each frame's lines -- and glyph instances -- are written into the next region of the stream buffer in one go by DrawLines::submit_frame())
 
 //n.b. declared static so they don't conflict with similarly named global variables elsewhere:
-static GLuint vertex_buffer = 0;
+static StreamRing *stream = nullptr; //(never freed, like Load<>'d values)
 static GLuint vertex_buffer_for_color_program = 0;
 
-static Load< void > setup_buffers(LoadTagDefault, [](){
+static Load< void > setup_buffers(LoadTagDefault, LoadInfo("DrawLines buffers", {&color_program}, LoadLazy), nullptr, [](){
 	//you may recognize this init code from DrawSprites.cpp:
 
 	{ //set up vertex buffer:
-		glGenBuffers(1, &vertex_buffer);
-		//for now, buffer will be un-filled.
+		stream = new StreamRing(256 * 1024); //(grows if a frame needs more)
 	}
 
 	{ //vertex array mapping buffer for color_program:
@@ -27,8 +34,10 @@ static Load< void > setup_buffers(LoadTagDefault, [](){
 		//set vertex_buffer_for_color_program as the current vertex array object:
 		glBindVertexArray(vertex_buffer_for_color_program);
 
-		//set vertex_buffer as the source of glVertexAttribPointer() commands:
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+		//set the stream buffer as the source of glVertexAttribPointer() commands:
+		// (each frame's vertices start at a multiple of sizeof(DrawLines::Vertex), so draws just pick their 'first' vertex)
+		static_assert(StreamRing::Alignment % sizeof(DrawLines::Vertex) == 0, "Stream offsets land on vertex boundaries.");
+		glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
 
 		//set up the vertex array object to describe arrays of PongMode::Vertex:
 		glVertexAttribPointer(
@@ -62,6 +71,153 @@ static Load< void > setup_buffers(LoadTagDefault, [](){
 	GL_ERRORS(); //PARANOIA: make sure nothing strange happened during setup
 });
 
+//Text is drawn as instances of glyph geometry that is uploaded once:
+static GLuint glyph_buffer = 0; //every glyph's line segments (then the "missing glyph" box)
+static std::vector< GLint > glyph_firsts; //glyph i is vertices glyph_firsts[i] .. glyph_firsts[i+1]-1 of glyph_buffer
+static GLuint glyph_buffer_for_path_font_program = 0;
+
+//"missing glyph" box, as line segments:
+static const glm::vec2 missing_glyph[] = {
+	glm::vec2(0.1f, 0.1f), glm::vec2(0.6f, 0.1f),
+	glm::vec2(0.6f, 0.1f), glm::vec2(0.6f, 0.9f),
+	glm::vec2(0.9f, 0.6f), glm::vec2(0.1f, 0.9f),
+	glm::vec2(0.1f, 0.9f), glm::vec2(0.1f, 0.1f)
+};
+static const float missing_glyph_width = 0.6f;
+
+static Load< void > setup_glyph_buffers(LoadTagDefault, LoadInfo("DrawLines glyphs", {&path_font_program}, LoadLazy), nullptr, [](){
+	PathFont const &font = PathFont::font;
+
+	{ //upload all the glyphs' line segments:
+		std::vector< glm::vec2 > coords;
+		coords.reserve(font.glyph_coord_starts[font.glyphs] / 2 + sizeof(missing_glyph) / sizeof(missing_glyph[0]));
+		glyph_firsts.clear();
+		for (uint32_t glyph = 0; glyph < font.glyphs; ++glyph) {
+			glyph_firsts.emplace_back(GLint(coords.size()));
+			for (uint32_t c = font.glyph_coord_starts[glyph]; c + 1 < font.glyph_coord_starts[glyph+1]; c += 2) {
+				coords.emplace_back(font.coords[c], font.coords[c+1]);
+			}
+		}
+		glyph_firsts.emplace_back(GLint(coords.size()));
+		coords.insert(coords.end(), std::begin(missing_glyph), std::end(missing_glyph));
+		glyph_firsts.emplace_back(GLint(coords.size()));
+
+		glGenBuffers(1, &glyph_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, glyph_buffer);
+		glBufferData(GL_ARRAY_BUFFER, coords.size() * sizeof(coords[0]), coords.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	{ //vertex array for path_font_program:
+		glGenVertexArrays(1, &glyph_buffer_for_path_font_program);
+		glBindVertexArray(glyph_buffer_for_path_font_program);
+
+		glBindBuffer(GL_ARRAY_BUFFER, glyph_buffer);
+		glVertexAttribPointer(
+			path_font_program->Position_vec2, //attribute
+			2, //size
+			GL_FLOAT, //type
+			GL_FALSE, //normalized
+			sizeof(glm::vec2), //stride
+			(GLbyte *)0 //offset
+		);
+		glEnableVertexAttribArray(path_font_program->Position_vec2);
+
+		//per-instance attributes advance once per glyph drawn, not once per vertex:
+		// (they come from the stream buffer, and are pointed at each glyph's instances when drawing)
+		for (GLuint attrib : {path_font_program->Anchor_vec3, path_font_program->X_vec3, path_font_program->Y_vec3, path_font_program->Color_vec4}) {
+			glEnableVertexAttribArray(attrib);
+			glVertexAttribDivisor(attrib, 1);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	GL_ERRORS();
+});
+
+//Boxes are drawn as instances of the [-1,1]^3 cube's edges:
+static GLuint box_buffer = 0;
+static GLuint box_buffer_for_wire_box_program = 0;
+
+static const glm::vec3 box_edges[] = {
+	//x-direction edges:
+	glm::vec3(-1.0f,-1.0f,-1.0f), glm::vec3( 1.0f,-1.0f,-1.0f),
+	glm::vec3(-1.0f, 1.0f,-1.0f), glm::vec3( 1.0f, 1.0f,-1.0f),
+	glm::vec3(-1.0f,-1.0f, 1.0f), glm::vec3( 1.0f,-1.0f, 1.0f),
+	glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3( 1.0f, 1.0f, 1.0f),
+	//y-direction edges:
+	glm::vec3(-1.0f,-1.0f,-1.0f), glm::vec3(-1.0f, 1.0f,-1.0f),
+	glm::vec3( 1.0f,-1.0f,-1.0f), glm::vec3( 1.0f, 1.0f,-1.0f),
+	glm::vec3(-1.0f,-1.0f, 1.0f), glm::vec3(-1.0f, 1.0f, 1.0f),
+	glm::vec3( 1.0f,-1.0f, 1.0f), glm::vec3( 1.0f, 1.0f, 1.0f),
+	//z-direction edges:
+	glm::vec3(-1.0f,-1.0f,-1.0f), glm::vec3(-1.0f,-1.0f, 1.0f),
+	glm::vec3( 1.0f,-1.0f,-1.0f), glm::vec3( 1.0f,-1.0f, 1.0f),
+	glm::vec3(-1.0f, 1.0f,-1.0f), glm::vec3(-1.0f, 1.0f, 1.0f),
+	glm::vec3( 1.0f, 1.0f,-1.0f), glm::vec3( 1.0f, 1.0f, 1.0f),
+};
+
+static_assert(sizeof(glm::mat4x3) == 4 * sizeof(glm::vec3), "Box matrix columns are packed vec3s.");
+
+static Load< void > setup_box_buffers(LoadTagDefault, LoadInfo("DrawLines boxes", {&wire_box_program}, LoadLazy), nullptr, [](){
+	glGenBuffers(1, &box_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, box_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(box_edges), box_edges, GL_STATIC_DRAW);
+
+	glGenVertexArrays(1, &box_buffer_for_wire_box_program);
+	glBindVertexArray(box_buffer_for_wire_box_program);
+
+	glVertexAttribPointer(wire_box_program->Position_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLbyte *)0);
+	glEnableVertexAttribArray(wire_box_program->Position_vec3);
+
+	//per-instance attributes (pointed at each batch's boxes in the stream buffer when drawing):
+	for (GLuint column = 0; column < 4; ++column) {
+		glEnableVertexAttribArray(wire_box_program->Matrix_mat4x3 + column);
+		glVertexAttribDivisor(wire_box_program->Matrix_mat4x3 + column, 1);
+	}
+	glEnableVertexAttribArray(wire_box_program->Color_vec4);
+	glVertexAttribDivisor(wire_box_program->Color_vec4, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	GL_ERRORS();
+});
+
+//Wide lines are drawn as instances of a rectangle, which the vertex shader stretches around each segment:
+static GLuint wide_line_buffer = 0;
+static GLuint wide_line_buffer_for_wide_line_program = 0;
+
+static const glm::vec2 wide_line_corners[] = { //(as a triangle strip)
+	glm::vec2(0.0f,-1.0f), glm::vec2(1.0f,-1.0f),
+	glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 1.0f),
+};
+
+static Load< void > setup_wide_line_buffers(LoadTagDefault, LoadInfo("DrawLines wide lines", {&wide_line_program}, LoadLazy), nullptr, [](){
+	glGenBuffers(1, &wide_line_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, wide_line_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(wide_line_corners), wide_line_corners, GL_STATIC_DRAW);
+
+	glGenVertexArrays(1, &wide_line_buffer_for_wide_line_program);
+	glBindVertexArray(wide_line_buffer_for_wide_line_program);
+
+	glVertexAttribPointer(wide_line_program->Corner_vec2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (GLbyte *)0);
+	glEnableVertexAttribArray(wide_line_program->Corner_vec2);
+
+	//per-instance attributes (pointed at each batch's lines in the stream buffer when drawing):
+	for (GLuint attrib : {wide_line_program->A_vec3, wide_line_program->B_vec3, wide_line_program->Color_vec4, wide_line_program->Width_float}) {
+		glEnableVertexAttribArray(attrib);
+		glVertexAttribDivisor(attrib, 1);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	GL_ERRORS();
+});
+
 
 DrawLines::DrawLines(glm::mat4 const &world_to_clip_) : world_to_clip(world_to_clip_) {
 }
@@ -71,94 +227,241 @@ void DrawLines::draw(glm::vec3 const &a, glm::vec3 const &b, glm::u8vec4 const &
 	attribs.emplace_back(b, color);
 }
 
+void DrawLines::draw_wide(glm::vec3 const &a, glm::vec3 const &b, float width, glm::u8vec4 const &color) {
+	lines.emplace_back(a, b, color, width);
+}
+
 void DrawLines::draw_box(glm::mat4x3 const &mat, glm::u8vec4 const &color) {
-	//draw cube as three edge sets:
-
-	draw(mat * glm::vec4(-1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f,-1.0f,-1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f, 1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f,-1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f,-1.0f, 1.0f, 1.0f), mat * glm::vec4( 1.0f,-1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f, 1.0f, 1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f, 1.0f, 1.0f), color);
-
-	draw(mat * glm::vec4(-1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4(-1.0f, 1.0f,-1.0f, 1.0f), color);
-	draw(mat * glm::vec4( 1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f,-1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f,-1.0f, 1.0f, 1.0f), mat * glm::vec4(-1.0f, 1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4( 1.0f,-1.0f, 1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f, 1.0f, 1.0f), color);
-	
-	draw(mat * glm::vec4(-1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4(-1.0f,-1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4( 1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f,-1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f, 1.0f,-1.0f, 1.0f), mat * glm::vec4(-1.0f, 1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4( 1.0f, 1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f, 1.0f, 1.0f), color);
+	boxes.emplace_back(mat, color);
+}
+
+void DrawLines::draw_boxes(Box const *boxes_, size_t count) {
+	boxes.insert(boxes.end(), boxes_, boxes_ + count);
+}
+
+void DrawLines::draw_lines(Line const *lines_, size_t count) {
+	lines.insert(lines.end(), lines_, lines_ + count);
 }
 
 void DrawLines::draw_text(std::string const &text, glm::vec3 const &anchor_in, glm::vec3 const &x, glm::vec3 const &y, glm::u8vec4 const &color, glm::vec3 *anchor_out) {
+	PathFont const &font = PathFont::font;
 
 	glm::vec3 anchor = anchor_in;
 
-	uint32_t start = 0;
-	while (start < text.size()) {
-		uint32_t end = start;
-		uint32_t glyph = -1U;
-		while (end < text.size()) {
-			end += 1;
-			auto f = PathFont::font.glyph_map.find(text.substr(start, end-start));
-			if (f == PathFont::font.glyph_map.end()) {
-				end -= 1;
-				break;
-			}
-			glyph = f->second;
-		}
+	char const *at = text.data();
+	char const *end = at + text.size();
+	while (at < end) {
+		uint32_t length;
+		uint32_t glyph = font.match(at, end, &length);
 		if (glyph == -1U) {
-			assert(start == end);
-			end += 1;
 			//missing! draw a tofu:
-			for (const auto &pt : {
-				glm::vec2(0.1f, 0.1f), glm::vec2(0.6f, 0.1f),
-				glm::vec2(0.6f, 0.1f), glm::vec2(0.6f, 0.9f),
-				glm::vec2(0.9f, 0.6f), glm::vec2(0.1f, 0.9f),
-				glm::vec2(0.1f, 0.9f), glm::vec2(0.1f, 0.1f)
-			}) {
-				attribs.emplace_back(anchor + pt.x * x + pt.y * y, color);
-			}
-			anchor += x * 0.6f;
+			glyphs.emplace_back(font.glyphs, anchor, x, y, color);
+			anchor += x * missing_glyph_width;
+			at += 1;
 		} else {
-			for (uint32_t c = PathFont::font.glyph_coord_starts[glyph]; c + 1 < PathFont::font.glyph_coord_starts[glyph+1]; c += 2) {
-				attribs.emplace_back(anchor + x * PathFont::font.coords[c] + y * PathFont::font.coords[c+1], color);
+			//(blank glyphs, like space, just move the anchor)
+			if (font.glyph_coord_starts[glyph] != font.glyph_coord_starts[glyph+1]) {
+				glyphs.emplace_back(glyph, anchor, x, y, color);
 			}
-			anchor += x * PathFont::font.glyph_widths[glyph];
+			anchor += x * font.glyph_widths[glyph];
+			at += length;
 		}
-		start = end;
 	}
 
 	if (anchor_out) *anchor_out = anchor;
 }
 
+//Everything the DrawLines of this frame drew, waiting for submit_frame():
+struct DrawLinesBatch {
+	glm::mat4 world_to_clip;
+	bool depth_test; //(was GL_DEPTH_TEST enabled when the DrawLines finished?)
+	uint32_t vertices_begin, vertices_end; //range of frame_vertices
+	uint32_t glyphs_begin; //start of this batch's instances in frame_glyphs (grouped by glyph)
+	uint32_t glyph_starts; //start of this batch's PathFont::font.glyphs + 2 run boundaries in frame_glyph_starts (or -1U if no glyphs)
+	uint32_t boxes_begin, boxes_end; //range of frame_boxes
+	uint32_t lines_begin, lines_end; //range of frame_lines
+};
+static std::vector< DrawLinesBatch > frame_batches;
+static std::vector< DrawLines::Vertex > frame_vertices;
+static std::vector< DrawLines::Glyph > frame_glyphs;
+static std::vector< uint32_t > frame_glyph_starts;
+static std::vector< DrawLines::Box > frame_boxes;
+static std::vector< DrawLines::Line > frame_lines;
+
 DrawLines::~DrawLines() {
-	if (attribs.empty()) return;
+	if (attribs.empty() && glyphs.empty() && boxes.empty() && lines.empty()) return;
+
+	DrawLinesBatch batch;
+	batch.world_to_clip = world_to_clip;
+	batch.depth_test = glIsEnabled(GL_DEPTH_TEST);
+
+	batch.vertices_begin = uint32_t(frame_vertices.size());
+	frame_vertices.insert(frame_vertices.end(), attribs.begin(), attribs.end());
+	batch.vertices_end = uint32_t(frame_vertices.size());
+
+	batch.glyphs_begin = uint32_t(frame_glyphs.size());
+	batch.glyph_starts = -1U;
+	if (!glyphs.empty()) {
+		//group instances by glyph (counting sort, so this is linear in the number of glyphs drawn):
+		uint32_t glyph_count = PathFont::font.glyphs + 1; //(including the "missing glyph" box)
+		batch.glyph_starts = uint32_t(frame_glyph_starts.size());
+		frame_glyph_starts.resize(frame_glyph_starts.size() + glyph_count + 1, 0);
+		uint32_t *starts = &frame_glyph_starts[batch.glyph_starts];
+		for (auto const &g : glyphs) {
+			starts[g.glyph + 1] += 1;
+		}
+		for (uint32_t i = 0; i < glyph_count; ++i) {
+			starts[i + 1] += starts[i];
+		}
+		frame_glyphs.resize(frame_glyphs.size() + glyphs.size(), glyphs[0]);
+		std::vector< uint32_t > next(starts, starts + glyph_count);
+		for (auto const &g : glyphs) {
+			frame_glyphs[batch.glyphs_begin + next[g.glyph]++] = g;
+		}
+	}
 
-	//based on DrawSprites.cpp :
+	batch.boxes_begin = uint32_t(frame_boxes.size());
+	frame_boxes.insert(frame_boxes.end(), boxes.begin(), boxes.end());
+	batch.boxes_end = uint32_t(frame_boxes.size());
 
-	//upload vertices to vertex_buffer:
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, attribs.size() * sizeof(attribs[0]), attribs.data(), GL_STREAM_DRAW); //upload attribs array
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	batch.lines_begin = uint32_t(frame_lines.size());
+	frame_lines.insert(frame_lines.end(), lines.begin(), lines.end());
+	batch.lines_end = uint32_t(frame_lines.size());
 
-	//set color_program as current program:
-	glUseProgram(color_program->program);
+	frame_batches.emplace_back(batch);
+}
 
-	//upload OBJECT_TO_CLIP to the proper uniform location:
-	glUniformMatrix4fv(color_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+void DrawLines::submit_frame() {
+	if (frame_batches.empty()) return;
 
-	//use the mapping vertex_buffer_for_color_program to fetch vertex data:
-	glBindVertexArray(vertex_buffer_for_color_program);
+	setup_buffers.finish();
+	setup_glyph_buffers.finish();
+	if (!frame_boxes.empty()) setup_box_buffers.finish();
+	if (!frame_lines.empty()) setup_wide_line_buffers.finish();
 
-	//run the OpenGL pipeline:
-	glDrawArrays(GL_LINES, 0, GLsizei(attribs.size()));
+	//write the whole frame's vertices, then its glyph, box, and wide line instances, into this frame's region of the stream buffer:
+	size_t vertex_bytes = frame_vertices.size() * sizeof(DrawLines::Vertex);
+	size_t glyph_bytes = frame_glyphs.size() * sizeof(DrawLines::Glyph);
+	size_t box_bytes = frame_boxes.size() * sizeof(DrawLines::Box);
+	size_t line_bytes = frame_lines.size() * sizeof(DrawLines::Line);
+	GLintptr offset = 0;
+	char *data = reinterpret_cast< char * >(stream->map(vertex_bytes + glyph_bytes + box_bytes + line_bytes, &offset));
+	if (vertex_bytes) std::memcpy(data, frame_vertices.data(), vertex_bytes);
+	if (glyph_bytes) std::memcpy(data + vertex_bytes, frame_glyphs.data(), glyph_bytes);
+	if (box_bytes) std::memcpy(data + vertex_bytes + glyph_bytes, frame_boxes.data(), box_bytes);
+	if (line_bytes) std::memcpy(data + vertex_bytes + glyph_bytes + box_bytes, frame_lines.data(), line_bytes);
+	stream->unmap();
 
-	//reset vertex array to none:
-	glBindVertexArray(0);
+	GLint first_vertex = GLint(offset / sizeof(DrawLines::Vertex));
+	GLbyte *glyph_data = (GLbyte *)0 + offset + vertex_bytes;
+	GLbyte *box_data = glyph_data + glyph_bytes;
+	GLbyte *line_data = box_data + box_bytes;
+
+	//wide lines are sized in pixels, so they need the size of the viewport being drawn to:
+	GLint viewport[4] = {0, 0, 1, 1};
+	if (!frame_lines.empty()) glGetIntegerv(GL_VIEWPORT, viewport);
+
+	GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+
+	for (auto const &batch : frame_batches) {
+		if (batch.depth_test) glEnable(GL_DEPTH_TEST);
+		else glDisable(GL_DEPTH_TEST);
+
+		if (batch.vertices_end != batch.vertices_begin) {
+			//based on DrawSprites.cpp :
+
+			//set color_program as current program:
+			glUseProgram(color_program->program);
+
+			//upload OBJECT_TO_CLIP to the proper uniform location:
+			glUniformMatrix4fv(color_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(batch.world_to_clip));
+
+			//use the mapping vertex_buffer_for_color_program to fetch vertex data:
+			glBindVertexArray(vertex_buffer_for_color_program);
+
+			//run the OpenGL pipeline:
+			glDrawArrays(GL_LINES, first_vertex + GLint(batch.vertices_begin), GLsizei(batch.vertices_end - batch.vertices_begin));
+		}
 
-	//reset current program to none:
+		if (batch.glyph_starts != -1U) {
+			//draw glyph instances, one instanced draw call per distinct glyph:
+			glUseProgram(path_font_program->program);
+			glUniformMatrix4fv(path_font_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(batch.world_to_clip));
+			glBindVertexArray(glyph_buffer_for_path_font_program);
+			glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+
+			uint32_t const *starts = &frame_glyph_starts[batch.glyph_starts];
+			for (uint32_t glyph = 0; glyph + 1 < glyph_firsts.size(); ++glyph) {
+				GLsizei instances = GLsizei(starts[glyph + 1] - starts[glyph]);
+				if (instances == 0) continue;
+
+				//point the per-instance attributes at this glyph's run of instances:
+				GLbyte *run = glyph_data + (batch.glyphs_begin + starts[glyph]) * sizeof(DrawLines::Glyph);
+				glVertexAttribPointer(path_font_program->Anchor_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(DrawLines::Glyph), run + offsetof(DrawLines::Glyph, Anchor));
+				glVertexAttribPointer(path_font_program->X_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(DrawLines::Glyph), run + offsetof(DrawLines::Glyph, X));
+				glVertexAttribPointer(path_font_program->Y_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(DrawLines::Glyph), run + offsetof(DrawLines::Glyph, Y));
+				glVertexAttribPointer(path_font_program->Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DrawLines::Glyph), run + offsetof(DrawLines::Glyph, Color));
+
+				glDrawArraysInstanced(GL_LINES, glyph_firsts[glyph], glyph_firsts[glyph + 1] - glyph_firsts[glyph], instances);
+			}
+
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		if (batch.boxes_end != batch.boxes_begin) {
+			//draw all of the batch's boxes with one instanced draw call:
+			glUseProgram(wire_box_program->program);
+			glUniformMatrix4fv(wire_box_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(batch.world_to_clip));
+			glBindVertexArray(box_buffer_for_wire_box_program);
+			glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+
+			GLbyte *run = box_data + batch.boxes_begin * sizeof(DrawLines::Box);
+			for (GLuint column = 0; column < 4; ++column) {
+				glVertexAttribPointer(wire_box_program->Matrix_mat4x3 + column, 3, GL_FLOAT, GL_FALSE, sizeof(DrawLines::Box), run + offsetof(DrawLines::Box, Matrix) + column * sizeof(glm::vec3));
+			}
+			glVertexAttribPointer(wire_box_program->Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DrawLines::Box), run + offsetof(DrawLines::Box, Color));
+
+			glDrawArraysInstanced(GL_LINES, 0, GLsizei(sizeof(box_edges) / sizeof(box_edges[0])), GLsizei(batch.boxes_end - batch.boxes_begin));
+
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		if (batch.lines_end != batch.lines_begin) {
+			//draw all of the batch's wide lines with one instanced draw call:
+			glUseProgram(wide_line_program->program);
+			glUniformMatrix4fv(wide_line_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(batch.world_to_clip));
+			glUniform2f(wide_line_program->VIEWPORT_SIZE_vec2, float(viewport[2]), float(viewport[3]));
+			glBindVertexArray(wide_line_buffer_for_wide_line_program);
+			glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+
+			GLbyte *run = line_data + batch.lines_begin * sizeof(DrawLines::Line);
+			glVertexAttribPointer(wide_line_program->A_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(DrawLines::Line), run + offsetof(DrawLines::Line, A));
+			glVertexAttribPointer(wide_line_program->B_vec3, 3, GL_FLOAT, GL_FALSE, sizeof(DrawLines::Line), run + offsetof(DrawLines::Line, B));
+			glVertexAttribPointer(wide_line_program->Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DrawLines::Line), run + offsetof(DrawLines::Line, Color));
+			glVertexAttribPointer(wide_line_program->Width_float, 1, GL_FLOAT, GL_FALSE, sizeof(DrawLines::Line), run + offsetof(DrawLines::Line, Width));
+
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, GLsizei(sizeof(wide_line_corners) / sizeof(wide_line_corners[0])), GLsizei(batch.lines_end - batch.lines_begin));
+
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+	}
+
+	//reset vertex array and current program to none:
+	glBindVertexArray(0);
 	glUseProgram(0);
-}
 
+	if (depth_test) glEnable(GL_DEPTH_TEST);
+	else glDisable(GL_DEPTH_TEST);
+
+	//fence this frame's region (so it isn't rewritten while still being drawn from):
+	stream->end_frame();
 
+	frame_batches.clear();
+	frame_vertices.clear();
+	frame_glyphs.clear();
+	frame_glyph_starts.clear();
+	frame_boxes.clear();
+	frame_lines.clear();
+
+	GL_ERRORS();
+}
@@ -6,11 +6,19 @@
  *
  * Similar usage pattern to DrawSprites.
  *
+ * Lines aren't drawn right away: each DrawLines hands what it drew (and the
+ * GL_DEPTH_TEST setting in effect) to a per-frame queue when it is destroyed,
+ * and DrawLines::submit_frame() -- called once per frame, after the current
+ * Mode has drawn -- uploads the whole frame at once into a streaming buffer
+ * (see StreamRing.hpp) and draws it. So DrawLines output lands on top of
+ * anything drawn after it in the same frame (depth testing permitting).
+ *
  */
 
 
 #include <glm/glm.hpp>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -21,11 +29,22 @@ struct DrawLines {
 	//draw a single line from a to b (in world space):
 	void draw(glm::vec3 const &a, glm::vec3 const &b, glm::u8vec4 const &color = glm::u8vec4(0xff));
 
+	//draw a line from a to b that is 'width' pixels wide on screen:
+	void draw_wide(glm::vec3 const &a, glm::vec3 const &b, float width, glm::u8vec4 const &color = glm::u8vec4(0xff));
+
 	//draw a wireframe box corresponding to the [-1,1]^3 cube transformed by mat:
+	// (the cube is expanded on the GPU, so each box costs one Box record)
 	void draw_box(glm::mat4x3 const &mat, glm::u8vec4 const &color = glm::u8vec4(0xff));
 
+	struct Box;
+	struct Line;
+	//draw many boxes / wide lines at once (the records are copied as-is):
+	void draw_boxes(Box const *boxes, size_t count);
+	void draw_lines(Line const *lines, size_t count);
+
 	//draw wireframe text, start at anchor, move in x direction, mat gives x and y directions for text drawing:
 	// (default character box is 1 unit high)
+	// (glyph geometry lives on the GPU, so each glyph costs one small instance record)
 	void draw_text(std::string const &text,
 		glm::vec3 const &anchor,
 		glm::vec3 const &x = glm::vec3(1.0f, 0.0f, 0.0f),
@@ -33,9 +52,12 @@ struct DrawLines {
 		glm::u8vec4 const &color = glm::u8vec4(0xff),
 		glm::vec3 *anchor_out = nullptr);
 
-	//Finish drawing (push attribs to GPU):
+	//Finish drawing (queue attribs for submit_frame()):
 	~DrawLines();
 
+	//Draw everything queued this frame (call once per frame, after drawing, with the frame's framebuffer bound):
+	static void submit_frame();
+
 
 	glm::mat4 world_to_clip;
 	struct Vertex {
@@ -45,4 +67,30 @@ struct DrawLines {
 	};
 	std::vector< Vertex > attribs;
 
+	struct Glyph {
+		Glyph(uint32_t glyph_, glm::vec3 const &Anchor_, glm::vec3 const &X_, glm::vec3 const &Y_, glm::u8vec4 const &Color_) : Anchor(Anchor_), X(X_), Y(Y_), Color(Color_), glyph(glyph_) { }
+		glm::vec3 Anchor;
+		glm::vec3 X;
+		glm::vec3 Y;
+		glm::u8vec4 Color;
+		uint32_t glyph; //index into PathFont::font's glyphs (PathFont::font.glyphs means the "missing glyph" box)
+	};
+	std::vector< Glyph > glyphs;
+
+	struct Box {
+		Box(glm::mat4x3 const &Matrix_, glm::u8vec4 const &Color_) : Matrix(Matrix_), Color(Color_) { }
+		glm::mat4x3 Matrix;
+		glm::u8vec4 Color;
+	};
+	std::vector< Box > boxes;
+
+	struct Line {
+		Line(glm::vec3 const &A_, glm::vec3 const &B_, glm::u8vec4 const &Color_, float Width_ = 1.0f) : A(A_), B(B_), Color(Color_), Width(Width_) { }
+		glm::vec3 A;
+		glm::vec3 B;
+		glm::u8vec4 Color;
+		float Width; //(in pixels)
+	};
+	std::vector< Line > lines;
+
 };
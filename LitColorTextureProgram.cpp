@@ -1,5 +1,4 @@
 #include "LitColorTextureProgram.hpp"
-#include "TexProgram.hpp"
 
 #include "gl_compile_program.hpp"
 #include "gl_errors.hpp"
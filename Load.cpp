@@ -2,19 +2,357 @@
 
 #include <array>
 #include <list>
+#include <map>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
 #include <cassert>
 
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
 namespace {
-	std::array< std::list< std::function< void() > >, MaxLoadTag > &get_load_lists() {
-		static std::array< std::list< std::function< void() > >, MaxLoadTag > load_lists;
-		return load_lists;
+	//Per-phase timing, recorded for the load report:
+	struct LoadPhase {
+		std::chrono::steady_clock::time_point start, end; //wall clock
+		double cpu_ms = 0.0; //cpu time used by the thread running the phase
+		uint32_t thread = 0; //0 is the OpenGL thread, 1+ are workers
+		bool ran = false;
+	};
+
+	//Data moved by a load function, reported via load_report_*():
+	struct LoadBytes {
+		size_t read = 0;
+		size_t gl = 0;
+	};
+
+	//set while a load function phase is running on this thread:
+	thread_local LoadBytes *current_bytes = nullptr;
+
+	double thread_cpu_ms() {
+	#if defined(_WIN32)
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0.0;
+		auto to_100ns = [](FILETIME const &ft) {
+			return (uint64_t(ft.dwHighDateTime) << 32) | uint64_t(ft.dwLowDateTime);
+		};
+		return double(to_100ns(kernel) + to_100ns(user)) * 1e-4;
+	#else
+		timespec ts;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0.0;
+		return double(ts.tv_sec) * 1e3 + double(ts.tv_nsec) * 1e-6;
+	#endif
+	}
+
+	//One node in the load graph:
+	struct LoadFunction {
+		LoadTag tag = LoadTagDefault;
+		void const *key = nullptr;
+		LoadInfo info;
+		std::function< void() > cpu_fn;
+		std::function< void() > gl_fn;
+
+		//computed in call_load_functions():
+		std::vector< uint32_t > dependents;
+		std::vector< uint32_t > dependencies;
+		uint32_t waiting_on = 0; //number of unfinished dependencies
+		bool requested = false; //has something asked for this to load? (eager functions always are)
+		bool done = false;
+		std::exception_ptr error; //set if this (or something it depends on) failed to load
+		LoadPhase cpu_phase, gl_phase;
+		LoadBytes bytes;
+
+		//run one phase, recording timing and bytes:
+		void run(std::function< void() > const &fn, LoadPhase *phase_, uint32_t thread) {
+			LoadPhase &phase = *phase_;
+			phase.thread = thread;
+			phase.ran = true;
+			current_bytes = &bytes;
+			double cpu_before = thread_cpu_ms();
+			phase.start = std::chrono::steady_clock::now();
+			try {
+				fn();
+			} catch (...) {
+				current_bytes = nullptr;
+				throw;
+			}
+			phase.end = std::chrono::steady_clock::now();
+			phase.cpu_ms = thread_cpu_ms() - cpu_before;
+			current_bytes = nullptr;
+		}
+
+		double wall_ms() const {
+			typedef std::chrono::duration< double, std::milli > ms;
+			return ms(cpu_phase.end - cpu_phase.start).count() + ms(gl_phase.end - gl_phase.start).count();
+		}
+		double cpu_ms() const {
+			return cpu_phase.cpu_ms + gl_phase.cpu_ms;
+		}
+	};
+
+	//set on worker threads (which must never block on finish_load_function()):
+	thread_local bool is_load_worker = false;
+
+	std::string json_escape(std::string const &str) {
+		std::string ret;
+		for (char c : str) {
+			if (c == '"' || c == '\\') {
+				ret += '\\';
+				ret += c;
+			} else if (uint8_t(c) < 0x20) {
+				char buf[8];
+				snprintf(buf, 8, "\\u%04x", uint32_t(uint8_t(c)));
+				ret += buf;
+			} else {
+				ret += c;
+			}
+		}
+		return ret;
+	}
+
+	std::list< LoadFunction > &get_load_functions() {
+		static std::list< LoadFunction > load_functions;
+		return load_functions;
+	}
+
+	//The load graph, kept around after call_load_functions() so lazy functions can be loaded later:
+	struct Loader {
+		std::vector< LoadFunction > fns;
+		std::map< void const *, uint32_t > key_to_index;
+		std::chrono::steady_clock::time_point before; //when call_load_functions() started
+		bool started = false; //has call_load_functions() built the graph?
+		bool startup_done = false; //has call_load_functions() returned?
+
+		//worker threads run 'cpu' phases; the OpenGL thread runs 'gl' phases:
+		std::mutex mutex;
+		std::condition_variable cpu_cv; //signalled when cpu_queue has work (or when quitting)
+		std::condition_variable gl_cv; //signalled when gl_queue has work (or a function has finished)
+		std::deque< uint32_t > cpu_queue;
+		std::deque< uint32_t > gl_queue;
+		uint32_t pending = 0; //requested but not yet done
+		uint32_t unloaded = 0; //not yet done (includes lazy functions nobody has asked for)
+		bool quit = false;
+		std::exception_ptr startup_error; //first failure during call_load_functions() (which gives up on everything)
+		std::vector< std::thread > workers;
+
+		~Loader() {
+			stop_workers();
+		}
+
+		void stop_workers() {
+			{
+				std::unique_lock< std::mutex > lock(mutex);
+				quit = true;
+				cpu_cv.notify_all();
+			}
+			for (auto &w : workers) {
+				w.join();
+			}
+			workers.clear();
+		}
+
+		//called with mutex held when function 'i' is ready to run:
+		void enqueue(uint32_t i) {
+			if (fns[i].cpu_fn) {
+				cpu_queue.emplace_back(i);
+				cpu_cv.notify_one();
+			} else {
+				gl_queue.emplace_back(i);
+				gl_cv.notify_one();
+			}
+		}
+
+		//called with mutex held to ask for function 'i' (and everything it depends on) to load:
+		void request(uint32_t i) {
+			LoadFunction &fn = fns[i];
+			if (fn.requested || fn.error) return;
+			fn.requested = true;
+			pending += 1;
+			for (uint32_t d : fn.dependencies) {
+				request(d);
+			}
+			if (fn.waiting_on == 0) enqueue(i);
+		}
+
+		//called with mutex held when function 'i' is fully loaded:
+		void finish(uint32_t i) {
+			LoadFunction &fn = fns[i];
+			fn.done = true;
+			pending -= 1;
+			unloaded -= 1;
+			for (uint32_t d : fn.dependents) {
+				assert(fns[d].waiting_on > 0);
+				fns[d].waiting_on -= 1;
+				if (fns[d].waiting_on == 0 && fns[d].requested && !fns[d].error) enqueue(d);
+			}
+			if (startup_done) {
+				std::cout << "Lazy-loaded '" << fn.info.name << "' in " << fn.wall_ms() << "ms." << std::endl;
+			}
+			gl_cv.notify_all();
+		}
+
+		//called with mutex held when function 'i' throws 'e' (or something it depends on did):
+		// it and everything depending on it are given up on, and 'e' is rethrown to whoever finishes any of them
+		void fail(uint32_t i, std::exception_ptr const &e) {
+			LoadFunction &fn = fns[i];
+			if (fn.done || fn.error) return;
+			fn.error = e;
+			if (fn.requested) pending -= 1;
+			unloaded -= 1;
+			if (!startup_done) {
+				if (!startup_error) startup_error = e;
+			} else {
+				std::cout << "Lazy load of '" << fn.info.name << "' failed." << std::endl;
+			}
+			for (uint32_t d : fn.dependents) {
+				fail(d, e);
+			}
+			gl_cv.notify_all();
+		}
+
+		//called with mutex held when function 'i' is done with its cpu phase:
+		void cpu_done(uint32_t i) {
+			if (fns[i].gl_fn) {
+				gl_queue.emplace_back(i);
+				gl_cv.notify_all();
+			} else {
+				finish(i);
+			}
+		}
+
+		void worker(uint32_t thread) {
+			is_load_worker = true;
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				cpu_cv.wait(lock, [&](){ return quit || !cpu_queue.empty(); });
+				if (quit) break;
+				uint32_t i = cpu_queue.front();
+				cpu_queue.pop_front();
+
+				lock.unlock();
+				std::exception_ptr fn_error;
+				try {
+					fns[i].run(fns[i].cpu_fn, &fns[i].cpu_phase, thread);
+				} catch (...) {
+					fn_error = std::current_exception();
+				}
+				lock.lock();
+
+				if (fn_error) {
+					fail(i, fn_error);
+				} else {
+					cpu_done(i);
+				}
+			}
+		}
+
+		//run the gl phase at the front of gl_queue on this (OpenGL) thread:
+		// (called with mutex held via 'lock'; failures are recorded with fail(), not thrown)
+		void run_next_gl(std::unique_lock< std::mutex > &lock) {
+			assert(!gl_queue.empty());
+			uint32_t i = gl_queue.front();
+			gl_queue.pop_front();
+
+			lock.unlock();
+			try {
+				if (fns[i].gl_fn) fns[i].run(fns[i].gl_fn, &fns[i].gl_phase, 0);
+			} catch (...) {
+				lock.lock();
+				fail(i, std::current_exception());
+				return;
+			}
+			lock.lock();
+
+			finish(i);
+		}
+
+		//run gl phases on this (OpenGL) thread until 'is_finished()' holds:
+		// (called with mutex held via 'lock')
+		template< typename F >
+		void run_gl_until(std::unique_lock< std::mutex > &lock, F const &is_finished) {
+			while (!is_finished()) {
+				if (gl_queue.empty()) {
+					gl_cv.wait(lock);
+					continue;
+				}
+				run_next_gl(lock);
+			}
+		}
+
+		uint32_t lookup(void const *key) const {
+			if (!started) {
+				throw std::runtime_error("Lazy load functions can't be used before call_load_functions().");
+			}
+			auto f = key_to_index.find(key);
+			if (f == key_to_index.end()) {
+				throw std::runtime_error("Asked to load something that was never registered with add_load_function().");
+			}
+			return f->second;
+		}
+	};
+
+	Loader &get_loader() {
+		static Loader loader;
+		return loader;
+	}
+}
+
+std::string load_type_name(std::type_info const &info) {
+	std::string name = info.name();
+	#if defined(__GNUC__)
+	int status = 0;
+	char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+	if (status == 0 && demangled) name = demangled;
+	std::free(demangled);
+	#else
+	//MSVC names look like "struct ColorProgram":
+	for (std::string prefix : {"struct ", "class "}) {
+		if (name.substr(0, prefix.size()) == prefix) name = name.substr(prefix.size());
 	}
+	#endif
+	return name;
+}
+
+void load_report_bytes_read(size_t bytes) {
+	if (current_bytes) current_bytes->read += bytes;
+}
+
+void load_report_gl_bytes(size_t bytes) {
+	if (current_bytes) current_bytes->gl += bytes;
+}
+
+void add_load_function(LoadTag tag, std::function< void() > const &gl_fn) {
+	LoadInfo info;
+	info.explicit_after = false;
+	add_load_function(tag, nullptr, info, nullptr, gl_fn);
 }
 
-void add_load_function(LoadTag tag, std::function< void() > const &fn) {
-	auto &load_lists = get_load_lists();
-	assert(tag < load_lists.size());
-	load_lists[tag].emplace_back(fn);
+void add_load_function(LoadTag tag, void const *key, LoadInfo const &info, std::function< void() > const &cpu_fn, std::function< void() > const &gl_fn) {
+	assert(tag < MaxLoadTag);
+	auto &load_functions = get_load_functions();
+	load_functions.emplace_back();
+	LoadFunction &fn = load_functions.back();
+	fn.tag = tag;
+	fn.key = key;
+	fn.info = info;
+	fn.cpu_fn = cpu_fn;
+	fn.gl_fn = gl_fn;
 }
 
 void call_load_functions() {
@@ -22,11 +360,242 @@ void call_load_functions() {
 	assert(!has_been_called && "call_load_functions should only be called *once*");
 	has_been_called = true;
 
-	auto &load_lists = get_load_lists();
-	for (auto &fn_list : load_lists) {
-		while (!fn_list.empty()) {
-			(*fn_list.begin())(); //call first function in the list
-			fn_list.pop_front(); //remove from list
+	Loader &loader = get_loader();
+	loader.before = std::chrono::steady_clock::now();
+	auto const &before = loader.before;
+
+	//move functions into a vector so they can be referred to by index:
+	std::vector< LoadFunction > &fns = loader.fns;
+	fns.assign(get_load_functions().begin(), get_load_functions().end());
+	get_load_functions().clear();
+
+	//----- build dependency graph -----
+	std::map< void const *, uint32_t > &key_to_index = loader.key_to_index;
+	for (uint32_t i = 0; i < fns.size(); ++i) {
+		if (fns[i].key) key_to_index.emplace(fns[i].key, i);
+		if (fns[i].info.name.empty()) fns[i].info.name = "load function " + std::to_string(i);
+	}
+
+	//(edges from dependency -> dependent)
+	auto add_edge = [&fns](uint32_t from, uint32_t to) {
+		fns[from].dependents.emplace_back(to);
+		fns[to].dependencies.emplace_back(from);
+		fns[to].waiting_on += 1;
+	};
+	for (uint32_t i = 0; i < fns.size(); ++i) {
+		LoadFunction &fn = fns[i];
+		if (fn.info.explicit_after) {
+			for (void const *key : fn.info.after) {
+				auto f = key_to_index.find(key);
+				if (f == key_to_index.end()) {
+					throw std::runtime_error("Load '" + fn.info.name + "' depends on something that was never registered with add_load_function().");
+				}
+				add_edge(f->second, i);
+			}
+		} else {
+			//classic behavior: wait for every eager function with an earlier tag:
+			// (lazy ones are only waited on if named explicitly)
+			for (uint32_t j = 0; j < fns.size(); ++j) {
+				if (fns[j].tag < fn.tag && fns[j].info.policy == LoadEager) add_edge(j, i);
+			}
+		}
+	}
+
+	//topological order, used to check for cycles now and to find the critical path later:
+	std::vector< uint32_t > order;
+	order.reserve(fns.size());
+	{
+		std::vector< uint32_t > waiting(fns.size(), 0);
+		for (auto const &fn : fns) {
+			for (uint32_t d : fn.dependents) waiting[d] += 1;
+		}
+		for (uint32_t i = 0; i < fns.size(); ++i) {
+			if (waiting[i] == 0) order.emplace_back(i);
+		}
+		for (uint32_t o = 0; o < order.size(); ++o) {
+			for (uint32_t d : fns[order[o]].dependents) {
+				waiting[d] -= 1;
+				if (waiting[d] == 0) order.emplace_back(d);
+			}
+		}
+	}
+
+	if (order.size() != fns.size()) {
+		std::string names;
+		for (uint32_t i = 0; i < fns.size(); ++i) {
+			if (std::find(order.begin(), order.end(), i) == order.end()) names += " '" + fns[i].info.name + "'";
+		}
+		throw std::runtime_error("Load functions have circular dependencies:" + names);
+	}
+
+	//----- run graph -----
+
+	uint32_t worker_count = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	worker_count = std::max(1u, std::min(worker_count, 8u));
+
+	{
+		std::unique_lock< std::mutex > lock(loader.mutex);
+		loader.started = true;
+		loader.unloaded = uint32_t(fns.size());
+
+		//ask for every eager function (this also pulls in any lazy function an eager one depends on):
+		for (uint32_t i = 0; i < fns.size(); ++i) {
+			if (fns[i].info.policy == LoadEager) loader.request(i);
+		}
+
+		for (uint32_t w = 0; w < worker_count; ++w) {
+			loader.workers.emplace_back(&Loader::worker, &loader, w + 1);
+		}
+
+		//(any failure here stops everything)
+		loader.run_gl_until(lock, [&loader](){ return loader.pending == 0 || loader.startup_error; });
+		if (loader.startup_error) {
+			lock.unlock();
+			loader.stop_workers();
+			std::rethrow_exception(loader.startup_error);
+		}
+
+		loader.startup_done = true;
+	}
+
+	//nothing left to load lazily? no reason to keep the workers around:
+	if (loader.unloaded == 0) loader.stop_workers();
+
+	auto after = std::chrono::steady_clock::now();
+
+	//----- report -----
+	typedef std::chrono::duration< double, std::milli > ms;
+
+	//only report on functions that actually ran:
+	// (lazy functions that nobody has asked for yet are skipped)
+	order.erase(std::remove_if(order.begin(), order.end(), [&fns](uint32_t i){ return !fns[i].done; }), order.end());
+
+	//critical path:
+	std::vector< double > path_end(fns.size(), 0.0);
+	std::vector< uint32_t > path_prev(fns.size(), -1U);
+	for (uint32_t i : order) {
+		path_end[i] += fns[i].wall_ms();
+		for (uint32_t d : fns[i].dependents) {
+			if (path_end[i] > path_end[d]) {
+				path_end[d] = path_end[i];
+				path_prev[d] = i;
+			}
+		}
+	}
+
+	if (order.empty()) return;
+
+	{ //table of functions, slowest first:
+		std::vector< uint32_t > sorted(order);
+		std::stable_sort(sorted.begin(), sorted.end(), [&fns](uint32_t a, uint32_t b) {
+			return fns[a].wall_ms() > fns[b].wall_ms();
+		});
+		size_t name_width = 4;
+		for (uint32_t i : order) name_width = std::max(name_width, fns[i].info.name.size());
+		name_width = std::min< size_t >(name_width, 48);
+
+		std::cout << "Loaded " << order.size() << " things in " << ms(after - before).count() << "ms using " << worker_count << " worker(s)";
+		if (loader.unloaded) std::cout << " (" << loader.unloaded << " lazy load(s) deferred)";
+		std::cout << ":\n";
+		std::cout << "  " << std::left << std::setw(int(name_width)) << "name" << std::right
+		          << std::setw(10) << "wall ms" << std::setw(10) << "cpu ms" << std::setw(12) << "read KiB" << std::setw(12) << "gl KiB" << "\n";
+		std::cout << std::fixed << std::setprecision(2);
+		for (uint32_t i : sorted) {
+			LoadFunction const &fn = fns[i];
+			std::cout << "  " << std::left << std::setw(int(name_width)) << fn.info.name << std::right
+			          << std::setw(10) << fn.wall_ms() << std::setw(10) << fn.cpu_ms()
+			          << std::setw(12) << fn.bytes.read / 1024.0 << std::setw(12) << fn.bytes.gl / 1024.0 << "\n";
+		}
+
+		uint32_t last = uint32_t(std::max_element(path_end.begin(), path_end.end()) - path_end.begin());
+		std::vector< uint32_t > path;
+		for (uint32_t i = last; i != -1U; i = path_prev[i]) {
+			path.emplace_back(i);
+		}
+		std::reverse(path.begin(), path.end());
+
+		std::cout << "Critical path " << path_end[last] << "ms:";
+		for (uint32_t i : path) {
+			std::cout << (i == path[0] ? " " : " -> ") << fns[i].info.name;
+		}
+		std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+	}
+
+	//Chrome trace (open with chrome://tracing or https://ui.perfetto.dev):
+	// written to 'load-trace.json' by default; set LOAD_TRACE to change the path (or to "" to disable)
+	std::string trace_file = "load-trace.json";
+	if (char const *env = std::getenv("LOAD_TRACE")) trace_file = env;
+	if (trace_file != "") {
+		std::ofstream trace(trace_file, std::ios::binary);
+		if (!trace) {
+			std::cerr << "WARNING: failed to open '" << trace_file << "' to write load trace." << std::endl;
+			return;
+		}
+		typedef std::chrono::duration< double, std::micro > us;
+		trace << "{\"traceEvents\":[\n";
+		trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"gl\"}}";
+		for (uint32_t w = 0; w < worker_count; ++w) {
+			trace << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << (w + 1) << ",\"args\":{\"name\":\"worker " << (w + 1) << "\"}}";
+		}
+		for (uint32_t i : order) {
+			LoadFunction const &fn = fns[i];
+			for (auto phase : { std::make_pair("cpu", &fn.cpu_phase), std::make_pair("gl", &fn.gl_phase) }) {
+				if (!phase.second->ran) continue;
+				trace << ",\n{\"name\":\"" << json_escape(fn.info.name) << "\",\"cat\":\"" << phase.first << "\",\"ph\":\"X\",\"pid\":0"
+				      << ",\"tid\":" << phase.second->thread
+				      << ",\"ts\":" << us(phase.second->start - before).count()
+				      << ",\"dur\":" << us(phase.second->end - phase.second->start).count()
+				      << ",\"args\":{\"cpu_ms\":" << phase.second->cpu_ms
+				      << ",\"bytes_read\":" << fn.bytes.read
+				      << ",\"gl_bytes\":" << fn.bytes.gl << "}}";
+			}
+		}
+		trace << "\n]}\n";
+		std::cout << "Wrote load trace to '" << trace_file << "'." << std::endl;
+	}
+}
+
+void prefetch_load_function(void const *key) {
+	Loader &loader = get_loader();
+	std::unique_lock< std::mutex > lock(loader.mutex);
+	uint32_t i = loader.lookup(key);
+	if (loader.fns[i].requested || loader.fns[i].error) return;
+	if (loader.workers.empty()) {
+		throw std::runtime_error("Load '" + loader.fns[i].info.name + "' was requested after the loader shut down.");
+	}
+	loader.request(i);
+}
+
+void finish_load_function(void const *key) {
+	if (is_load_worker) {
+		throw std::runtime_error("finish_load_function() called from a load worker; list the dependency in LoadInfo::after instead.");
+	}
+	Loader &loader = get_loader();
+	std::unique_lock< std::mutex > lock(loader.mutex);
+	uint32_t i = loader.lookup(key);
+	if (loader.fns[i].done) return;
+	if (loader.fns[i].error) std::rethrow_exception(loader.fns[i].error);
+	if (!loader.fns[i].requested) {
+		if (loader.workers.empty()) {
+			throw std::runtime_error("Load '" + loader.fns[i].info.name + "' was requested after the loader shut down.");
 		}
+		loader.request(i);
+	}
+	//(only this function's own failure -- or that of something it depends on -- is thrown here)
+	LoadFunction const &fn = loader.fns[i];
+	loader.run_gl_until(lock, [&fn](){ return fn.done || fn.error; });
+	if (fn.error) std::rethrow_exception(fn.error);
+}
+
+void pump_load_functions(float budget) {
+	assert(!is_load_worker && "pump_load_functions() runs gl phases, so it belongs on the OpenGL thread");
+	Loader &loader = get_loader();
+	auto until = std::chrono::steady_clock::now() + std::chrono::duration< float >(budget);
+	std::unique_lock< std::mutex > lock(loader.mutex);
+	if (!loader.startup_done) return;
+	//(always runs at least one, so a phase longer than the budget doesn't stall forever)
+	while (!loader.gl_queue.empty()) {
+		loader.run_next_gl(lock);
+		if (std::chrono::steady_clock::now() >= until) break;
 	}
 }
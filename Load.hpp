@@ -20,11 +20,40 @@
  * These functions are grouped by 'tags', which allow some sequencing of calls.
  * (particularly, this is useful for loading large data blobs [e.g. Meshes] before looking up individual elements within them.)
  *
+ * Loads may also be split into two phases and given explicit dependencies:
+ *
+ * Load< GLuint > tex(LoadTagDefault, LoadInfo{"tex.png", {&tex_program}},
+ *     []() { return decode_png("tex.png"); }, //'cpu' phase: runs on a worker thread
+ *     [](PNG &png) -> GLuint const * { return upload(png); } //'gl' phase: runs on the OpenGL context thread
+ * );
+ * (either phase may be 'nullptr' for loads that only need one of them)
+ *
+ * call_load_functions() runs the resulting dependency graph with as many
+ * 'cpu' phases in flight as there are worker threads. Once everything has
+ * loaded it prints a table of per-function times (slowest first) and the
+ * critical path, and writes a Chrome trace to 'load-trace.json'.
+ *
+ * Loads marked LoadLazy are skipped by call_load_functions() (unless
+ * something eager depends on them). They load on first use instead, or
+ * earlier if prefetch() is called to start their 'cpu' phase in the background:
+ *
+ * Load< GLuint > level2(LoadTagDefault, LoadInfo("level2.png", {}, LoadLazy), ...);
+ * level2.prefetch(); //starts decoding on a worker
+ * ...
+ * pump_load_functions(); //(once per frame) runs 'gl' phases that have become ready
+ * ...
+ * glBindTexture(GL_TEXTURE_2D, *level2); //finishes loading (if needed)
+ *
  */
 
 #include <functional>
 #include <stdexcept>
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <typeinfo>
+#include <type_traits>
 
 enum LoadTag : uint32_t {
 	LoadTagEarly,
@@ -33,15 +62,56 @@ enum LoadTag : uint32_t {
 	MaxLoadTag //<-- just used to track # of load tags
 };
 
+enum LoadPolicy : uint32_t {
+	LoadEager, //loaded by call_load_functions()
+	LoadLazy, //loaded on first use or prefetch()
+};
+
+//Optional scheduling information for a load function:
+struct LoadInfo {
+	LoadInfo(std::string const &name_ = "", std::vector< void const * > const &after_ = {}, LoadPolicy policy_ = LoadEager)
+		: name(name_), after(after_), explicit_after(true), policy(policy_) { }
+
+	std::string name; //used when reporting load times
+	std::vector< void const * > after; //addresses of Load<>'s that must be finished before this one starts
+	bool explicit_after; //if false, instead waits for every (eager) function with an earlier tag (the classic behavior)
+	LoadPolicy policy;
+};
+
 //Add a function to an internal list of loading functions:
 // (only call *before* "call_load_functions()")
-void add_load_function(LoadTag tag, std::function< void() > const &fn);
+// 'gl_fn' is run on the thread with the OpenGL context after everything with an earlier tag has loaded:
+void add_load_function(LoadTag tag, std::function< void() > const &gl_fn);
 
-//Call all loading functions:
-// (loading functions may throw exceptions if they fail.)
+//Add a two-phase function to the dependency graph:
+// 'key' identifies this function when it is named in another function's 'info.after' list (usually the address of a Load<>)
+// 'cpu_fn' (may be empty) is run on a worker thread once everything in 'info.after' has loaded
+// 'gl_fn' (may be empty) is run on the thread with the OpenGL context once 'cpu_fn' has finished
+void add_load_function(LoadTag tag, void const *key, LoadInfo const &info, std::function< void() > const &cpu_fn, std::function< void() > const &gl_fn);
+
+//Load functions can report data they move; these totals show up in the load report:
+// (calls made outside of a load function are ignored)
+void load_report_bytes_read(size_t bytes);
+void load_report_gl_bytes(size_t bytes);
+
+//Readable name for a type; used to name Load< T >'s that aren't given a name:
+std::string load_type_name(std::type_info const &info);
+
+//Call all (eager) loading functions:
+// (loading functions may throw exceptions if they fail; the first failure stops loading and is rethrown here.)
 // (only call *once*)
 void call_load_functions();
 
+//For lazy load functions (only call *after* "call_load_functions()"):
+//start loading the function registered with 'key' (and anything it depends on) in the background:
+void prefetch_load_function(void const *key);
+//run 'gl' phases that are ready to go (e.g., of prefetched functions) for up to about 'budget' seconds; never waits for more to become ready:
+// (only call from the thread with the OpenGL context -- once a frame is typical; failures are kept for finish_load_function() to rethrow)
+void pump_load_functions(float budget = 0.002f);
+//finish loading the function registered with 'key'; blocks until done:
+// (only call from the thread with the OpenGL context; rethrows the error if this function -- or one it depends on -- failed to load)
+void finish_load_function(void const *key);
+
 
 //work-around for MSVC not accepting this as a lambda:
 template< typename T >
@@ -51,7 +121,9 @@ template< typename T >
 struct Load {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
 	Load(LoadTag tag, const std::function< T const *() > &load_fn = new_T< T >) : value(nullptr) {
-		add_load_function(tag, [this,load_fn](){
+		LoadInfo info(load_type_name(typeid(T)));
+		info.explicit_after = false;
+		add_load_function(tag, this, info, nullptr, [this,load_fn](){
 			this->value = load_fn();
 			if (!(this->value)) {
 				throw std::runtime_error("Loading failed.");
@@ -59,11 +131,65 @@ struct Load {
 		});
 	}
 
+	//Two-phase version: 'cpu_fn' returns some intermediate Data on a worker thread; 'gl_fn' turns it into a T on the OpenGL thread:
+	template< typename CPUFn, typename GLFn, typename = typename std::enable_if< !std::is_null_pointer< CPUFn >::value && !std::is_null_pointer< GLFn >::value >::type >
+	Load(LoadTag tag, LoadInfo const &info, CPUFn const &cpu_fn, GLFn const &gl_fn) : value(nullptr) {
+		typedef decltype(cpu_fn()) Data;
+		//intermediate data lives only until the gl phase has finished with it:
+		std::shared_ptr< std::unique_ptr< Data > > data = std::make_shared< std::unique_ptr< Data > >();
+		add_load_function(tag, this, info, [data,cpu_fn](){
+			data->reset(new Data(cpu_fn()));
+		}, [this,data,gl_fn,info](){
+			this->value = gl_fn(**data);
+			data->reset();
+			if (!(this->value)) {
+				throw std::runtime_error("Loading '" + info.name + "' failed.");
+			}
+		});
+	}
+
+	//GL-only version (e.g., for shader programs):
+	Load(LoadTag tag, LoadInfo const &info, std::nullptr_t, const std::function< T const *() > &gl_fn) : value(nullptr) {
+		add_load_function(tag, this, info, nullptr, [this,gl_fn,info](){
+			this->value = gl_fn();
+			if (!(this->value)) {
+				throw std::runtime_error("Loading '" + info.name + "' failed.");
+			}
+		});
+	}
+
+	//CPU-only version (for things that don't touch OpenGL at all):
+	// (result is handed over on the OpenGL thread so that 'value' is only ever written there)
+	Load(LoadTag tag, LoadInfo const &info, const std::function< T const *() > &cpu_fn, std::nullptr_t) : value(nullptr) {
+		std::shared_ptr< T const * > result = std::make_shared< T const * >(nullptr);
+		add_load_function(tag, this, info, [result,cpu_fn,info](){
+			*result = cpu_fn();
+			if (!(*result)) {
+				throw std::runtime_error("Loading '" + info.name + "' failed.");
+			}
+		}, [this,result](){
+			this->value = *result;
+		});
+	}
+
+	//load functions refer to 'this', so a Load< T > can't be copied:
+	Load(Load const &) = delete;
+
+	//Lazy loads: start the cpu phase in the background (no effect if already loaded):
+	void prefetch() {
+		if (!value) prefetch_load_function(this);
+	}
+	//Finish loading (if needed) and return the loaded value:
+	T const *get() {
+		if (!value) finish_load_function(this);
+		return value;
+	}
+
 	//Make a "Load< T >" behave like a "T const *":
-	explicit operator bool() { return value != nullptr; }
-	operator T const *() { return value; }
-	T const &operator*() { return *value; }
-	T const *operator->() { return value; }
+	explicit operator bool() { return get() != nullptr; }
+	operator T const *() { return get(); }
+	T const &operator*() { return *get(); }
+	T const *operator->() { return get(); }
 
 	T const *value;
 };
@@ -75,8 +201,23 @@ template< >
 struct Load< void > {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
 	Load( LoadTag tag, const std::function< void() > &load_fn) {
-		add_load_function(tag, load_fn);
+		LoadInfo info;
+		info.explicit_after = false;
+		add_load_function(tag, this, info, nullptr, load_fn);
 	}
-};
 
+	//Two-phase version (either function may be empty):
+	Load( LoadTag tag, LoadInfo const &info, const std::function< void() > &cpu_fn, const std::function< void() > &gl_fn) {
+		add_load_function(tag, this, info, cpu_fn, gl_fn);
+	}
 
+	Load(Load const &) = delete;
+
+	//Lazy loads: start in the background / finish loading (no effect if already loaded):
+	void prefetch() {
+		prefetch_load_function(this);
+	}
+	void finish() {
+		finish_load_function(this);
+	}
+};
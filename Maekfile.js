@@ -30,6 +30,7 @@ if (maek.OS === "windows") {
 		`/I${NEST_LIBS}/SDL2/include`,
 		`/I${NEST_LIBS}/glm/include`,
 		`/I${NEST_LIBS}/libpng/include`,
+		`/I${NEST_LIBS}/zlib/include`,
 		`/I${NEST_LIBS}/opusfile/include`,
 		`/I${NEST_LIBS}/libopus/include`,
 		`/I${NEST_LIBS}/libogg/include`,
@@ -60,6 +61,7 @@ if (maek.OS === "windows") {
 		`-I${NEST_LIBS}/SDL2/include/SDL2`, `-D_THREAD_SAFE`, //the output of sdl-config --cflags
 		`-I${NEST_LIBS}/glm/include`,
 		`-I${NEST_LIBS}/libpng/include`,
+		`-I${NEST_LIBS}/zlib/include`,
 		`-I${NEST_LIBS}/opusfile/include`,
 		`-I${NEST_LIBS}/libopus/include`,
 		`-I${NEST_LIBS}/libogg/include`,
@@ -84,6 +86,7 @@ if (maek.OS === "windows") {
 		`-I${NEST_LIBS}/SDL2/include/SDL2`, `-D_THREAD_SAFE`, //the output of sdl-config --cflags
 		`-I${NEST_LIBS}/glm/include`,
 		`-I${NEST_LIBS}/libpng/include`,
+		`-I${NEST_LIBS}/zlib/include`,
 		`-I${NEST_LIBS}/opusfile/include`,
 		`-I${NEST_LIBS}/libopus/include`,
 		`-I${NEST_LIBS}/libogg/include`,
@@ -128,15 +131,21 @@ if (maek.OS === 'windows') {
 // cppFile: name of c++ file to compile
 // objFileBase (optional): base name object file to produce (if not supplied, set to options.objDir + '/' + cppFile without the extension)
 //returns objFile: objFileBase + a platform-dependant suffix ('.o' or '.obj')
+const sound_names = [
+	maek.CPP('Sound.cpp'),
+	maek.CPP('mix_kernels.cpp'),
+	maek.CPP('adpcm.cpp'),
+	maek.CPP('mix_effects.cpp'),
+	maek.CPP('load_wav.cpp'),
+	maek.CPP('load_opus.cpp')
+];
+
 const game_names = [
 	maek.CPP('PlayMode.cpp'),
 	maek.CPP('main.cpp'),
 	maek.CPP('LitColorTextureProgram.cpp'),
-	maek.CPP('TexProgram.cpp'),
 	//maek.CPP('ColorTextureProgram.cpp'),  //not used right now, but you might want it
-	maek.CPP('Sound.cpp'),
-	maek.CPP('load_wav.cpp'),
-	maek.CPP('load_opus.cpp')
+	...sound_names
 ];
 
 const common_names = [
@@ -144,14 +153,27 @@ const common_names = [
 	maek.CPP('PathFont.cpp'),
 	maek.CPP('PathFont-font.cpp'),
 	maek.CPP('DrawLines.cpp'),
+	maek.CPP('StreamRing.cpp'),
 	maek.CPP('ColorProgram.cpp'),
+	maek.CPP('PathFontProgram.cpp'),
+	maek.CPP('WireBoxProgram.cpp'),
+	maek.CPP('WideLineProgram.cpp'),
+	maek.CPP('SpriteBatch.cpp'),
+	maek.CPP('SpriteProgram.cpp'),
+	maek.CPP('SdfFont.cpp'),
+	maek.CPP('SdfProgram.cpp'),
+	maek.CPP('TextShaper.cpp'),
 	maek.CPP('Scene.cpp'),
 	maek.CPP('Mesh.cpp'),
 	maek.CPP('load_save_png.cpp'),
 	maek.CPP('gl_compile_program.cpp'),
 	maek.CPP('Mode.cpp'),
 	maek.CPP('GL.cpp'),
-	maek.CPP('Load.cpp')
+	maek.CPP('Load.cpp'),
+	maek.CPP('AssetPack.cpp'),
+	maek.CPP('texture_cache.cpp'),
+	maek.CPP('texture_upload.cpp'),
+	maek.CPP('texture_atlas.cpp')
 ];
 
 const show_meshes_names = [
@@ -166,6 +188,29 @@ const show_scene_names = [
 	maek.CPP('ShowSceneMode.cpp')
 ];
 
+//offline tool that bundles dist/data/ into dist/data.pack:
+// (run as './pack-assets dist/data.pack dist data'; the game reads loose files if there is no pack)
+const pack_assets_names = [
+	maek.CPP('pack-assets.cpp')
+];
+
+//benchmark: serial vs. parallel texture loading (run as './texture-bench'):
+const texture_bench_names = [
+	maek.CPP('texture-bench.cpp')
+];
+
+//test: game-thread Sound calls never wait on the mixer (run as './sound-latency'):
+const sound_latency_names = [
+	maek.CPP('sound-latency.cpp'),
+	...sound_names
+];
+
+//benchmark: offline mixing, sweeping voice count / panning / looping (run as './sound-bench'):
+const sound_bench_names = [
+	maek.CPP('sound-bench.cpp'),
+	...sound_names
+];
+
 // const freetype_test_names = [
 // 	maek.CPP('freetype-test.cpp')
 // ];
@@ -177,11 +222,21 @@ const show_scene_names = [
 const game_exe = maek.LINK([...game_names, ...common_names], 'dist/game');
 const show_meshes_exe = maek.LINK([...show_meshes_names, ...common_names], 'scenes/show-meshes');
 const show_scene_exe = maek.LINK([...show_scene_names, ...common_names], 'scenes/show-scene');
+const pack_assets_exe = maek.LINK([...pack_assets_names], 'pack-assets');
+const texture_bench_exe = maek.LINK([...texture_bench_names, ...common_names], 'texture-bench');
+const sound_latency_exe = maek.LINK([...sound_latency_names, ...common_names], 'sound-latency');
+const sound_bench_exe = maek.LINK([...sound_bench_names, ...common_names], 'sound-bench');
 
 //const freetype_test_exe = maek.LINK([...freetype_test_names], 'freetype-test');
 
+//the '[target =] RUN(command, target [, options])' rule runs a command (that must succeed) whenever 'target' is built:
+// command: array of program + arguments (the program is usually an executable made by LINK)
+// target: abstract target name (starting with ':')
+//tests aren't built by default; run them with 'node Maekfile.js :test':
+const test_target = maek.RUN([sound_latency_exe, '--seconds', '2'], ':test');
+
 //set the default target to the game (and copy the readme files):
-maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, ...copies];
+maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, pack_assets_exe, texture_bench_exe, sound_latency_exe, sound_bench_exe, ...copies];
 
 //Note that tasks that produce ':abstract targets' are never cached.
 // This is similar to how .PHONY targets behave in make.
@@ -446,6 +501,32 @@ function init_maek() {
 	};
 
 
+	//maek.RUN runs a command every time an (abstract) target is built; fails if the command does:
+	// command is an array; its first element is the program (a file this build makes, or one in the path)
+	// target is the abstract target name (starting with ':')
+	maek.RUN = (command, target, localOptions = {}) => {
+		const options = combineOptions(localOptions);
+
+		if (target[0] !== ':') throw new Error(`RUN: target '${target}' should be abstract (start with ':').`);
+
+		const task = async () => {
+			//(programs made by this build are run from here rather than looked up in the path)
+			const program = (command[0] in maek.tasks ? require('path').resolve(command[0]) : command[0]);
+			await run([program, ...command.slice(1)], `${task.label}: run`);
+		};
+
+		task.depends = [...(command[0] in maek.tasks ? [command[0]] : []), ...options.depends];
+		task.label = `RUN ${target}`;
+
+		if (target in maek.tasks) {
+			throw new Error(`Task ${task.label} purports to create ${target}, but ${maek.tasks[target].label} already creates that target.`);
+		}
+		maek.tasks[target] = task;
+
+		return target;
+	};
+
+
 	//says something went wrong in building -- should fail loudly:
 	class BuildError extends Error {
 		constructor(message) {
@@ -1,5 +1,7 @@
 #include "Mesh.hpp"
 #include "read_write_chunk.hpp"
+#include "Load.hpp"
+#include "AssetPack.hpp"
 
 #include <glm/glm.hpp>
 
@@ -14,7 +16,7 @@
 MeshBuffer::MeshBuffer(std::string const &filename) {
 	glGenBuffers(1, &buffer);
 
-	std::ifstream file(filename, std::ios::binary);
+	AssetStream file(filename);
 
 	GLuint total = 0;
 
@@ -35,6 +37,7 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		glBindBuffer(GL_ARRAY_BUFFER, buffer);
 		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		load_report_gl_bytes(data.size() * sizeof(Vertex));
 
 		total = GLuint(data.size()); //store total for later checks on index
 
@@ -1595,5 +1595,41 @@ namespace {
 		0.357675f, 0.546999f, 0.357675f, 0.546999f, 0.380799f, 0.530776f,
 		0.380799f, 0.530776f, 0.407815f, 0.504100f
 	};
+	constexpr const PathFont::TrieNode font_trie[96] = {
+		{-1U, 0, 32, 95}, {0, 0, 0, 0}, {1, 0, 0, 0}, {2, 0, 0, 0},
+		{3, 0, 0, 0}, {4, 0, 0, 0}, {5, 0, 0, 0}, {6, 0, 0, 0},
+		{7, 0, 0, 0}, {8, 0, 0, 0}, {9, 0, 0, 0}, {10, 0, 0, 0},
+		{11, 0, 0, 0}, {12, 0, 0, 0}, {13, 0, 0, 0}, {14, 0, 0, 0},
+		{15, 0, 0, 0}, {16, 0, 0, 0}, {17, 0, 0, 0}, {18, 0, 0, 0},
+		{19, 0, 0, 0}, {20, 0, 0, 0}, {21, 0, 0, 0}, {22, 0, 0, 0},
+		{23, 0, 0, 0}, {24, 0, 0, 0}, {25, 0, 0, 0}, {26, 0, 0, 0},
+		{27, 0, 0, 0}, {28, 0, 0, 0}, {29, 0, 0, 0}, {30, 0, 0, 0},
+		{31, 0, 0, 0}, {32, 0, 0, 0}, {33, 0, 0, 0}, {34, 0, 0, 0},
+		{35, 0, 0, 0}, {36, 0, 0, 0}, {37, 0, 0, 0}, {38, 0, 0, 0},
+		{39, 0, 0, 0}, {40, 0, 0, 0}, {41, 0, 0, 0}, {42, 0, 0, 0},
+		{43, 0, 0, 0}, {44, 0, 0, 0}, {45, 0, 0, 0}, {46, 0, 0, 0},
+		{47, 0, 0, 0}, {48, 0, 0, 0}, {49, 0, 0, 0}, {50, 0, 0, 0},
+		{51, 0, 0, 0}, {52, 0, 0, 0}, {53, 0, 0, 0}, {54, 0, 0, 0},
+		{55, 0, 0, 0}, {56, 0, 0, 0}, {57, 0, 0, 0}, {58, 0, 0, 0},
+		{59, 0, 0, 0}, {60, 0, 0, 0}, {61, 0, 0, 0}, {62, 0, 0, 0},
+		{63, 0, 0, 0}, {64, 0, 0, 0}, {65, 0, 0, 0}, {66, 0, 0, 0},
+		{67, 0, 0, 0}, {68, 0, 0, 0}, {69, 0, 0, 0}, {70, 0, 0, 0},
+		{71, 0, 0, 0}, {72, 0, 0, 0}, {73, 0, 0, 0}, {74, 0, 0, 0},
+		{75, 0, 0, 0}, {76, 0, 0, 0}, {77, 0, 0, 0}, {78, 0, 0, 0},
+		{79, 0, 0, 0}, {80, 0, 0, 0}, {81, 0, 0, 0}, {82, 0, 0, 0},
+		{83, 0, 0, 0}, {84, 0, 0, 0}, {85, 0, 0, 0}, {86, 0, 0, 0},
+		{87, 0, 0, 0}, {88, 0, 0, 0}, {89, 0, 0, 0}, {90, 0, 0, 0},
+		{91, 0, 0, 0}, {92, 0, 0, 0}, {93, 0, 0, 0}, {94, 0, 0, 0}
+	};
+	constexpr const uint32_t font_trie_children[95] = {
+		1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+		13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+		25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
+		37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48,
+		49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60,
+		61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72,
+		73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84,
+		85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95
+	};
 }
-PathFont PathFont::font(font_glyphs, font_glyph_widths, font_glyph_char_starts, font_chars, font_glyph_coord_starts, font_coords);
+PathFont PathFont::font(font_glyphs, font_glyph_widths, font_glyph_char_starts, font_chars, font_glyph_coord_starts, font_coords, font_trie, font_trie_children);
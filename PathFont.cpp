@@ -3,22 +3,33 @@
 
 #include "PathFont.hpp"
 
-#include <iostream>
-
 PathFont::PathFont(uint32_t glyphs_,
 	const float *glyph_widths_,
 	const uint32_t *glyph_char_starts_, const uint8_t *chars_,
-	const uint32_t *glyph_coord_starts_, const float *coords_
+	const uint32_t *glyph_coord_starts_, const float *coords_,
+	const TrieNode *trie_, const uint32_t *trie_children_
 	) : glyphs(glyphs_),
 		glyph_widths(glyph_widths_),
 		glyph_char_starts(glyph_char_starts_), chars(chars_),
-		glyph_coord_starts(glyph_coord_starts_), coords(coords_) {
+		glyph_coord_starts(glyph_coord_starts_), coords(coords_),
+		trie(trie_), trie_children(trie_children_) {
+	//(duplicate glyph names are caught by make-PathFont-font.py, which builds the trie)
+}
 
-	for (uint32_t i = 0; i < glyphs; ++i) {
-		std::string str(reinterpret_cast< const char * >(chars + glyph_char_starts[i]), reinterpret_cast< const char * >(chars + glyph_char_starts[i+1]));
-		auto res = glyph_map.insert(std::make_pair(str, i));
-		if (!res.second) {
-			std::cerr << "WARNING: ignoring duplicate glyph for '" << str << "'." << std::endl;
+uint32_t PathFont::match(char const *begin, char const *end, uint32_t *length) const {
+	uint32_t glyph = -1U;
+	*length = 0;
+	uint32_t node = 0;
+	for (char const *at = begin; at < end; ++at) {
+		TrieNode const &n = trie[node];
+		uint32_t byte = uint8_t(*at);
+		if (byte < n.first || byte - n.first >= n.count) break;
+		node = trie_children[n.children + (byte - n.first)];
+		if (node == 0) break;
+		if (trie[node].glyph != -1U) {
+			glyph = trie[node].glyph;
+			*length = uint32_t(at + 1 - begin);
 		}
 	}
+	return glyph;
 }
@@ -12,14 +12,21 @@
 
 #include <string>
 #include <vector>
-#include <map>
 
 struct PathFont {
+	//lookup trie over the glyphs' (UTF-8) names, generated along with the font (see make-PathFont-font.py):
+	struct TrieNode {
+		uint32_t glyph; //glyph whose name ends at this node (or -1U)
+		uint32_t children; //index into 'trie_children' of the child for byte 'first'
+		uint16_t first, count; //bytes first .. first+count-1 may have children (0 in trie_children means "no child")
+	};
+
 	//meant to be intitialized with some pointers to constant data:
 	PathFont(uint32_t glyphs,
 		const float *glyph_widths,
 		const uint32_t *glyph_char_starts, const uint8_t *chars,
-		const uint32_t *glyph_coord_starts, const float *coords
+		const uint32_t *glyph_coord_starts, const float *coords,
+		const TrieNode *trie, const uint32_t *trie_children
 		);
 	const uint32_t glyphs = 0;
 	const float *glyph_widths = nullptr;
@@ -30,10 +37,13 @@ struct PathFont {
 	const uint32_t *glyph_coord_starts = nullptr; //indices into 'coords' table
 	const float *coords = nullptr;
 
-	//computed in constructor:
-	std::map< std::string, uint32_t > glyph_map;
+	const TrieNode *trie = nullptr; //trie[0] is the root
+	const uint32_t *trie_children = nullptr;
+
+	//glyph with the longest name that starts 'begin .. end' (or -1U if none), and that name's length in bytes:
+	// (no allocation, and one array index per byte)
+	uint32_t match(char const *begin, char const *end, uint32_t *length) const;
 
 	//the default font:
 	static PathFont font;
 };
-
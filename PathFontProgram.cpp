@@ -0,0 +1,51 @@
+#include "PathFontProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+//only DrawLines uses this, so it is compiled the first time text is drawn:
+Load< PathFontProgram > path_font_program(LoadTagEarly, LoadInfo("PathFontProgram", {}, LoadLazy), nullptr, new_T< PathFontProgram >);
+
+PathFontProgram::PathFontProgram() {
+	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"in vec2 Position;\n"
+		"in vec3 Anchor;\n"
+		"in vec3 X;\n"
+		"in vec3 Y;\n"
+		"in vec4 Color;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	gl_Position = OBJECT_TO_CLIP * vec4(Anchor + Position.x * X + Position.y * Y, 1.0);\n"
+		"	color = Color;\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"in vec4 color;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragColor = color;\n"
+		"}\n"
+	);
+
+	//look up the locations of vertex attributes:
+	Position_vec2 = glGetAttribLocation(program, "Position");
+	Anchor_vec3 = glGetAttribLocation(program, "Anchor");
+	X_vec3 = glGetAttribLocation(program, "X");
+	Y_vec3 = glGetAttribLocation(program, "Y");
+	Color_vec4 = glGetAttribLocation(program, "Color");
+
+	//look up the locations of uniforms:
+	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+
+	GL_ERRORS();
+}
+
+PathFontProgram::~PathFontProgram() {
+	glDeleteProgram(program);
+	program = 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Load.hpp"
+
+//Shader program that draws instances of PathFont glyphs (see DrawLines::draw_text):
+// each vertex is a point in the glyph's (x, y) coordinates; each instance places a glyph.
+struct PathFontProgram {
+	PathFontProgram();
+	~PathFontProgram();
+
+	GLuint program = 0;
+	//Attribute (per-vertex variable) locations:
+	GLuint Position_vec2 = -1U;
+	//Attribute (per-instance variable) locations:
+	GLuint Anchor_vec3 = -1U; //where the glyph's origin goes
+	GLuint X_vec3 = -1U; //...and its x and y axes
+	GLuint Y_vec3 = -1U;
+	GLuint Color_vec4 = -1U;
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+	//Textures:
+	// none
+};
+
+extern Load< PathFontProgram > path_font_program;
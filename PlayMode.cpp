@@ -1,29 +1,29 @@
 #include "PlayMode.hpp"
 
 #include "LitColorTextureProgram.hpp"
-#include "TexProgram.hpp"
 
 #include "DrawLines.hpp"
+#include "SpriteBatch.hpp"
+#include "TextShaper.hpp"
+#include "SdfFont.hpp"
 #include "Mesh.hpp"
 #include "Load.hpp"
 #include "gl_errors.hpp"
 #include "data_path.hpp"
 
-#include "load_save_png.hpp"
+#include "texture_atlas.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 #include <random>
 
 std::vector<std::string> dialogs;
 std::vector<std::string> keys_acquired;
-std::vector<GLuint> char_vaos;
 float dialog_time = 0.0f;
 
-GLuint image_vao = 0;
-GLuint font_tex = 0;
-GLuint scenes[20];
-
 struct Door;
 struct Interactable;
 
@@ -115,146 +115,66 @@ struct Interactable {
     }
 };
 
-GLuint gen_texture(std::string tex) {
-    GLuint i = 0;
-    glGenTextures(1, &i);
-    glm::uvec2 size;
-    std::vector<glm::u8vec4> data;
-    load_png(data_path(tex), &size, &data, LowerLeftOrigin);
-
-    glBindTexture(GL_TEXTURE_2D, i);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    GL_ERRORS();
-
-    return i;
-}
-
-// Inspired by Jim McCann's message in the course Discord on how to create a textured quad:
-// https://discord.com/channels/1144815260629479486/1154543452520984686/1156347836888256582
-
-// Generates a model and vao for a texture
-GLuint gen_image(glm::vec2 pos, glm::vec2 size, float u1, float v1, float u2, float v2) {
-    GLuint vao = 0;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    Load<TexProgram> &program = tex_program;
-    glUseProgram(program->program);
-
-    GLuint coord_buf = 0;
-    glGenBuffers(1, &coord_buf);
-    std::vector<glm::vec3> positions;
-
-    positions.emplace_back(glm::vec3(pos.x, pos.y, 0.0f));
-    positions.emplace_back(glm::vec3(pos.x + size.x, pos.y, 0.0f));
-    positions.emplace_back(glm::vec3(pos.x + size.x, pos.y + size.y, 0.0f));
-    positions.emplace_back(glm::vec3(pos.x, pos.y + size.y, 0.0f));
-
-    glBindBuffer(GL_ARRAY_BUFFER, coord_buf);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * 3 * 4, positions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(program->Position_vec4, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(program->Position_vec4);
-
-    GLuint tex_buf = 0;
-    glGenBuffers(1, &tex_buf);
-    std::vector<glm::vec2> tex_coords;
-
-    tex_coords.emplace_back(glm::vec2(u1, v1));
-    tex_coords.emplace_back(glm::vec2(u2, v1));
-    tex_coords.emplace_back(glm::vec2(u2, v2));
-    tex_coords.emplace_back(glm::vec2(u1, v2));
-
-    glBindBuffer(GL_ARRAY_BUFFER, tex_buf);
-    glBufferData(GL_ARRAY_BUFFER, tex_coords.size() * 2 * 4, tex_coords.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(program->TexCoord_vec2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(program->TexCoord_vec2);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
-
-    GL_ERRORS();
-
-    return vao;
-}
+//Every image PlayMode draws lives in one texture array, so a frame only binds one texture:
+// backgrounds each fill a layer; the dialog box and the small scene6 background are packed into the rest
+// (only the current area's background is needed to draw a frame, so those load lazily)
+Load<TextureAtlas> textures = load_texture_atlas(LoadTagDefault, "PlayMode textures", glm::uvec2(1280, 720), {
+    {"dialog", "data/dialog.png"},
+    {"scene1", "data/scene1.png", LoadLazy},
+    {"scene2", "data/scene2.png", LoadLazy},
+    {"scene3", "data/scene3.png", LoadLazy},
+    {"scene4", "data/scene4.png", LoadLazy},
+    {"scene5", "data/scene5.png", LoadLazy},
+    {"scene6", "data/scene6.png", LoadLazy},
+    {"scene7", "data/scene7.png", LoadLazy},
+    {"scene8", "data/scene8.png", LoadLazy},
+});
 
-void draw_image(GLuint image, GLuint tex, glm::vec4 color, float x, float y, float x_scale, float y_scale) {
-    glUseProgram(tex_program->program);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBindVertexArray(image);
-
-    glUniformMatrix4fv(tex_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(glm::mat4(x_scale, 0.0f, 0.0f, 0.0f,  0.0f, y_scale, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  x, y, 0.0f, 1.0f)));
-    glUniform4f(tex_program->COLOR_vec4, color.x, color.y, color.z, color.w);
-
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-    GL_ERRORS();
-
-    glBindVertexArray(0);
-    glDisable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    GL_ERRORS();
+std::string scene_region(int texture) {
+    return "scene" + std::to_string(texture + 1);
 }
 
-float char_widths[] = {32.5156f, 26.0312f, 38.2344f, 72.9531f, 53.125f, 86.625f, 65.8281f,21.2344f,42.7188f, 42.7188f, 54.25f, 53.9062f, 19.2031f, 57.125f,20.5156f, 63.9219f,
-                       91.7031f, 35.4531f, 75.25f, 71.9219f, 77.3438f,75.0469f, 73.2031f, 62.75f, 74.125f, 74.4219f, 24.3125f, 25.1406f,52.5469f, 59.125f, 52.5469f, 66.5469f,
-                       66.1094f, 83.4531f, 80.9062f,74.7031f, 82.3281f, 75.5312f, 73.8281f, 82.3281f, 84.9062f, 27.6406f,73.4375f, 81.3438f, 73.6406f, 96.2344f, 84.7188f, 86.0312f,
-                       80.6094f,86.0312f, 82.7188f, 77.0938f, 72.6094f, 83.3438f, 77.25f, 100.25f,78.7188f, 78.125f, 71.3438f, 36.5312f, 65.9219f, 36.5312f, 43.0156f,68.1094f,
-                       55.7188f, 65.3281f, 69.0469f, 61.2344f, 70.0156f, 65.3281f,54.7812f, 69.0469f, 70.3125f, 25.0469f, 25.0469f, 69.1406f, 31.3438f,87.3594f, 69.625f, 68.2188f,
-                       69.0469f, 69.0469f, 54.5469f, 59.0312f,56.3438f, 69.625f, 67.5312f, 91.3125f, 69.1406f, 70.3125f, 60.1094f,42.4375f, 26.0312f, 42.4375f, 63.3281f};
-
-void draw_string(std::string text, glm::vec4 color, float x, float y, float x_scale, float y_scale) {
-    float advance = 0.0f;
-    int count = 0;
-    for (char c: text) {
-       if (count > dialog_time)
-           return;
-
-       draw_image(char_vaos[c - 32], font_tex, color, x + advance / 48.0f * x_scale, y, x_scale, y_scale);
-       advance += char_widths[c - 32];
-       count++;
-    }
+//queues 'region' of the texture array onto the [-1,1]^2 square scaled by (x_scale, y_scale) and moved to (x, y):
+void draw_image(SpriteBatch &sprites, TextureAtlas::Region const &region, glm::vec4 color, float x, float y, float x_scale, float y_scale) {
+    sprites.draw(textures->texture, region, glm::vec2(x - x_scale, y - y_scale), glm::vec2(x + x_scale, y + y_scale), glm::u8vec4(glm::round(glm::clamp(color, 0.0f, 1.0f) * 255.0f)));
 }
 
-void gen_chars()
-{
-    for (int i = 0; i < 95; i++)
-    {
-        GLuint vao = gen_image(glm::vec2(-1.0f, -1.0f), glm::vec2(2.0f, 2.0f), (i % 32) / 32.0f, 1.0f - (i / 32 + 1) / 4.0f, ((i % 32) + 1) / 32.0f, 1.0f - (i / 32) / 4.0f);
-        char_vaos.emplace_back(vao);
+//dialog text is shaped at runtime (so any text the font covers works) and drawn from signed distance fields;
+// if the .ttf can't be opened, it falls back to the prebuilt atlas in font.sdf (one glyph per byte, kerned with the pairs fontmap --sdf packed):
+struct DialogFont {
+    std::unique_ptr<TextShaper> shaper;
+    std::unique_ptr<SdfFont> atlas; //(only used if there is no shaper)
+};
+Load<DialogFont> dialog_font(LoadTagDefault, LoadInfo("dialog font"), []() {
+    DialogFont font;
+    try {
+        font.shaper.reset(new TextShaper(data_path("data/Audiowide-Regular.ttf")));
+    } catch (std::exception &e) {
+        std::cerr << "WARNING: " << e.what() << "\n  (falling back to data/font.sdf for dialog text)" << std::endl;
+        font.atlas = SdfFont::read(data_path("data/font.sdf"));
     }
-}
+    return font;
+}, [](DialogFont &font) -> DialogFont const * {
+    if (font.shaper) font.shaper->upload();
+    else font.atlas->upload();
+    return new DialogFont(std::move(font));
+});
 
-Load< Scene > empty_scene(LoadTagDefault, []() -> Scene const * {
+//scene loading doesn't touch OpenGL, so it can happen entirely on a worker thread:
+Load< Scene > empty_scene(LoadTagDefault, LoadInfo("data/emptyscene.scene"), []() -> Scene const * {
     Scene* s = new Scene(data_path("data/emptyscene.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name){});
     return s;
-});
+}, nullptr);
 
-GLuint dialog_tex;
 PlayMode::PlayMode() : scene(*empty_scene) {
 	//get pointer to camera for convenience:
 	if (scene.cameras.size() != 1) throw std::runtime_error("Expecting scene to have exactly one camera, but it has " + std::to_string(scene.cameras.size()));
 	camera = &scene.cameras.front();
 
-    gen_chars();
-    image_vao = gen_image(glm::vec2(-1.0f, -1.0f), glm::vec2(2.0f, 2.0f), 0.0f, 0.0f, 1.0f, 1.0f);
-    font_tex = gen_texture("data/font.png");
-    dialog_tex = gen_texture("data/dialog.png");
-
-    for (int i = 0; i < 8; i++)
-    {
-        std::string s = "data/scene";
-        s += std::to_string(i + 1);
-        s += ".png";
-        scenes[i] = gen_texture(s);
+
+    //start decoding backgrounds in the background; draw() finishes whichever one it needs:
+    for (int i = 0; i < 8; i++) {
+        textures->prefetch(scene_region(i));
     }
 
     Area* a0 = new Area(0, std::vector<std::string>(), std::vector<std::string>());
@@ -311,8 +231,11 @@ PlayMode::~PlayMode() {
 bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
 	if (evt.type == SDL_MOUSEBUTTONDOWN){
         if (dialogs.size() > 0){
-            if (dialog_time < dialogs.begin()->length())
-                dialog_time = (float) (dialogs.begin()->length());
+            //(lines are revealed a glyph at a time; once a line has been drawn, its glyph count is known)
+            uint32_t laid_out = (dialog_font->shaper ? dialog_text.count() : dialog_atlas_text.count);
+            uint32_t glyphs = (dialog_line == dialogs[0] ? laid_out : uint32_t(dialogs[0].length()));
+            if (dialog_time < glyphs)
+                dialog_time = (float) glyphs;
             else {
                 dialogs.erase(dialogs.begin());
                 dialog_time = 0;
@@ -385,13 +308,38 @@ void PlayMode::update(float elapsed) {
     dialog_time += elapsed * 20.0f;
 }
 
-void draw_dialog() {
-    if (!dialogs.empty()) {
-        std::string s = dialogs[0];
-        draw_image(image_vao, dialog_tex, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), -1.0f, -0.75f, 2.0f, 0.25f);
-        draw_string(s, glm::vec4(0.9f, 0.8f, 1.0f, 1.0f), -0.9f, -0.75f, 0.025f, 0.1f);
-    } else
+void PlayMode::draw_dialog(SpriteBatch &sprites) {
+    if (dialogs.empty()) return;
+    draw_image(sprites, textures->get("dialog"), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), -1.0f, -0.75f, 2.0f, 0.25f);
+    //(text goes on top, so it is drawn by draw_dialog_text() after 'sprites' is flushed)
+}
+
+void PlayMode::draw_dialog_text(glm::uvec2 const &drawable_size) {
+    if (dialogs.empty()) {
         dialog_time = 0.0f;
+        return;
+    }
+    //(em is 100 pixels of the old 100x200 glyph cells, which were drawn 0.05 x 0.2 and advanced by width / 48 * 0.025)
+    glm::vec2 em = glm::vec2(100.0f / 48.0f * 0.025f, 0.1f);
+    float size = std::max(1.0f, std::round(em.y * 0.5f * drawable_size.y)); //(pixels per em on screen)
+    //lay out each line once (shaping a line seen before is just a cache lookup), then reveal it a glyph at a time by drawing more of its quads:
+    if (dialog_line != dialogs[0] || dialog_size != size) {
+        dialog_line = dialogs[0];
+        dialog_size = size;
+        //(centered vertically on the dialog box's text line, as the glyph cells were)
+        if (dialog_font->shaper) {
+            TextShaper const &shaper = *dialog_font->shaper;
+            float baseline = -0.75f - 0.5f * (shaper.ascender + shaper.descender) * em.y;
+            dialog_text.set(shaper, dialog_line, size, glm::vec2(-0.925f, baseline), em);
+        } else {
+            SdfFont const &atlas = *dialog_font->atlas; //(metrics in atlas pixels, not ems)
+            float baseline = -0.75f - 0.5f * (atlas.ascender + atlas.descender) / atlas.em_size * em.y;
+            dialog_atlas_text.set(atlas, dialog_line, glm::vec2(-0.925f, baseline), em);
+        }
+    }
+    glm::vec4 color = glm::vec4(0.9f, 0.8f, 1.0f, 1.0f);
+    if (dialog_font->shaper) dialog_text.draw(glm::mat4(1.0f), color, uint32_t(dialog_time) + 1);
+    else dialog_atlas_text.draw(glm::mat4(1.0f), color, uint32_t(dialog_time) + 1);
 }
 
 void PlayMode::draw(glm::uvec2 const &drawable_size) {
@@ -413,9 +361,12 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS); //this is the default depth comparison function, but FYI you can change it.
 
-    draw_image(image_vao, scenes[current_area->texture], glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), 0.0f, 0.0f, 1.0f, 1.0f);
-    draw_dialog();
-    //draw_image(image_vao, font_tex, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f), 0.1f, 0.1f, 0.1f, 0.1f);
+    { //the background and dialog box are drawn from the one texture array, so this is a single draw call:
+        SpriteBatch sprites(glm::mat4(1.0f));
+        draw_image(sprites, textures->get(scene_region(current_area->texture)), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), 0.0f, 0.0f, 1.0f, 1.0f);
+        draw_dialog(sprites);
+    }
+    draw_dialog_text(drawable_size);
 
 	GL_ERRORS();
 }
@@ -2,9 +2,12 @@
 
 #include "Scene.hpp"
 #include "Sound.hpp"
+#include "SpriteBatch.hpp"
+#include "TextShaper.hpp"
 
 #include <glm/glm.hpp>
 
+#include <string>
 #include <vector>
 #include <deque>
 
@@ -31,4 +34,14 @@ struct PlayMode : Mode {
 	//camera:
 	Scene::Camera *camera = nullptr;
 
+	//----- dialog drawing -----
+	void draw_dialog(SpriteBatch &sprites);
+	void draw_dialog_text(glm::uvec2 const &drawable_size);
+
+	//the dialog line (and the size, in pixels per em) currently laid out in dialog_text:
+	std::string dialog_line;
+	float dialog_size = 0.0f;
+	ShapedText dialog_text;
+	SdfText dialog_atlas_text; //(used instead if the dialog font fell back to font.sdf)
+
 };
@@ -2,6 +2,7 @@
 
 #include "gl_errors.hpp"
 #include "read_write_chunk.hpp"
+#include "AssetPack.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
@@ -169,7 +170,7 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 void Scene::load(std::string const &filename,
 	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
 
-	std::ifstream file(filename, std::ios::binary);
+	AssetStream file(filename);
 
 	std::vector< char > names;
 	read_chunk(file, "str0", &names);
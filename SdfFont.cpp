@@ -0,0 +1,197 @@
+#include "SdfFont.hpp"
+#include "SdfProgram.hpp"
+#include "AssetPack.hpp"
+
+#include "gl_errors.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+std::unique_ptr< SdfFont > SdfFont::read(std::string const &filename) {
+	AssetView view = asset_view(filename);
+	char const *at = view.data;
+	char const *end = view.data + view.size;
+	auto take = [&](void *dst, size_t bytes) {
+		if (size_t(end - at) < bytes) throw std::runtime_error("SDF font '" + filename + "' is truncated.");
+		std::memcpy(dst, at, bytes);
+		at += bytes;
+	};
+
+	FileHeader header;
+	take(&header, sizeof(header));
+	if (std::memcmp(header.magic, "sdf0", 4) != 0) throw std::runtime_error("File '" + filename + "' is not an SDF font.");
+	if (header.version != 2) throw std::runtime_error("SDF font '" + filename + "' has unsupported version " + std::to_string(header.version) + ".");
+	if (header.atlas_width == 0 || header.atlas_height == 0 || !(header.em_size > 0.0f)) throw std::runtime_error("SDF font '" + filename + "' has an empty atlas.");
+
+	std::unique_ptr< SdfFont > font(new SdfFont);
+	font->em_size = header.em_size;
+	font->spread = header.spread;
+	font->ascender = header.ascender;
+	font->descender = header.descender;
+	font->line_height = header.line_height;
+	font->atlas_size = glm::uvec2(header.atlas_width, header.atlas_height);
+
+	glm::vec2 atlas_size = glm::vec2(font->atlas_size);
+	font->glyphs.reserve(header.glyph_count);
+	for (uint32_t i = 0; i < header.glyph_count; ++i) {
+		FileGlyph fg;
+		take(&fg, sizeof(fg));
+		if (uint32_t(fg.x) + fg.width > header.atlas_width || uint32_t(fg.y) + fg.height > header.atlas_height) {
+			throw std::runtime_error("SDF font '" + filename + "' has a glyph outside its atlas.");
+		}
+		Glyph glyph;
+		glyph.advance = fg.advance;
+		if (fg.width != 0 && fg.height != 0) {
+			glyph.min = glm::vec2(fg.left, fg.bottom);
+			glyph.max = glyph.min + glm::vec2(fg.width, fg.height);
+			glyph.tex_min = glm::vec2(fg.x, fg.y) / atlas_size;
+			glyph.tex_max = glm::vec2(fg.x + fg.width, fg.y + fg.height) / atlas_size;
+		}
+		font->codepoint_to_glyph.emplace(fg.codepoint, uint32_t(font->glyphs.size()));
+		font->glyphs.emplace_back(glyph);
+	}
+	if (font->glyphs.empty()) throw std::runtime_error("SDF font '" + filename + "' has no glyphs.");
+	auto f = font->codepoint_to_glyph.find('?');
+	if (f != font->codepoint_to_glyph.end()) font->fallback = f->second;
+
+	font->kerning.reserve(header.kerning_count);
+	for (uint32_t i = 0; i < header.kerning_count; ++i) {
+		FileKerning fk;
+		take(&fk, sizeof(fk));
+		font->kerning[uint64_t(fk.left) << 32 | fk.right] = fk.adjust;
+	}
+
+	font->atlas.resize(size_t(header.atlas_width) * header.atlas_height);
+	take(font->atlas.data(), font->atlas.size());
+
+	return font;
+}
+
+void SdfFont::upload() {
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); //(rows are bytes, so may not be 4-aligned)
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlas_size.x, atlas_size.y, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	//(distances interpolate, so linear filtering keeps edges smooth at any scale)
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GL_ERRORS();
+
+	load_report_gl_bytes(atlas.size());
+	atlas = std::vector< uint8_t >();
+}
+
+SdfFont::Glyph const &SdfFont::glyph(uint32_t codepoint) const {
+	auto f = codepoint_to_glyph.find(codepoint);
+	return glyphs[f != codepoint_to_glyph.end() ? f->second : fallback];
+}
+
+float SdfFont::kern(uint32_t left, uint32_t right) const {
+	auto f = kerning.find(uint64_t(left) << 32 | right);
+	return (f != kerning.end() ? f->second : 0.0f);
+}
+
+SdfText::~SdfText() {
+	glDeleteVertexArrays(1, &vao);
+	vao = 0;
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void SdfText::set(SdfFont const &font, std::string const &text, glm::vec2 const &origin, glm::vec2 const &em) {
+	glm::vec2 scale = em / font.em_size;
+
+	//two triangles per character (blank ones too, so the n'th glyph is the n'th character):
+	std::vector< Vertex > attribs;
+	attribs.reserve(text.size() * 6);
+	glm::vec2 pen = origin;
+	for (size_t i = 0; i < text.size(); ++i) {
+		if (i > 0) pen.x += font.kern(uint8_t(text[i-1]), uint8_t(text[i])) * scale.x;
+		SdfFont::Glyph const &glyph = font.glyph(uint8_t(text[i]));
+		glm::vec2 min = pen + glyph.min * scale;
+		glm::vec2 max = pen + glyph.max * scale;
+		Vertex v00(glm::vec2(min.x, min.y), glm::vec2(glyph.tex_min.x, glyph.tex_min.y));
+		Vertex v10(glm::vec2(max.x, min.y), glm::vec2(glyph.tex_max.x, glyph.tex_min.y));
+		Vertex v11(glm::vec2(max.x, max.y), glm::vec2(glyph.tex_max.x, glyph.tex_max.y));
+		Vertex v01(glm::vec2(min.x, max.y), glm::vec2(glyph.tex_min.x, glyph.tex_max.y));
+		attribs.insert(attribs.end(), {v00, v10, v11, v00, v11, v01});
+		pen.x += glyph.advance * scale.x;
+	}
+	set(font.texture, attribs, pen.x - origin.x);
+}
+
+void SdfText::set(GLuint texture_, std::vector< Vertex > const &attribs, float width_) {
+	assert(attribs.size() % 6 == 0);
+	texture = texture_;
+	width = width_;
+	count = uint32_t(attribs.size() / 6);
+	if (attribs.empty()) return;
+
+	if (!buffer) {
+		glGenBuffers(1, &buffer);
+
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glVertexAttribPointer(
+			sdf_program->Position_vec4, //attribute
+			2, //size
+			GL_FLOAT, //type
+			GL_FALSE, //normalized
+			sizeof(Vertex), //stride
+			(GLbyte *)0 + offsetof(Vertex, Position) //offset
+		);
+		glEnableVertexAttribArray(sdf_program->Position_vec4);
+		glVertexAttribPointer(
+			sdf_program->TexCoord_vec2, //attribute
+			2, //size
+			GL_FLOAT, //type
+			GL_FALSE, //normalized
+			sizeof(Vertex), //stride
+			(GLbyte *)0 + offsetof(Vertex, TexCoord) //offset
+		);
+		glEnableVertexAttribArray(sdf_program->TexCoord_vec2);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, attribs.size() * sizeof(attribs[0]), attribs.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	GL_ERRORS();
+}
+
+void SdfText::draw(glm::mat4 const &world_to_clip, glm::vec4 const &color, uint32_t first_count) const {
+	uint32_t n = std::min(count, first_count);
+	if (n == 0) return;
+
+	glUseProgram(sdf_program->program);
+	glUniformMatrix4fv(sdf_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+	glUniform4fv(sdf_program->COLOR_vec4, 1, glm::value_ptr(color));
+	glBindVertexArray(vao);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glDrawArrays(GL_TRIANGLES, 0, GLsizei(n * 6));
+
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	GL_ERRORS();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+/*
+ * Signed distance field fonts, as written by assetpipeline/fontmap --sdf.
+ *
+ * The atlas stores each glyph's distance to its outline (rendered once at
+ * em_size pixels per em) in a single channel, so one small texture draws
+ * crisp text at any size.
+ *
+ * SdfText is a line of text laid out once into a vertex buffer; drawing it
+ * is one draw call, and drawing only its first few glyphs is free.
+ *
+ * Load< SdfFont > font(LoadTagDefault, LoadInfo("data/font.sdf"), [](){
+ *     return SdfFont::read(data_path("data/font.sdf"));
+ * }, [](std::unique_ptr< SdfFont > &font) -> SdfFont const * {
+ *     font->upload();
+ *     return font.release();
+ * });
+ */
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct SdfFont {
+	//file layout (all little-endian; written by assetpipeline/sdf.c; glyphs are skyline-packed into the atlas):
+	struct FileHeader {
+		char magic[4]; //"sdf0"
+		uint32_t version;
+		uint32_t glyph_count;
+		uint16_t atlas_width, atlas_height;
+		float em_size; //pixels per em that glyphs were rendered at (all lengths are in these pixels)
+		float spread; //distance (in pixels) at which the field reaches 0 or 255
+		float ascender, descender, line_height;
+		uint32_t kerning_count;
+	};
+	static_assert(sizeof(FileHeader) == 4 + 4 + 4 + 2 + 2 + 5 * 4 + 4, "SdfFont::FileHeader is packed.");
+	struct FileGlyph {
+		uint32_t codepoint;
+		float advance;
+		int16_t left, bottom; //box corner relative to the pen (y up)
+		uint16_t x, y, width, height; //box in the atlas (rows counted from the bottom)
+	};
+	static_assert(sizeof(FileGlyph) == 4 + 4 + 2 * 2 + 4 * 2, "SdfFont::FileGlyph is packed.");
+	struct FileKerning {
+		uint32_t left, right;
+		float adjust; //added to left's advance when right follows it
+	};
+	static_assert(sizeof(FileKerning) == 4 + 4 + 4, "SdfFont::FileKerning is packed.");
+	//...followed by atlas_width * atlas_height bytes of atlas, bottom row first
+
+	struct Glyph {
+		float advance = 0.0f;
+		glm::vec2 min = glm::vec2(0.0f), max = glm::vec2(0.0f); //box relative to the pen (empty for blank glyphs)
+		glm::vec2 tex_min = glm::vec2(0.0f), tex_max = glm::vec2(0.0f); //box in the atlas, in texture coordinates
+	};
+
+	float em_size = 0.0f;
+	float spread = 0.0f;
+	float ascender = 0.0f, descender = 0.0f, line_height = 0.0f;
+
+	std::vector< Glyph > glyphs;
+	std::unordered_map< uint32_t, uint32_t > codepoint_to_glyph;
+	uint32_t fallback = 0; //glyph for codepoints that aren't in the font ('?' if present)
+	std::unordered_map< uint64_t, float > kerning; //(left << 32 | right) -> adjustment
+
+
+	glm::uvec2 atlas_size = glm::uvec2(0);
+	std::vector< uint8_t > atlas; //(freed by upload())
+	GLuint texture = 0; //GL_TEXTURE_2D, GL_R8, linear filtering
+
+	//read a font file; throws on error (safe to call from any thread):
+	static std::unique_ptr< SdfFont > read(std::string const &filename);
+	//(GL thread) make 'texture' from 'atlas':
+	void upload();
+
+	Glyph const &glyph(uint32_t codepoint) const;
+	//extra advance (usually negative) between 'left' and a following 'right':
+	float kern(uint32_t left, uint32_t right) const;
+};
+
+//One line of text, laid out in a vertex buffer:
+struct SdfText {
+	SdfText() = default;
+	SdfText(SdfText const &) = delete;
+	~SdfText();
+
+	//lay out 'text' (one glyph per byte, kerned) with the pen starting at 'origin' (on the baseline);
+	// 'em' is the size of an em in the units of 'origin' (x and y may differ to suit non-square spaces like clip space):
+	void set(SdfFont const &font, std::string const &text, glm::vec2 const &origin, glm::vec2 const &em);
+
+	struct Vertex;
+	//...or use quads laid out elsewhere (six vertices per glyph, e.g. by ShapedText in TextShaper.hpp):
+	void set(GLuint texture, std::vector< Vertex > const &attribs, float width);
+
+	//draw the first 'first_count' glyphs (all by default) in a single draw call:
+	void draw(glm::mat4 const &world_to_clip, glm::vec4 const &color, uint32_t first_count = -1U) const;
+
+	struct Vertex {
+		Vertex(glm::vec2 const &Position_, glm::vec2 const &TexCoord_) : Position(Position_), TexCoord(TexCoord_) { }
+		glm::vec2 Position;
+		glm::vec2 TexCoord;
+	};
+	static_assert(sizeof(Vertex) == 4 * 2 + 4 * 2, "SdfText::Vertex is packed.");
+
+	GLuint texture = 0;
+	GLuint buffer = 0;
+	GLuint vao = 0;
+	uint32_t count = 0; //glyphs in 'buffer'
+	float width = 0.0f; //total advance, in the units of 'origin'
+};
@@ -0,0 +1,58 @@
+#include "SdfProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+//only SdfText uses this, so it is compiled the first time text is drawn:
+Load< SdfProgram > sdf_program(LoadTagEarly, LoadInfo("SdfProgram", {}, LoadLazy), nullptr, new_T< SdfProgram >);
+
+SdfProgram::SdfProgram() {
+	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"in vec4 Position;\n"
+		"in vec2 TexCoord;\n"
+		"out vec2 texCoord;\n"
+		"void main() {\n"
+		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
+		"	texCoord = TexCoord;\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"uniform sampler2D TEX;\n"
+		"uniform vec4 COLOR;\n"
+		"in vec2 texCoord;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	float dist = texture(TEX, texCoord).r;\n"
+		//antialias over about one screen pixel, whatever size the text is drawn at:
+		"	float width = max(fwidth(dist), 1.0e-4) * 0.5;\n"
+		"	float coverage = smoothstep(0.5 - width, 0.5 + width, dist);\n"
+		"	fragColor = vec4(COLOR.rgb, COLOR.a * coverage);\n"
+		"}\n"
+	);
+
+	//look up the locations of vertex attributes:
+	Position_vec4 = glGetAttribLocation(program, "Position");
+	TexCoord_vec2 = glGetAttribLocation(program, "TexCoord");
+
+	//look up the locations of uniforms:
+	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+	COLOR_vec4 = glGetUniformLocation(program, "COLOR");
+	GLuint TEX_sampler2D = glGetUniformLocation(program, "TEX");
+
+	//set TEX to always refer to texture binding zero:
+	glUseProgram(program);
+	glUniform1i(TEX_sampler2D, 0);
+	glUseProgram(0);
+
+	GL_ERRORS();
+}
+
+SdfProgram::~SdfProgram() {
+	glDeleteProgram(program);
+	program = 0;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Load.hpp"
+
+//Shader program that draws text from a signed distance field atlas (see SdfFont.hpp):
+struct SdfProgram {
+	SdfProgram();
+	~SdfProgram();
+
+	GLuint program = 0;
+	//Attribute (per-vertex variable) locations:
+	GLuint Position_vec4 = -1U;
+	GLuint TexCoord_vec2 = -1U;
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+	GLuint COLOR_vec4 = -1U;
+	//Textures:
+	//TEXTURE0 - single-channel distance field; 0.5 is the glyph outline, larger is inside
+};
+
+extern Load< SdfProgram > sdf_program;
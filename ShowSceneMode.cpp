@@ -95,6 +95,7 @@ void ShowSceneMode::draw(glm::uvec2 const &drawable_size) {
 
 	{ //decorate with some lines:
 		DrawLines draw_lines(scene_camera->make_projection() * glm::mat4(scene_camera->transform->make_world_to_local()));
+		static std::string const quote = "'";
 		for (auto &transform : scene.transforms) {
 			glm::mat4 local_to_world = transform.make_local_to_world();
 			auto xf = [&local_to_world](glm::vec3 const &vec) {
@@ -107,26 +108,30 @@ void ShowSceneMode::draw(glm::uvec2 const &drawable_size) {
 			if (transform.parent) {
 				//connect to parent:
 				glm::vec3 p = glm::vec3(transform.parent->make_local_to_world()[3]);
-				draw_lines.draw(p, xf(glm::vec3(0.0f)), glm::u8vec4(0xff, 0xff, 0x00, 0xff));
+				draw_lines.draw_wide(p, xf(glm::vec3(0.0f)), 2.0f, glm::u8vec4(0xff, 0xff, 0x00, 0xff));
 			}
 
 
 			//axis:
 			float len = 0.2f;
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(len, 0.0f, 0.0f)), glm::u8vec4(0xff, 0x00, 0x00, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(-len, 0.0f, 0.0f)), glm::u8vec4(0x88, 0x00, 0x00, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, len, 0.0f)), glm::u8vec4(0x00, 0xff, 0x00, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, -len, 0.0f)), glm::u8vec4(0x00, 0x88, 0x00, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, 0.0f, len)), glm::u8vec4(0x00, 0x00, 0xff, 0xff));
-			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, 0.0f, -len)), glm::u8vec4(0x00, 0x00, 0x88, 0xff));
-
-			//transform name:
-			draw_lines.draw_text("'" + transform.name + "'",
-				xf(glm::vec3(0.05f, 0.0f, 0.05f)),
-				0.15f * xfd(glm::vec3(1.0f, 0.0f, 0.0f)),
-				0.15f * xfd(glm::vec3(0.0f, 0.0f, 1.0f)),
-				glm::u8vec4(0xff, 0xff, 0xff, 0xff)
-			);
+			glm::vec3 o = xf(glm::vec3(0.0f));
+			DrawLines::Line const axes[] = {
+				{o, xf(glm::vec3(len, 0.0f, 0.0f)), glm::u8vec4(0xff, 0x00, 0x00, 0xff), 2.0f},
+				{o, xf(glm::vec3(-len, 0.0f, 0.0f)), glm::u8vec4(0x88, 0x00, 0x00, 0xff)},
+				{o, xf(glm::vec3(0.0f, len, 0.0f)), glm::u8vec4(0x00, 0xff, 0x00, 0xff), 2.0f},
+				{o, xf(glm::vec3(0.0f, -len, 0.0f)), glm::u8vec4(0x00, 0x88, 0x00, 0xff)},
+				{o, xf(glm::vec3(0.0f, 0.0f, len)), glm::u8vec4(0x00, 0x00, 0xff, 0xff), 2.0f},
+				{o, xf(glm::vec3(0.0f, 0.0f, -len)), glm::u8vec4(0x00, 0x00, 0x88, 0xff)},
+			};
+			draw_lines.draw_lines(axes, sizeof(axes) / sizeof(axes[0]));
+
+			//transform name (drawn in pieces, chaining the anchor, so labelling every transform doesn't build a string for each):
+			glm::vec3 anchor = xf(glm::vec3(0.05f, 0.0f, 0.05f));
+			glm::vec3 x = 0.15f * xfd(glm::vec3(1.0f, 0.0f, 0.0f));
+			glm::vec3 y = 0.15f * xfd(glm::vec3(0.0f, 0.0f, 1.0f));
+			draw_lines.draw_text(quote, anchor, x, y, glm::u8vec4(0xff, 0xff, 0xff, 0xff), &anchor);
+			draw_lines.draw_text(transform.name, anchor, x, y, glm::u8vec4(0xff, 0xff, 0xff, 0xff), &anchor);
+			draw_lines.draw_text(quote, anchor, x, y, glm::u8vec4(0xff, 0xff, 0xff, 0xff));
 		}
 		/*
 		glEnable(GL_LINE_SMOOTH);
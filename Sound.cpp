@@ -1,30 +1,729 @@
 #include "Sound.hpp"
 #include "load_wav.hpp"
 #include "load_opus.hpp"
+#include "spsc_ring.hpp"
+#include "mix_kernels.hpp"
+#include "AssetPack.hpp"
+#include "adpcm.hpp"
+#include "mix_effects.hpp"
 
 #include <SDL.h>
 
-#include <list>
+#include <deque>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <exception>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h> //(for pinning mixer workers to cores)
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#include <immintrin.h> //(for _mm_pause)
+#endif
+
+//To check that the audio thread never touches the heap, build with SOUND_CHECK_ALLOCATIONS defined:
+// any operator new / delete inside mix_block will then abort with a message.
+//#define SOUND_CHECK_ALLOCATIONS
+
+//A streamed sample's (compressed) file:
+struct Sound::StreamSource {
+	std::string filename;
+	AssetView view;
+};
 
 //local (to this file) data used by the audio system:
 namespace {
 
 	//handy constants:
 	constexpr uint32_t const AUDIO_RATE = 48000; //sampling rate
-	constexpr uint32_t const MIX_SAMPLES = 1024; //number of samples to mix per call of mix_audio callback; n.b. SDL requires this to be a power of two
+	constexpr uint32_t const MIX_SAMPLES = Sound::BlockFrames; //number of samples to mix per call of mix_audio callback; n.b. SDL requires this to be a power of two
 
 	//The audio device:
 	SDL_AudioDeviceID device = 0;
 
-	//list of all currently playing samples:
-	std::list< std::shared_ptr< Sound::PlayingSample > > playing_samples;
+	//Is there a mixer to send commands to? (either playing to 'device', or rendering offline)
+	bool running = false;
+	bool offline = false;
 
+	//---- audio thread ----
+
+	struct LR {
+		float l;
+		float r;
+	};
+	static_assert(sizeof(LR) == 8, "Sample is packed");
+
+	//voices quieter than this (about -80dB) aren't mixed at all:
+	constexpr float const INAUDIBLE = 1e-4f;
+
+	//at most this many voices are mixed each block (see Sound::set_voice_budget):
+	uint32_t voice_budget = 64;
+
+	//speed of sound for Doppler shift (0 for none; see Sound::set_doppler):
+	float doppler_speed = 0.0f;
+
+	//resampling (see Sound::Resampler):
+	constexpr uint32_t const MAX_TAPS = 32; //length of the longest filter (and so how many past samples each voice keeps)
+	constexpr float const MAX_RATE = 4.0f; //fastest a voice plays through its samples (source samples per output sample)...
+	constexpr float const MIN_RATE = 1.0f / 64.0f; //...and slowest
+
+	//windowed-sinc (or, for Linear, triangle) filters, tabulated at ResamplePhases + 1 fractional positions (built by start_mixer):
+	struct FilterBank {
+		uint32_t taps = 0;
+		float coefficients[(ResamplePhases + 1) * MAX_TAPS];
+	};
+	FilterBank filter_banks[3]; //(indexed by Sound::Resampler)
+
+	//The state of a voice in the pool, as the mixer sees it:
+	struct Voice {
+		void const *data = nullptr; //sample data being played (floats, or encoded -- see 'storage')
+		Sound::Sample::Storage storage = Sound::Sample::Storage::Decoded;
+		uint32_t size = 0; //...and how many samples there are
+		uint32_t i = 0; //next data value to read
+		uint32_t generation = 0; //(commands carry the generation of the handle they came from; stale ones are ignored)
+		bool loop = false; //should playback loop after data runs out?
+		bool stopping = false; //is playing stopping?
+		bool stopped = true; //was playback stopped (either by running out of sample, or by stop())?
+		uint32_t stream = -1U; //for streamed samples (instead of data/size/i): index in 'streams'...
+		uint32_t ticket = 0; //...and which use of that stream this is
+		uint32_t bus = 0; //where the voice is mixed
+
+		Sound::Ramp< float > volume = Sound::Ramp< float >(1.0f);
+
+		//2D playback panning control: ('NaN' if sound played in 3D mode)
+		Sound::Ramp< float > pan = Sound::Ramp< float >(std::numeric_limits< float >::quiet_NaN());
+
+		//3D playback panning control: ('NaN' if sound played in 2D mode)
+		Sound::Ramp< glm::vec3 > position = Sound::Ramp< glm::vec3 >(std::numeric_limits< float >::quiet_NaN());
+		Sound::Ramp< float > half_volume_radius = Sound::Ramp< float >(std::numeric_limits< float >::quiet_NaN());
+
+		int32_t priority = 0; //when over budget, higher priority voices are mixed first
+
+		//playback rate (source samples per output sample) is rate * pitch (* doppler, for 3D voices):
+		float rate = 1.0f; //(the sample's rate over the mixer's)
+		Sound::Ramp< float > pitch = Sound::Ramp< float >(1.0f);
+		float doppler = 1.0f; //(smoothed over a few blocks, since positions are only updated every frame or so)
+		Sound::Resampler resampler = Sound::Resampler::Sinc8;
+
+		//voices playing at exactly 48kHz read their samples directly; any other rate switches them over to the resampler
+		// (for good -- switching back would make them jump by the filters' delay):
+		bool resampling = false;
+		uint32_t phase = 0; //position between source samples (a 0.32 fixed-point fraction)
+		float history[MAX_TAPS]; //the last MAX_TAPS source samples read (the filters reach back into these)
+		uint32_t silent = 0; //how many of those (counting back from the latest) are past the end of the sample
+
+		//virtual voice book-keeping:
+		bool real = false; //was the voice mixed last block?
+		bool fresh = false; //did the voice just start?
+
+		//this block's loudest possible gain (including global volume), and whether to mix it:
+		float loudness = 0.0f;
+		bool mix = false;
+	};
+	Voice voices[Sound::MaxVoices];
+
+	//indices of all currently playing voices:
+	uint32_t active[Sound::MaxVoices];
+	uint32_t active_count = 0;
+
+	//voices loud enough to be worth mixing, this block:
+	uint32_t candidates[Sound::MaxVoices];
+
+	//(read by Sound::get_voice_stats() on the game thread)
+	struct {
+		std::atomic< uint32_t > playing{0};
+		std::atomic< uint32_t > real{0};
+		std::atomic< uint64_t > promotions{0};
+		std::atomic< uint64_t > demotions{0};
+		std::atomic< uint64_t > steals{0};
+		std::atomic< uint64_t > underruns{0};
+	} voice_stats;
+
+	//An effect on a bus (see Sound::Bus):
+	struct BusEffect {
+		enum Type : uint8_t {
+			FilterEffect,
+			CompressorEffect,
+			ReverbEffect,
+		} type = FilterEffect;
+		Biquad filter;
+		Compressor compressor;
+		ConvolutionReverb *reverb = nullptr; //(belongs to the game thread -- see BusSlot)
+		float wet = 0.0f;
+		float dry = 1.0f;
+	};
+
+	//The state of a bus, as the mixer sees it:
+	struct BusState {
+		uint32_t parent = 0; //(always a lower-numbered bus, so children can be mixed before their parents)
+		Sound::Ramp< float > volume = Sound::Ramp< float >(1.0f);
+		BusEffect effects[Sound::MaxBusEffects];
+		uint32_t effect_count = 0;
+		bool busy = false; //has anything been mixed into the bus this block?
+		uint32_t tail = 0; //blocks the effects will keep ringing after the bus's input stops
+		float reach = 1.0f; //loudest this bus (and the ones it feeds into) could leave a sample this block
+	};
+	BusState buses[Sound::MaxBuses];
+	uint32_t bus_count = 1;
+
+	//what is mixed into each bus (except the master bus, which mixes straight into the output):
+	LR bus_buffers[Sound::MaxBuses][MIX_SAMPLES];
+
+	//---- audio thread <-> mixer workers ----
+
+	//With Sound::set_mixer_threads, the real voices each block are split into chunks,
+	// which the audio thread and the workers claim (first come, first served) and mix into buffers of their own;
+	// once every chunk is done, the audio thread adds the workers' buffers into the buses.
+	constexpr uint32_t const PARALLEL_VOICES = 32; //(fewer real voices than this are mixed on the audio thread alone; a guess, until 'sound-bench --threads' has been run on a multi-core machine)
+
+	struct MixerWorker {
+		std::thread thread;
+		uint32_t core = 0; //(which the worker pins itself to)
+		//what the worker has mixed into each bus this block (the audio thread clears 'busy' once it has added them up):
+		bool busy[Sound::MaxBuses] = { };
+		LR bus_buffers[Sound::MaxBuses][MIX_SAMPLES];
+	};
+
+	//The global values every voice is mixed with, at the start and end of a block:
+	struct BlockValues {
+		float start_volume, end_volume;
+		glm::vec3 start_position, start_right;
+		glm::vec3 end_position, end_right;
+	};
+
+	struct {
+		std::vector< std::unique_ptr< MixerWorker > > workers; //(started by start_mixer and stopped by shutdown, on the game thread)
+		std::atomic< bool > quit{false};
+
+		//the block being mixed (only written by the audio thread while no chunks are left to claim):
+		BlockValues block;
+		uint32_t voices[Sound::MaxVoices]; //(real voices to mix)
+		uint32_t voice_count = 0;
+		uint32_t chunk = 1; //voices per chunk
+
+		//the block's number (top 32 bits) and how many of its chunks are left to claim (bottom 32 bits):
+		// (claimed from the last chunk down, so no one needs to know the count -- and, since the number changes
+		//  every block, a worker that got to a block late can't claim anything from the next one)
+		alignas(64) std::atomic< uint64_t > claim{0};
+		alignas(64) std::atomic< uint32_t > mixed_chunks{0}; //chunks finished so far this block
+
+		//workers that have gone a while without a block wait on 'park' (rather than waking up over and over to check):
+		// (a worker bumps 'parked' and then checks 'claim'; the audio thread sets 'claim' and then checks 'parked' --
+		//  both sequentially consistent, so at least one of them sees the other, and no wakeup is lost)
+		std::mutex park_mutex;
+		std::condition_variable park;
+		alignas(64) std::atomic< uint32_t > parked{0};
+	} mixing;
+
+	//---- decoder thread -> audio thread ----
+
+	constexpr uint32_t const STREAM_BUFFER = 32768; //decoded samples buffered per stream (about 0.7s); a power of two, so positions can wrap
+	constexpr uint32_t const STREAM_LOW_WATER = STREAM_BUFFER / 2; //the decoder tops a stream up once less than this is buffered
+
+	//Decoded audio for a playing streamed sample (a ring buffer with one writer -- the decoder -- and one reader -- the mixer):
+	struct Stream {
+		float buffer[STREAM_BUFFER];
+		std::atomic< uint32_t > written{0}; //samples decoded into 'buffer' so far (mod 2^32)
+		std::atomic< uint32_t > consumed{0}; //samples the mixer has used so far (mod 2^32; only the mixer writes this)
+		std::atomic< bool > ended{false}; //has the decoder reached the end of the file (or given up on it)?
+		std::atomic< uint32_t > ticket{0}; //which use of the stream the buffer is for (set once the decoder has filled it)
+	};
+	Stream streams[Sound::MaxStreams];
+
+	//walk through the next 'count' samples of a voice, calling fn(offset, samples, run) for each contiguous run;
+	// returns how many samples there were (fewer than 'count' at the end of the sample, or if a stream's decoder is behind):
+	template< typename F >
+	uint32_t read_voice(Voice &voice, uint32_t count, F const &fn) {
+		uint32_t done = 0;
+		if (voice.stream == -1U) {
+			while (done < count && voice.i < voice.size) {
+				uint32_t run = std::min(count - done, voice.size - voice.i);
+				if (voice.storage == Sound::Sample::Storage::Decoded) {
+					fn(done, static_cast< float const * >(voice.data) + voice.i, run);
+				} else {
+					//decode a window of samples to mix:
+					// (in pieces, so the windows can live on the stack)
+					run = std::min(run, MIX_SAMPLES);
+					int16_t const *pcm;
+					int16_t decoded[MIX_SAMPLES];
+					if (voice.storage == Sound::Sample::Storage::Int16) {
+						pcm = static_cast< int16_t const * >(voice.data) + voice.i;
+					} else {
+						assert(voice.storage == Sound::Sample::Storage::ADPCM);
+						adpcm_decode(static_cast< uint8_t const * >(voice.data), voice.i, run, decoded);
+						pcm = decoded;
+					}
+					float window[MIX_SAMPLES];
+					int16_to_float(window, pcm, run);
+					fn(done, window, run);
+				}
+				done += run;
+				voice.i += run;
+				if (voice.i == voice.size && voice.loop) voice.i = 0;
+			}
+		} else {
+			Stream &stream = streams[voice.stream];
+			if (stream.ticket.load(std::memory_order_acquire) != voice.ticket) return 0; //(decoder hasn't started on it yet)
+			uint32_t consumed = stream.consumed.load(std::memory_order_relaxed);
+			//(looping streams just keep going -- the decoder wraps around to the start of the file)
+			while (done < count) {
+				uint32_t buffered = stream.written.load(std::memory_order_acquire) - consumed;
+				uint32_t at = consumed & (STREAM_BUFFER - 1);
+				uint32_t run = std::min(std::min(count - done, buffered), STREAM_BUFFER - at);
+				if (run == 0) break;
+				fn(done, stream.buffer + at, run);
+				done += run;
+				consumed += run;
+			}
+			stream.consumed.store(consumed, std::memory_order_release);
+			if (done < count && !stream.ended.load(std::memory_order_acquire)) {
+				voice_stats.underruns += 1;
+			}
+		}
+		return done;
+	}
+
+	//has a voice played all of its samples?
+	bool out_of_samples(Voice const &voice) {
+		if (voice.stream == -1U) return voice.i >= voice.size;
+		Stream const &stream = streams[voice.stream];
+		if (stream.ticket.load(std::memory_order_acquire) != voice.ticket) return false;
+		//(checking 'ended' first, so 'written' is final if it is set)
+		return stream.ended.load(std::memory_order_acquire)
+		    && stream.written.load(std::memory_order_acquire) == stream.consumed.load(std::memory_order_relaxed);
+	}
+
+	//---- game thread -> decoder thread ----
+
+	//Start (or stop) decoding a streamed sample into one of the 'streams':
+	struct StreamRequest {
+		uint32_t stream = -1U;
+		uint32_t ticket = 0; //(0 to stop decoding)
+		bool loop = false;
+		std::shared_ptr< Sound::StreamSource const > source;
+	};
+
+	struct {
+		std::thread thread;
+		std::mutex mutex; //protects the rest (never taken by the audio thread)
+		std::condition_variable cv;
+		std::deque< StreamRequest > requests;
+		bool quit = false;
+	} decoder;
+
+	//The decoder thread -- keeps the buffer of every playing streamed sample topped up:
+	void decode_streams() {
+		//the decoder thread's view of each stream:
+		struct Decoding {
+			std::shared_ptr< Sound::StreamSource const > source;
+			std::unique_ptr< OpusReader > reader;
+			uint32_t ticket = 0; //0 if not in use
+			bool loop = false;
+			bool at_start = true; //has nothing been read since opening / rewinding? (so empty files don't loop forever)
+			bool primed = false; //has the buffer been handed to the mixer yet?
+		};
+		Decoding decoding[Sound::MaxStreams];
+
+		std::unique_lock< std::mutex > lock(decoder.mutex);
+		while (!decoder.quit) {
+			std::deque< StreamRequest > requests;
+			requests.swap(decoder.requests);
+			lock.unlock();
+
+			for (StreamRequest &request : requests) {
+				Decoding &d = decoding[request.stream];
+				Stream &stream = streams[request.stream];
+				d = Decoding();
+				if (request.ticket == 0) continue;
+
+				//(the mixer won't look at the stream again until 'ticket' is set, below)
+				stream.written.store(0, std::memory_order_relaxed);
+				stream.consumed.store(0, std::memory_order_relaxed);
+				stream.ended.store(false, std::memory_order_relaxed);
+
+				d.source = std::move(request.source);
+				d.ticket = request.ticket;
+				d.loop = request.loop;
+				try {
+					d.reader.reset(new OpusReader(d.source->view.data, d.source->view.size, d.source->filename));
+				} catch (std::exception &e) {
+					std::cerr << "WARNING: can't stream sample:\n" << e.what() << std::endl;
+					stream.ended.store(true, std::memory_order_release);
+				}
+			}
+
+			//refill streams that are running low:
+			for (uint32_t s = 0; s < Sound::MaxStreams; ++s) {
+				Decoding &d = decoding[s];
+				Stream &stream = streams[s];
+				if (d.ticket == 0) continue;
+
+				uint32_t written = stream.written.load(std::memory_order_relaxed);
+				uint32_t buffered = written - stream.consumed.load(std::memory_order_acquire);
+				if (!d.primed || buffered < STREAM_LOW_WATER) {
+					try {
+						while (buffered < STREAM_BUFFER && !stream.ended.load(std::memory_order_relaxed)) {
+							uint32_t at = written & (STREAM_BUFFER - 1);
+							uint32_t got = d.reader->read(stream.buffer + at, std::min(STREAM_BUFFER - buffered, STREAM_BUFFER - at));
+							if (got == 0) {
+								//end of the file -- loop back to the start (the mixer just sees more samples), or stop:
+								if (d.loop && !d.at_start) {
+									d.reader->rewind();
+									d.at_start = true;
+								} else {
+									stream.ended.store(true, std::memory_order_release);
+								}
+							} else {
+								d.at_start = false;
+								written += got;
+								buffered += got;
+								stream.written.store(written, std::memory_order_release);
+							}
+						}
+					} catch (std::exception &e) {
+						std::cerr << "WARNING: stopped streaming sample:\n" << e.what() << std::endl;
+						stream.ended.store(true, std::memory_order_release);
+					}
+				}
+				if (!d.primed) {
+					stream.ticket.store(d.ticket, std::memory_order_release);
+					d.primed = true;
+				}
+			}
+
+			lock.lock();
+			//(wakes up regularly to check on buffers, and right away for new requests)
+			decoder.cv.wait_for(lock, std::chrono::milliseconds(5), [](){
+				return decoder.quit || !decoder.requests.empty();
+			});
+		}
+	}
+
+	//---- game thread -> audio thread ----
+
+	//Everything the game asks of the mixer is a Command, applied at the start of the next mix_block call:
+	struct Command {
+		enum Type : uint32_t {
+			Play,
+			SetVolume,
+			SetPan,
+			SetPosition,
+			SetHalfVolumeRadius,
+			Stop,
+			StopAll,
+			SetGlobalVolume,
+			SetListener,
+			SetVoiceBudget,
+			SetPitch,
+			SetResampler,
+			SetDoppler,
+			//bus commands (keep these last -- see apply_command):
+			AddBus,
+			SetBusVolume,
+			AddFilter,
+			SetFilter,
+			AddCompressor,
+			AddReverb,
+			ClearEffects,
+		} type;
+		uint32_t voice; //(for Play ... Stop)
+		uint32_t generation;
+		float value; //volume, pan, radius, pitch, or speed of sound
+		float ramp;
+		glm::vec3 position; //(SetPosition, SetListener, Play)
+		glm::vec3 right; //(SetListener)
+		//Play also needs:
+		void const *data;
+		Sound::Sample::Storage storage;
+		uint32_t size;
+		float pan; //(NaN for 3D)
+		float half_volume_radius; //(NaN for 2D)
+		int32_t priority;
+		bool loop;
+		uint32_t stream; //(streamed samples instead of data/size)
+		uint32_t ticket;
+		float rate; //(sample's rate over the mixer's)
+		//SetVoiceBudget:
+		uint32_t budget;
+		//SetResampler:
+		Sound::Resampler resampler;
+		//bus commands (and Play):
+		uint32_t bus;
+		uint32_t parent; //(AddBus)
+		uint32_t effect; //(AddFilter ... AddReverb)
+		Sound::Bus::Filter filter; //(AddFilter, SetFilter)
+		float settings[5]; //(filter / compressor / reverb settings, in the order the Sound::Bus functions take them)
+		ConvolutionReverb *reverb; //(AddReverb)
+	};
+	SPSCRing< Command, 1024 > commands;
+
+	//---- audio thread -> game thread ----
+
+	//how many commands the mixer has applied (so the game thread knows when it is done with a dropped reverb):
+	std::atomic< uint64_t > commands_applied{0};
+
+	//voices the mixer has finished with (so the game thread can use them again):
+	// (a voice is only ever in here once, so MaxVoices entries is enough)
+	SPSCRing< uint32_t, Sound::MaxVoices > finished;
+
+	//---- game thread ----
+
+	//The game thread's view of each voice in the pool:
+	struct Slot {
+		uint32_t generation = 1; //bumped each time the voice finishes, so old handles go stale
+		bool in_3D = false; //played with play_3D / loop_3D?
+		uint32_t stream = -1U; //stream the voice is playing from (streamed samples only)
+	};
+	Slot slots[Sound::MaxVoices];
+
+	//voices not in use (a stack):
+	uint32_t free_slots[Sound::MaxVoices];
+	uint32_t free_count = 0;
+
+	//streams not in use (also a stack):
+	uint32_t free_streams[Sound::MaxStreams];
+	uint32_t free_stream_count = 0;
+	uint32_t last_ticket = 0;
+
+	void request_stream(StreamRequest &&request) {
+		std::lock_guard< std::mutex > lock(decoder.mutex);
+		decoder.requests.emplace_back(std::move(request));
+		decoder.cv.notify_one();
+	}
+
+	//The game thread's view of each bus:
+	struct BusSlot {
+		uint32_t effect_count = 0;
+		bool filters[Sound::MaxBusEffects] = { }; //which effects are filters (so set_filter can check)
+		std::unique_ptr< ConvolutionReverb > reverbs[Sound::MaxBusEffects]; //(allocated here, and kept alive while the mixer might use them)
+	};
+	BusSlot bus_slots[Sound::MaxBuses];
+	uint32_t bus_slot_count = 1; //(bus 0 is the master bus)
+
+	//reverbs removed from buses, waiting for the mixer to apply the command that removed them:
+	std::vector< std::pair< uint64_t, std::unique_ptr< ConvolutionReverb > > > retired_reverbs;
+
+	//commands that didn't fit in 'commands' (sent, in order, before any new command):
+	std::deque< Command > backlog;
+	uint64_t commands_sent = 0; //(including the backlog)
+
+	//how many threads mix, from the next start_mixer on (see Sound::set_mixer_threads):
+	uint32_t mixer_threads = 1;
+
+	//reclaim voices the mixer has finished with:
+	void collect() {
+		uint32_t voice;
+		while (finished.pop(&voice)) {
+			slots[voice].generation += 1;
+			free_slots[free_count++] = voice;
+			if (slots[voice].stream != -1U) {
+				StreamRequest request;
+				request.stream = slots[voice].stream;
+				request_stream(std::move(request));
+				free_streams[free_stream_count++] = slots[voice].stream;
+				slots[voice].stream = -1U;
+			}
+		}
+
+		uint64_t applied = commands_applied.load(std::memory_order_acquire);
+		retired_reverbs.erase(std::remove_if(retired_reverbs.begin(), retired_reverbs.end(), [applied](auto const &retired) {
+			return retired.first <= applied;
+		}), retired_reverbs.end());
+	}
+
+	//queue a command for the mixer (never blocks):
+	void send(Command const &command) {
+		collect();
+		commands_sent += 1;
+		while (!backlog.empty() && commands.push(backlog.front())) {
+			backlog.pop_front();
+		}
+		if (!(backlog.empty() && commands.push(command))) {
+			//(only if the game issues more than a ring's worth of commands between two mixed blocks)
+			backlog.emplace_back(command);
+		}
+	}
+
+	Command make_command(Command::Type type) {
+		Command command;
+		command.type = type;
+		command.voice = -1U;
+		command.generation = 0;
+		command.value = 0.0f;
+		command.ramp = 0.0f;
+		command.position = glm::vec3(0.0f);
+		command.right = glm::vec3(0.0f);
+		command.data = nullptr;
+		command.storage = Sound::Sample::Storage::Decoded;
+		command.size = 0;
+		command.pan = 0.0f;
+		command.half_volume_radius = 0.0f;
+		command.priority = 0;
+		command.loop = false;
+		command.stream = -1U;
+		command.ticket = 0;
+		command.rate = 1.0f;
+		command.budget = 0;
+		command.resampler = Sound::Resampler::Sinc8;
+		command.bus = 0;
+		command.parent = 0;
+		command.effect = -1U;
+		command.filter = Sound::Bus::Filter::LowPass;
+		std::fill(command.settings, command.settings + 5, 0.0f);
+		command.reverb = nullptr;
+		return command;
+	}
+
+	//command for the voice a handle refers to (returns false if the handle is stale, so there is nothing to do):
+	bool make_voice_command(Command::Type type, Sound::PlayingSample const &handle, Command *command) {
+		if (!running) return false;
+		if (!handle.playing()) return false;
+		*command = make_command(type);
+		command->voice = handle.voice;
+		command->generation = handle.generation;
+		return true;
+	}
+
+	//command for a bus (returns false if there is nothing to do -- no mixer, or a bus from before the last shutdown):
+	bool make_bus_command(Command::Type type, Sound::Bus const &bus, Command *command) {
+		if (!running) return false;
+		if (bus.index >= bus_slot_count) return false;
+		*command = make_command(type);
+		command->bus = bus.index;
+		return true;
+	}
+
+	//claim the next effect slot on a bus:
+	uint32_t add_effect(uint32_t bus, bool filter) {
+		BusSlot &slot = bus_slots[bus];
+		if (slot.effect_count == Sound::MaxBusEffects) {
+			throw std::runtime_error("Can't add another effect to a bus that already has " + std::to_string(Sound::MaxBusEffects) + ".");
+		}
+		slot.filters[slot.effect_count] = filter;
+		return slot.effect_count++;
+	}
+
+	Sound::PlayingSample start(Sound::Sample const &sample, float volume, float pan, glm::vec3 const &position, float half_volume_radius, bool loop, int32_t priority, Sound::Bus const &bus) {
+		if (!running) return Sound::PlayingSample();
+		if (sample.data.empty() && sample.encoded_samples == 0 && !sample.stream) return Sound::PlayingSample();
+		collect();
+		if (free_count == 0) {
+			static bool warned = false;
+			if (!warned) {
+				std::cerr << "WARNING: all " << Sound::MaxVoices << " voices are playing; ignoring further play() calls until some finish." << std::endl;
+				warned = true;
+			}
+			return Sound::PlayingSample();
+		}
+		if (sample.stream && free_stream_count == 0) {
+			static bool warned = false;
+			if (!warned) {
+				std::cerr << "WARNING: all " << Sound::MaxStreams << " streams are playing; ignoring further play() calls of streamed samples until some finish." << std::endl;
+				warned = true;
+			}
+			return Sound::PlayingSample();
+		}
+
+		Sound::PlayingSample handle;
+		handle.voice = free_slots[--free_count];
+		handle.generation = slots[handle.voice].generation;
+		slots[handle.voice].in_3D = !(pan == pan);
+
+		Command command = make_command(Command::Play);
+		command.voice = handle.voice;
+		command.generation = handle.generation;
+		command.value = volume;
+		command.position = position;
+		command.storage = sample.storage;
+		if (sample.storage == Sound::Sample::Storage::Decoded) {
+			command.data = sample.data.data();
+			command.size = uint32_t(sample.data.size());
+		} else {
+			command.data = sample.encoded.data();
+			command.size = sample.encoded_samples;
+		}
+		command.rate = float(sample.rate) / float(AUDIO_RATE);
+		command.pan = pan;
+		command.half_volume_radius = half_volume_radius;
+		command.priority = priority;
+		command.loop = loop;
+		command.bus = (bus.index < bus_slot_count ? bus.index : 0);
+
+		if (sample.stream) {
+			//have the decoder thread start filling a stream:
+			StreamRequest request;
+			request.stream = free_streams[--free_stream_count];
+			request.ticket = (++last_ticket == 0 ? ++last_ticket : last_ticket);
+			request.loop = loop;
+			request.source = sample.stream;
+
+			slots[handle.voice].stream = request.stream;
+			command.stream = request.stream;
+			command.ticket = request.ticket;
+			command.data = nullptr;
+			command.size = 0;
+
+			request_stream(std::move(request));
+		}
+		send(command);
+
+		return handle;
+	}
+
+}
+
+#ifdef SOUND_CHECK_ALLOCATIONS
+//(replaces the global allocation functions; the array and sized versions call these by default)
+// they are kept out of line, since GCC otherwise inlines the malloc / free inside them into callers,
+// and then -Wmismatched-new-delete sees 'new' memory going to free())
+#if defined(_MSC_VER)
+#define SOUND_NOINLINE __declspec(noinline)
+#else
+#define SOUND_NOINLINE __attribute__((noinline))
+#endif
+
+static thread_local bool in_mix_block = false;
+
+static void check_allocation(char const *what) {
+	if (in_mix_block) {
+		std::fprintf(stderr, "SOUND_CHECK_ALLOCATIONS: %s inside mix_block.\n", what);
+		std::abort();
+	}
 }
 
+SOUND_NOINLINE void *operator new(std::size_t size) {
+	check_allocation("operator new");
+	void *ret = std::malloc(size ? size : 1);
+	if (!ret) throw std::bad_alloc();
+	return ret;
+}
+
+SOUND_NOINLINE void operator delete(void *ptr) noexcept {
+	if (ptr) check_allocation("operator delete");
+	std::free(ptr);
+}
+
+SOUND_NOINLINE void operator delete(void *ptr, std::size_t) noexcept {
+	operator delete(ptr);
+}
+#endif //SOUND_CHECK_ALLOCATIONS
+
 //public-facing data:
 
 //global volume control:
@@ -33,25 +732,181 @@ Sound::Ramp< float > Sound::volume = Sound::Ramp< float >(1.0f);
 //global listener information:
 Sound::Listener Sound::listener;
 
-//This audio-mixing callback is defined below:
+//The mixer itself (mixes the next block of audio into 'buffer') is defined below...
+void mix_block(LR *buffer);
+void apply_command(Command const &command);
+
+//...as is the SDL callback that calls it:
 void mix_audio(void *, Uint8 *buffer_, int len);
 
+//...and the loop that mixer workers run:
+void run_mixer_worker(MixerWorker *worker);
+
 //------------------------ public-facing --------------------------------
 
-Sound::Sample::Sample(std::string const &filename) {
+//helper: replace a sample's floating-point data with a compressed version:
+static void encode_sample(Sound::Sample *sample_, Sound::Sample::Storage storage) {
+	assert(sample_);
+	auto &sample = *sample_;
+	assert(sample.storage == Sound::Sample::Storage::Decoded);
+	if (storage == Sound::Sample::Storage::Decoded) return;
+
+	if (storage == Sound::Sample::Storage::Int16) {
+		sample.encoded.resize(sample.data.size() * sizeof(int16_t));
+		int16_t *pcm = reinterpret_cast< int16_t * >(sample.encoded.data());
+		for (size_t i = 0; i < sample.data.size(); ++i) {
+			pcm[i] = int16_t(std::lround(std::max(-1.0f, std::min(1.0f, sample.data[i])) * 32767.0f));
+		}
+	} else if (storage == Sound::Sample::Storage::ADPCM) {
+		adpcm_encode(sample.data.data(), uint32_t(sample.data.size()), &sample.encoded);
+	} else {
+		throw std::runtime_error("Sample data can only be stored as Decoded, Int16, or ADPCM.");
+	}
+	sample.storage = storage;
+	sample.encoded_samples = uint32_t(sample.data.size());
+	std::vector< float >().swap(sample.data); //(actually give back the memory)
+}
+
+Sound::Sample::Sample(std::string const &filename, Storage storage_) {
+	if (storage_ == Storage::Streamed) {
+		if (!(filename.size() >= 5 && filename.substr(filename.size()-5) == ".opus")) {
+			throw std::runtime_error("Sample '" + filename + "' can't be streamed -- only \".opus\" files can.");
+		}
+		auto source = std::make_shared< StreamSource >();
+		source->filename = filename;
+		source->view = asset_view(filename);
+		OpusReader check(source->view.data, source->view.size, filename); //(so a bad file throws here, not when played)
+		stream = source;
+		storage = Storage::Streamed;
+		return;
+	}
+
 	if (filename.size() >= 4 && filename.substr(filename.size()-4) == ".wav") {
-		load_wav(filename, &data);
+		load_wav(filename, &data, &rate);
 	} else if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".opus") {
 		load_opus(filename, &data);
 	} else {
 		throw std::runtime_error("Sample '" + filename + "' doesn't end in either \".png\" or \".opus\" -- unsure how to load.");
 	}
+	encode_sample(this, storage_);
+}
+
+Sound::Sample::Sample(std::vector< float > const &data_, Storage storage_, uint32_t rate_) : rate(rate_), data(data_) {
+	if (rate == 0) throw std::runtime_error("Sample data needs a rate of more than zero samples per second.");
+	encode_sample(this, storage_);
+}
+
+
+
+//helper: modified Bessel function of the first kind, order zero (for the Kaiser window):
+static double bessel_i0(double x) {
+	double sum = 1.0;
+	double term = 1.0;
+	for (uint32_t k = 1; k < 30; ++k) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
 }
 
-Sound::Sample::Sample(std::vector< float > const &data_) : data(data_) {
+//helper: tabulate the resampling filters:
+static void build_filter_banks() {
+	for (uint32_t b = 0; b < 3; ++b) {
+		FilterBank &bank = filter_banks[b];
+		Sound::Resampler resampler = Sound::Resampler(b);
+		//(cutoff is a fraction of the source's Nyquist frequency; shorter filters need a lower one to have room to roll off)
+		double cutoff = 1.0, beta = 0.0;
+		if (resampler == Sound::Resampler::Linear) {
+			bank.taps = 2;
+		} else if (resampler == Sound::Resampler::Sinc8) {
+			bank.taps = 8;
+			cutoff = 0.8;
+			beta = 5.0;
+		} else {
+			assert(resampler == Sound::Resampler::Sinc32);
+			bank.taps = 32;
+			cutoff = 0.92;
+			beta = 8.0;
+		}
+		assert(bank.taps <= MAX_TAPS);
+
+		double half = 0.5 * bank.taps;
+		for (uint32_t r = 0; r <= ResamplePhases; ++r) {
+			//row r is for a point 'fraction' of the way from tap taps/2 - 1 to tap taps/2:
+			double fraction = double(r) / double(ResamplePhases);
+			float *row = bank.coefficients + r * bank.taps;
+			double total = 0.0;
+			for (uint32_t j = 0; j < bank.taps; ++j) {
+				double x = double(j) - (half - 1.0) - fraction; //(distance from tap j to the point)
+				double weight;
+				if (resampler == Sound::Resampler::Linear) {
+					weight = std::max(0.0, 1.0 - std::abs(x));
+				} else {
+					double sinc = (x == 0.0 ? 1.0 : std::sin(3.14159265358979 * cutoff * x) / (3.14159265358979 * cutoff * x));
+					double edge = std::max(0.0, 1.0 - (x / half) * (x / half));
+					weight = sinc * bessel_i0(beta * std::sqrt(edge)) / bessel_i0(beta);
+				}
+				row[j] = float(weight);
+				total += weight;
+			}
+			//(so that a constant signal stays constant whatever the fraction)
+			for (uint32_t j = 0; j < bank.taps; ++j) {
+				row[j] = float(row[j] / total);
+			}
+		}
+	}
 }
 
+//helper: get the mixer ready to go (for both init() and init_offline()):
+static void start_mixer() {
+	build_filter_banks();
+
+	//every voice (and stream) starts out free:
+	free_count = 0;
+	for (uint32_t v = Sound::MaxVoices; v > 0; --v) {
+		free_slots[free_count++] = v - 1;
+	}
+	free_stream_count = 0;
+	for (uint32_t s = Sound::MaxStreams; s > 0; --s) {
+		free_streams[free_stream_count++] = s - 1;
+	}
 
+	//just the master bus:
+	bus_slot_count = 1;
+	bus_count = 1;
+	buses[0] = BusState();
+	commands_sent = 0;
+	commands_applied = 0;
+
+	voice_budget = 64;
+	doppler_speed = 0.0f;
+	voice_stats.playing = 0;
+	voice_stats.real = 0;
+	voice_stats.promotions = 0;
+	voice_stats.demotions = 0;
+	voice_stats.steals = 0;
+	voice_stats.underruns = 0;
+
+	//start decoding streamed samples, as they are played:
+	decoder.quit = false;
+	decoder.thread = std::thread(decode_streams);
+
+	//start the mixer workers (if there are to be any), pinning each to a core of its own:
+	// (leaving core 0 to the rest of the game; and never more threads than cores, since workers spin for a while before parking)
+	mixing.quit = false;
+	mixing.claim = 0;
+	mixing.mixed_chunks = 0;
+	uint32_t threads = mixer_threads;
+	if (std::thread::hardware_concurrency() != 0) threads = std::min(threads, std::thread::hardware_concurrency());
+	for (uint32_t w = 1; w < threads; ++w) {
+		mixing.workers.emplace_back(new MixerWorker());
+		MixerWorker *worker = mixing.workers.back().get();
+		worker->core = w;
+		worker->thread = std::thread(run_mixer_worker, worker);
+	}
+
+	running = true;
+}
 
 void Sound::init() {
 	if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
@@ -74,20 +929,93 @@ void Sound::init() {
 		std::cerr << "Failed to open audio device:\n" << SDL_GetError() << std::endl;
 		std::cerr << "  (Will continue without audio.)\n" << std::endl;
 	} else {
+		start_mixer();
+
 		//start audio playback:
 		SDL_PauseAudioDevice(device, 0);
-		std::cout << "Audio output initialized." << std::endl;
+		std::cout << "Audio output initialized (mixing with " << mix_kernels_name() << ")." << std::endl;
+	}
+}
+
+void Sound::init_offline() {
+	if (running) throw std::runtime_error("Sound::init_offline() called while the mixer is already running.");
+	start_mixer();
+	offline = true;
+}
+
+void Sound::render(uint32_t blocks, float *out) {
+	if (!offline) throw std::runtime_error("Sound::render() needs Sound::init_offline() first.");
+	assert(out || blocks == 0);
+	for (uint32_t b = 0; b < blocks; ++b) {
+		//(the game and the mixer are the same thread here, so commands that didn't fit in the queue can be applied directly)
+		Command command;
+		while (commands.pop(&command)) {
+			apply_command(command);
+		}
+		for (Command const &later : backlog) {
+			apply_command(later);
+		}
+		backlog.clear();
+
+		mix_block(reinterpret_cast< LR * >(out + size_t(b) * 2 * MIX_SAMPLES));
 	}
 }
 
 
 void Sound::shutdown() {
+	if (!running) return;
+
 	if (device != 0) {
 		//stop audio playback:
 		SDL_PauseAudioDevice(device, 1);
 		SDL_CloseAudioDevice(device);
 		device = 0;
 	}
+
+	//stop decoding:
+	{
+		std::lock_guard< std::mutex > lock(decoder.mutex);
+		decoder.quit = true;
+		decoder.cv.notify_one();
+	}
+	decoder.thread.join();
+	decoder.requests.clear();
+
+	//stop the mixer workers:
+	{
+		std::lock_guard< std::mutex > lock(mixing.park_mutex);
+		mixing.quit = true;
+		mixing.park.notify_all();
+	}
+	for (auto &worker : mixing.workers) {
+		worker->thread.join();
+	}
+	mixing.workers.clear();
+
+	//forget everything that was playing (so the mixer can start over from scratch):
+	backlog.clear();
+	Command command;
+	while (commands.pop(&command)) { }
+	uint32_t voice;
+	while (finished.pop(&voice)) { }
+	for (uint32_t a = 0; a < active_count; ++a) {
+		voices[active[a]].stopped = true;
+	}
+	active_count = 0;
+	for (Slot &slot : slots) {
+		slot.generation += 1; //(so any handles still around are stale)
+		slot.stream = -1U;
+	}
+	for (uint32_t b = 0; b < bus_count; ++b) {
+		buses[b] = BusState();
+	}
+	for (BusSlot &slot : bus_slots) {
+		slot = BusSlot();
+	}
+	retired_reverbs.clear();
+
+	running = false;
+	offline = false;
 }
 
 
@@ -99,110 +1027,240 @@ void Sound::unlock() {
 	if (device) SDL_UnlockAudioDevice(device);
 }
 
-std::shared_ptr< Sound::PlayingSample > Sound::play(Sample const &sample, float play_volume, float pan) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, false);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+Sound::PlayingSample Sound::play(Sample const &sample, float play_volume, float pan, int32_t priority, Bus const &bus) {
+	return start(sample, play_volume, pan, glm::vec3(std::numeric_limits< float >::quiet_NaN()), std::numeric_limits< float >::quiet_NaN(), false, priority, bus);
 }
 
-std::shared_ptr< Sound::PlayingSample > Sound::play_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, false);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+Sound::PlayingSample Sound::play_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius, int32_t priority, Bus const &bus) {
+	return start(sample, play_volume, std::numeric_limits< float >::quiet_NaN(), position, half_volume_radius, false, priority, bus);
 }
 
-std::shared_ptr< Sound::PlayingSample > Sound::loop(Sample const &sample, float play_volume, float pan) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, true);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+Sound::PlayingSample Sound::loop(Sample const &sample, float play_volume, float pan, int32_t priority, Bus const &bus) {
+	return start(sample, play_volume, pan, glm::vec3(std::numeric_limits< float >::quiet_NaN()), std::numeric_limits< float >::quiet_NaN(), true, priority, bus);
 }
 
+Sound::PlayingSample Sound::loop_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius, int32_t priority, Bus const &bus) {
+	return start(sample, play_volume, std::numeric_limits< float >::quiet_NaN(), position, half_volume_radius, true, priority, bus);
+}
 
 
-std::shared_ptr< Sound::PlayingSample > Sound::loop_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, true);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+void Sound::stop_all_samples() {
+	if (!running) return;
+	send(make_command(Command::StopAll));
 }
 
+void Sound::set_voice_budget(uint32_t real_voices) {
+	if (!running) return;
+	Command command = make_command(Command::SetVoiceBudget);
+	command.budget = std::min(real_voices, Sound::MaxVoices);
+	send(command);
+}
 
-void Sound::stop_all_samples() {
-	lock();
-	for (auto &s : playing_samples) {
-		s->stop();
+Sound::Bus Sound::add_bus(Bus const &parent) {
+	if (!running) return Bus();
+	if (parent.index >= bus_slot_count) {
+		throw std::runtime_error("Sound::add_bus() given a parent that isn't a bus (maybe from before the last Sound::shutdown()?).");
 	}
-	unlock();
+	if (bus_slot_count == MaxBuses) {
+		throw std::runtime_error("Sound::add_bus() called when all " + std::to_string(MaxBuses) + " buses are in use.");
+	}
+	Bus bus;
+	bus.index = bus_slot_count++;
+
+	Command command = make_command(Command::AddBus);
+	command.bus = bus.index;
+	command.parent = parent.index;
+	send(command);
+
+	return bus;
+}
+
+void Sound::set_doppler(float speed_of_sound) {
+	if (!running) return;
+	Command command = make_command(Command::SetDoppler);
+	command.value = std::max(0.0f, speed_of_sound);
+	send(command);
+}
+
+void Sound::set_mixer_threads(uint32_t threads) {
+	mixer_threads = std::max(1u, std::min(threads, MaxMixerThreads));
+}
+
+Sound::VoiceStats Sound::get_voice_stats() {
+	VoiceStats stats;
+	stats.playing = voice_stats.playing.load(std::memory_order_relaxed);
+	stats.real = voice_stats.real.load(std::memory_order_relaxed);
+	stats.promotions = voice_stats.promotions.load(std::memory_order_relaxed);
+	stats.demotions = voice_stats.demotions.load(std::memory_order_relaxed);
+	stats.steals = voice_stats.steals.load(std::memory_order_relaxed);
+	stats.underruns = voice_stats.underruns.load(std::memory_order_relaxed);
+	return stats;
 }
 
 void Sound::set_volume(float new_volume, float ramp) {
-	lock();
-	volume.set(new_volume, ramp);
-	unlock();
+	if (!running) return;
+	Command command = make_command(Command::SetGlobalVolume);
+	command.value = new_volume;
+	command.ramp = ramp;
+	send(command);
 }
 
 //------------------
 
-void Sound::PlayingSample::set_volume(float new_volume, float ramp) {
-	Sound::lock();
-	if (!stopping) {
-		volume.set(new_volume, ramp);
-	}
-	Sound::unlock();
+void Sound::PlayingSample::set_volume(float new_volume, float ramp) const {
+	Command command;
+	if (!make_voice_command(Command::SetVolume, *this, &command)) return;
+	command.value = new_volume;
+	command.ramp = ramp;
+	send(command);
 }
 
-void Sound::PlayingSample::set_pan(float new_pan, float ramp) {
-	if (!(pan.value == pan.value)) return; //ignore if not in '2D' mode
-	Sound::lock();
-	pan.set(new_pan, ramp);
-	Sound::unlock();
+void Sound::PlayingSample::set_pan(float new_pan, float ramp) const {
+	Command command;
+	if (!make_voice_command(Command::SetPan, *this, &command)) return;
+	if (slots[voice].in_3D) return; //ignore if not in '2D' mode
+	command.value = new_pan;
+	command.ramp = ramp;
+	send(command);
 }
 
-void Sound::PlayingSample::set_position(glm::vec3 const &new_position, float ramp) {
-	if (pan.value == pan.value) return; //ignore if not in '3D' mode
-	Sound::lock();
-	position.set(new_position, ramp);
-	Sound::unlock();
+void Sound::PlayingSample::set_position(glm::vec3 const &new_position, float ramp) const {
+	Command command;
+	if (!make_voice_command(Command::SetPosition, *this, &command)) return;
+	if (!slots[voice].in_3D) return; //ignore if not in '3D' mode
+	command.position = new_position;
+	command.ramp = ramp;
+	send(command);
 }
 
-void Sound::PlayingSample::set_half_volume_radius(float new_radius, float ramp) {
-	if (pan.value == pan.value) return; //ignore if not in '3D' mode
-	Sound::lock();
-	half_volume_radius.set(new_radius, ramp);
-	Sound::unlock();
+void Sound::PlayingSample::set_half_volume_radius(float new_radius, float ramp) const {
+	Command command;
+	if (!make_voice_command(Command::SetHalfVolumeRadius, *this, &command)) return;
+	if (!slots[voice].in_3D) return; //ignore if not in '3D' mode
+	command.value = new_radius;
+	command.ramp = ramp;
+	send(command);
 }
 
-void Sound::PlayingSample::stop(float ramp) {
-	Sound::lock();
-	if (!(stopping || stopped)) {
-		stopping = true;
-		volume.target = 0.0f;
-		volume.ramp = ramp;
-	} else {
-		volume.ramp = std::min(volume.ramp, ramp);
+void Sound::PlayingSample::set_pitch(float new_pitch, float ramp) const {
+	Command command;
+	if (!make_voice_command(Command::SetPitch, *this, &command)) return;
+	command.value = new_pitch;
+	command.ramp = ramp;
+	send(command);
+}
+
+void Sound::PlayingSample::set_resampler(Resampler resampler) const {
+	Command command;
+	if (!make_voice_command(Command::SetResampler, *this, &command)) return;
+	command.resampler = resampler;
+	send(command);
+}
+
+void Sound::PlayingSample::stop(float ramp) const {
+	Command command;
+	if (!make_voice_command(Command::Stop, *this, &command)) return;
+	command.ramp = ramp;
+	send(command);
+}
+
+bool Sound::PlayingSample::playing() const {
+	collect();
+	return voice < Sound::MaxVoices && slots[voice].generation == generation;
+}
+
+//------------------
+
+void Sound::Bus::set_volume(float new_volume, float ramp) const {
+	Command command;
+	if (!make_bus_command(Command::SetBusVolume, *this, &command)) return;
+	command.value = new_volume;
+	command.ramp = ramp;
+	send(command);
+}
+
+uint32_t Sound::Bus::add_filter(Filter type, float frequency, float q, float gain_db) const {
+	Command command;
+	if (!make_bus_command(Command::AddFilter, *this, &command)) return -1U;
+	command.effect = add_effect(index, true);
+	command.filter = type;
+	command.settings[0] = frequency;
+	command.settings[1] = q;
+	command.settings[2] = gain_db;
+	send(command);
+	return command.effect;
+}
+
+uint32_t Sound::Bus::add_compressor(float threshold_db, float ratio, float attack, float release, float makeup_db) const {
+	Command command;
+	if (!make_bus_command(Command::AddCompressor, *this, &command)) return -1U;
+	command.effect = add_effect(index, false);
+	command.settings[0] = threshold_db;
+	command.settings[1] = ratio;
+	command.settings[2] = attack;
+	command.settings[3] = release;
+	command.settings[4] = makeup_db;
+	send(command);
+	return command.effect;
+}
+
+uint32_t Sound::Bus::add_reverb(Sample const &impulse_response, float wet, float dry) const {
+	Command command;
+	if (!make_bus_command(Command::AddReverb, *this, &command)) return -1U;
+	if (impulse_response.storage != Sample::Storage::Decoded || impulse_response.rate != AUDIO_RATE || impulse_response.data.empty()) {
+		throw std::runtime_error("Reverb impulse responses must be (non-empty) Decoded samples at " + std::to_string(AUDIO_RATE) + "Hz.");
+	}
+	//(the transformed impulse response is set up here, so the audio thread doesn't have to)
+	std::unique_ptr< ConvolutionReverb > reverb(new ConvolutionReverb(impulse_response.data.data(), uint32_t(impulse_response.data.size()), MIX_SAMPLES));
+	command.effect = add_effect(index, false);
+	command.settings[0] = wet;
+	command.settings[1] = dry;
+	command.reverb = reverb.get();
+	bus_slots[index].reverbs[command.effect] = std::move(reverb);
+	send(command);
+	return command.effect;
+}
+
+void Sound::Bus::set_filter(uint32_t effect, Filter type, float frequency, float q, float gain_db) const {
+	Command command;
+	if (!make_bus_command(Command::SetFilter, *this, &command)) return;
+	if (!(effect < bus_slots[index].effect_count && bus_slots[index].filters[effect])) {
+		throw std::runtime_error("Bus::set_filter() called on an effect that isn't a filter.");
+	}
+	command.effect = effect;
+	command.filter = type;
+	command.settings[0] = frequency;
+	command.settings[1] = q;
+	command.settings[2] = gain_db;
+	send(command);
+}
+
+void Sound::Bus::clear_effects() const {
+	Command command;
+	if (!make_bus_command(Command::ClearEffects, *this, &command)) return;
+	send(command);
+	//(the mixer might still be using the reverbs until it gets to this command)
+	BusSlot &slot = bus_slots[index];
+	for (uint32_t e = 0; e < slot.effect_count; ++e) {
+		if (slot.reverbs[e]) retired_reverbs.emplace_back(commands_sent, std::move(slot.reverbs[e]));
 	}
-	Sound::unlock();
+	slot.effect_count = 0;
 }
 
 //------------------
 
 void Sound::Listener::set_position_right(glm::vec3 const &new_position, glm::vec3 const &new_right, float ramp) {
-	Sound::lock();
-	position.set(new_position, ramp);
+	if (!running) return;
+	Command command = make_command(Command::SetListener);
+	command.position = new_position;
 	//some extra code to make sure right is always a unit vector:
 	if (new_right == glm::vec3(0.0f)) {
-		right.set(glm::vec3(1.0f, 0.0f, 0.0f), ramp);
+		command.right = glm::vec3(1.0f, 0.0f, 0.0f);
 	} else {
-		right.set(glm::normalize(new_right), ramp);
+		command.right = glm::normalize(new_right);
 	}
-	Sound::unlock();
+	command.ramp = ramp;
+	send(command);
 }
 
 //------------------------ internals --------------------------------
@@ -251,6 +1309,17 @@ void compute_pan_from_listener_and_position(
 	}
 }
 
+//helper: loudest that 3D panning could make a source (compute_pan_from_listener_and_position without the direction):
+float compute_gain_bound_from_listener_and_position(
+	glm::vec3 const &listener_position,
+	glm::vec3 const &source_position,
+	float source_half_radius
+	) {
+	float distance = glm::length(source_position - listener_position);
+	if (distance == 0.0f) return std::sqrt(2.0f);
+	return 1.0f / (1.0f + (distance / source_half_radius));
+}
+
 //helper: ramp updates...
 constexpr float const RAMP_STEP = float(MIX_SAMPLES) / float(AUDIO_RATE);
 
@@ -309,18 +1378,481 @@ void step_direction_ramp(Sound::Ramp< glm::vec3 > &ramp) {
 	}
 }
 
+//helper: a voice's playback rate for this block, as a 32.32 fixed-point step through its samples
+// (call before stepping the voice's ramps; steps the pitch ramp itself):
+uint64_t step_voice_rate(Voice &voice, glm::vec3 const &start_listener, glm::vec3 const &end_listener) {
+	float rate = voice.rate * voice.pitch.value;
+	step_value_ramp(voice.pitch);
+
+	if (doppler_speed > 0.0f && !(voice.pan.value == voice.pan.value)) {
+		//how fast is the sample moving away from the listener? (from where both of them are this block and next)
+		Voice const &now = voice;
+		Sound::Ramp< glm::vec3 > position = now.position;
+		step_position_ramp(position);
+		float receding = (glm::length(position.value - end_listener) - glm::length(now.position.value - start_listener)) / RAMP_STEP;
+		float target = doppler_speed / std::max(0.5f * doppler_speed, doppler_speed + receding);
+		voice.doppler += 0.5f * (std::min(2.0f, target) - voice.doppler);
+		rate *= voice.doppler;
+	} else {
+		voice.doppler = 1.0f;
+	}
+
+	rate = std::max(MIN_RATE, std::min(MAX_RATE, rate));
+	return uint64_t(double(rate) * 4294967296.0);
+}
+
+//helper: remember the latest samples read directly (in case the voice switches over to the resampler):
+void push_history(Voice &voice, float const *samples, uint32_t count) {
+	if (count >= MAX_TAPS) {
+		std::copy(samples + count - MAX_TAPS, samples + count, voice.history);
+	} else {
+		std::copy(voice.history + count, voice.history + MAX_TAPS, voice.history);
+		std::copy(samples, samples + count, voice.history + MAX_TAPS - count);
+	}
+}
+
+//helper: the resampler plays from the middle of a voice's history, so switching over reads ahead to fill it:
+// (afterward, history[MAX_TAPS / 2 - 1] is the sample that would have been read next)
+void start_resampling(Voice &voice) {
+	constexpr uint32_t const Ahead = MAX_TAPS / 2 + 1;
+	std::copy(voice.history + Ahead, voice.history + MAX_TAPS, voice.history);
+	uint32_t got = read_voice(voice, Ahead, [&](uint32_t i, float const *samples, uint32_t run) {
+		std::copy(samples, samples + run, voice.history + (MAX_TAPS - Ahead) + i);
+	});
+	std::fill(voice.history + (MAX_TAPS - Ahead) + got, voice.history + MAX_TAPS, 0.0f);
+	voice.silent = (got < Ahead ? Ahead - got : 0);
+	voice.phase = 0;
+	voice.resampling = true;
+}
+
+//helper: resample the next block of a voice into 'out':
+void resample_voice(Voice &voice, uint64_t step, float *out) {
+	uint64_t end = uint64_t(voice.phase) + MIX_SAMPLES * step;
+	uint32_t advance = uint32_t(end >> 32); //source samples to read
+
+	//the filters run over the voice's history followed by the new samples:
+	float window[MAX_TAPS + uint32_t(MAX_RATE) * MIX_SAMPLES];
+	std::copy(voice.history, voice.history + MAX_TAPS, window);
+	uint32_t got = read_voice(voice, advance, [&](uint32_t i, float const *samples, uint32_t run) {
+		std::copy(samples, samples + run, window + MAX_TAPS + i);
+	});
+	//(past the end of the sample -- or a stream whose decoder fell behind -- is silence)
+	std::fill(window + MAX_TAPS + got, window + MAX_TAPS + advance, 0.0f);
+	voice.silent = std::min(MAX_TAPS, (got == 0 ? voice.silent : 0) + (advance - got));
+
+	//every filter is centered between window[p + MAX_TAPS / 2 - 1] and window[p + MAX_TAPS / 2], for position p:
+	FilterBank const &bank = filter_banks[uint32_t(voice.resampler)];
+	resample(out, MIX_SAMPLES, window + (MAX_TAPS - bank.taps) / 2, voice.phase, step, bank.coefficients, bank.taps);
+
+	std::copy(window + advance, window + advance + MAX_TAPS, voice.history);
+	voice.phase = uint32_t(end);
+}
+
+
+//helper: stop a playing voice:
+void stop_voice(Voice &voice, float ramp) {
+	if (!(voice.stopping || voice.stopped)) {
+		voice.stopping = true;
+		voice.volume.target = 0.0f;
+		voice.volume.ramp = ramp;
+	} else {
+		voice.volume.ramp = std::min(voice.volume.ramp, ramp);
+	}
+}
+
+//helper: how many blocks a bus's effects ring on after its input stops:
+uint32_t bus_tail(BusState const &bus) {
+	uint32_t tail = 0;
+	for (uint32_t e = 0; e < bus.effect_count; ++e) {
+		BusEffect const &effect = bus.effects[e];
+		if (effect.type == BusEffect::FilterEffect) tail = std::max(tail, 2u); //(plenty, unless the filter is very sharp or very low)
+		else if (effect.type == BusEffect::CompressorEffect) tail = std::max(tail, 1u); //(no tail, but this gets its envelope reset)
+		else if (effect.type == BusEffect::ReverbEffect) tail = std::max(tail, effect.reverb->tail_blocks());
+	}
+	return tail;
+}
+
+//helper: apply a command for a bus:
+void apply_bus_command(Command const &command) {
+	assert(command.bus < Sound::MaxBuses);
+	BusState &bus = buses[command.bus];
+
+	if (command.type == Command::AddBus) {
+		bus = BusState();
+		bus.parent = command.parent;
+		bus_count = std::max(bus_count, command.bus + 1);
+	} else if (command.type == Command::SetBusVolume) {
+		bus.volume.set(command.value, command.ramp);
+	} else if (command.type == Command::AddFilter || command.type == Command::AddCompressor || command.type == Command::AddReverb) {
+		assert(command.effect == bus.effect_count && command.effect < Sound::MaxBusEffects);
+		BusEffect &effect = bus.effects[bus.effect_count++];
+		effect = BusEffect();
+		if (command.type == Command::AddFilter) {
+			effect.type = BusEffect::FilterEffect;
+			effect.filter.design(Biquad::Type(command.filter), command.settings[0], command.settings[1], command.settings[2], float(AUDIO_RATE));
+		} else if (command.type == Command::AddCompressor) {
+			effect.type = BusEffect::CompressorEffect;
+			effect.compressor.configure(command.settings[0], command.settings[1], command.settings[2], command.settings[3], command.settings[4], float(AUDIO_RATE));
+		} else {
+			effect.type = BusEffect::ReverbEffect;
+			effect.reverb = command.reverb;
+			effect.wet = command.settings[0];
+			effect.dry = command.settings[1];
+		}
+	} else if (command.type == Command::SetFilter) {
+		if (command.effect < bus.effect_count && bus.effects[command.effect].type == BusEffect::FilterEffect) {
+			bus.effects[command.effect].filter.design(Biquad::Type(command.filter), command.settings[0], command.settings[1], command.settings[2], float(AUDIO_RATE));
+		}
+	} else if (command.type == Command::ClearEffects) {
+		for (uint32_t e = 0; e < bus.effect_count; ++e) {
+			bus.effects[e] = BusEffect(); //(drops the reverbs -- the game thread frees them once this command is counted as applied)
+		}
+		bus.effect_count = 0;
+		bus.tail = 0;
+	}
+}
+
+//helper: the buffer to mix into a bus (cleared the first time it's used each block; the master bus mixes straight into the output):
+LR *bus_input(uint32_t b, LR *output) {
+	BusState &bus = buses[b];
+	LR *into = (b == 0 ? output : bus_buffers[b]);
+	if (!bus.busy) {
+		if (b != 0) std::fill(&into[0].l, &into[0].l + 2 * MIX_SAMPLES, 0.0f);
+		bus.busy = true;
+	}
+	return into;
+}
+
+//apply a command from the game thread (at the start of mix_block):
+void apply_command(Command const &command) {
+	//(the game thread frees reverbs dropped by a command once it sees this has counted past it)
+	commands_applied.fetch_add(1, std::memory_order_release);
+
+	if (command.type == Command::StopAll) {
+		for (uint32_t a = 0; a < active_count; ++a) {
+			stop_voice(voices[active[a]], 1.0f / 60.0f);
+		}
+		return;
+	} else if (command.type == Command::SetGlobalVolume) {
+		Sound::volume.set(command.value, command.ramp);
+		return;
+	} else if (command.type == Command::SetListener) {
+		Sound::listener.position.set(command.position, command.ramp);
+		Sound::listener.right.set(command.right, command.ramp);
+		return;
+	} else if (command.type == Command::SetVoiceBudget) {
+		voice_budget = command.budget;
+		return;
+	} else if (command.type == Command::SetDoppler) {
+		doppler_speed = command.value;
+		return;
+	} else if (command.type >= Command::AddBus) {
+		apply_bus_command(command);
+		return;
+	}
+
+	assert(command.voice < Sound::MaxVoices);
+	Voice &voice = voices[command.voice];
+
+	if (command.type == Command::Play) {
+		assert(voice.stopped); //(the game thread only reuses voices the mixer has finished with)
+		voice.data = command.data;
+		voice.storage = command.storage;
+		voice.size = command.size;
+		voice.i = 0;
+		voice.stream = command.stream;
+		voice.ticket = command.ticket;
+		voice.bus = command.bus;
+		voice.generation = command.generation;
+		voice.loop = command.loop;
+		voice.stopping = false;
+		voice.stopped = false;
+		voice.volume.set(command.value, 0.0f);
+		voice.pan.set(command.pan, 0.0f);
+		voice.position.set(command.position, 0.0f);
+		voice.half_volume_radius.set(command.half_volume_radius, 0.0f);
+		voice.priority = command.priority;
+		voice.rate = command.rate;
+		voice.pitch.set(1.0f, 0.0f);
+		voice.doppler = 1.0f;
+		voice.resampler = Sound::Resampler::Sinc8;
+		voice.resampling = false;
+		voice.phase = 0;
+		std::fill(voice.history, voice.history + MAX_TAPS, 0.0f);
+		voice.silent = 0;
+		voice.real = false;
+		voice.fresh = true;
+		assert(active_count < Sound::MaxVoices);
+		active[active_count++] = command.voice;
+		return;
+	}
+
+	//the rest only apply to the use of the voice the handle was for:
+	if (voice.stopped || voice.generation != command.generation) return;
+
+	switch (command.type) {
+		case Command::SetVolume:
+			if (!voice.stopping) {
+				voice.volume.set(command.value, command.ramp);
+			}
+			break;
+		case Command::SetPan:
+			voice.pan.set(command.value, command.ramp);
+			break;
+		case Command::SetPosition:
+			voice.position.set(command.position, command.ramp);
+			break;
+		case Command::SetHalfVolumeRadius:
+			voice.half_volume_radius.set(command.value, command.ramp);
+			break;
+		case Command::SetPitch:
+			voice.pitch.set(command.value, command.ramp);
+			break;
+		case Command::SetResampler:
+			voice.resampler = command.resampler;
+			break;
+		case Command::Stop:
+			stop_voice(voice, command.ramp);
+			break;
+		default:
+			break;
+	}
+}
+
+//helper: mix a real voice (or one that's fading out to go virtual) over this block, into the buffer into(bus) gives for its bus:
+template< typename F >
+void mix_voice(Voice &voice, BlockValues const &block, F const &into) {
+	//samples not playing at exactly the mixer's rate go through the resampler:
+	uint64_t step = step_voice_rate(voice, block.start_position, block.end_position);
+	if (!voice.resampling && step != (uint64_t(1) << 32)) start_resampling(voice);
+
+	//voices that were real last block fade out over this one (so that going virtual doesn't click),
+	// and voices that become real again fade in (unless they are just starting):
+	if (voice.mix && !voice.real && !voice.fresh) voice_stats.promotions += 1;
+	if (!voice.mix) voice_stats.demotions += 1;
+
+	//Figure out sample panning/volume at start...
+	LR start_pan;
+	if (!(voice.pan.value == voice.pan.value)) {
+		//3D panning
+		compute_pan_from_listener_and_position(
+			block.start_position, block.start_right,
+			voice.position.value,
+			voice.half_volume_radius.value,
+			&start_pan.l, &start_pan.r);
+
+		step_position_ramp(voice.position);
+		step_value_ramp(voice.half_volume_radius);
+	} else {
+		//2D panning
+		compute_pan_weights(voice.pan.value, &start_pan.l, &start_pan.r);
+
+		step_value_ramp(voice.pan);
+	}
+	start_pan.l *= block.start_volume * voice.volume.value;
+	start_pan.r *= block.start_volume * voice.volume.value;
+
+	step_value_ramp(voice.volume);
+
+	//..and end of the mix period:
+	LR end_pan;
+	if (!(voice.pan.value == voice.pan.value)) {
+		//3D panning
+		compute_pan_from_listener_and_position(
+			block.end_position, block.end_right,
+			voice.position.value,
+			voice.half_volume_radius.value,
+			&end_pan.l, &end_pan.r);
+	} else {
+		//2D panning
+		compute_pan_weights(voice.pan.value, &end_pan.l, &end_pan.r);
+	}
+
+	end_pan.l *= block.end_volume * voice.volume.value;
+	end_pan.r *= block.end_volume * voice.volume.value;
+
+	//fade in from silence / out to silence:
+	if (!(voice.real || voice.fresh)) start_pan.l = start_pan.r = 0.0f;
+	if (!voice.mix) end_pan.l = end_pan.r = 0.0f;
+
+	//figure out a step to add at each sample so that pan will move smoothly from start to end:
+	LR pan_step;
+	pan_step.l = (end_pan.l - start_pan.l) / MIX_SAMPLES;
+	pan_step.r = (end_pan.r - start_pan.r) / MIX_SAMPLES;
+
+	LR *out = into(voice.bus);
+	if (voice.resampling) {
+		float resampled[MIX_SAMPLES];
+		resample_voice(voice, step, resampled);
+		mix_mono_to_stereo(&out[0].l, resampled, MIX_SAMPLES, start_pan.l, start_pan.r, pan_step.l, pan_step.r);
+	} else {
+		//mix in runs of samples that don't cross the end of the data (or of a stream's buffer):
+		read_voice(voice, MIX_SAMPLES, [&](uint32_t i, float const *samples, uint32_t run) {
+			mix_mono_to_stereo(&out[i].l, samples, run,
+				start_pan.l + float(i) * pan_step.l, start_pan.r + float(i) * pan_step.r,
+				pan_step.l, pan_step.r);
+			push_history(voice, samples, run);
+		});
+	}
+
+	voice.real = voice.mix;
+	voice.fresh = false;
+}
+
+//helper: keep time (and ramps) going for a virtual voice over this block, without mixing it:
+void advance_voice(Voice &voice, BlockValues const &block) {
+	uint64_t step = step_voice_rate(voice, block.start_position, block.end_position);
+	if (!voice.resampling && step != (uint64_t(1) << 32)) start_resampling(voice);
+
+	if (!(voice.pan.value == voice.pan.value)) {
+		step_position_ramp(voice.position);
+		step_value_ramp(voice.half_volume_radius);
+	} else {
+		step_value_ramp(voice.pan);
+	}
+	step_value_ramp(voice.volume);
+
+	//(a resampled voice's history goes stale, but it fades back in if it becomes real again)
+	uint32_t advance = MIX_SAMPLES;
+	if (voice.resampling) {
+		uint64_t end = uint64_t(voice.phase) + MIX_SAMPLES * step;
+		advance = uint32_t(end >> 32);
+		voice.phase = uint32_t(end);
+	}
+	if (voice.stream != -1U) {
+		read_voice(voice, advance, [](uint32_t, float const *, uint32_t){ });
+	} else if (voice.loop) {
+		voice.i = uint32_t((uint64_t(voice.i) + advance) % voice.size);
+	} else {
+		voice.i = std::min(voice.size, voice.i + advance);
+	}
+
+	voice.real = voice.mix;
+	voice.fresh = false;
+}
+
+//helper: if the voice at active[a] has finished, hand it back to the game thread and erase it from 'active':
+// (order doesn't matter, so it's erased by moving the last one there; returns true if it was)
+bool retire_if_finished(uint32_t a) {
+	Voice &voice = voices[active[a]];
+	//(a resampled voice that is being mixed has a little more to play after its last sample is read -- until the filters are past it)
+	if ((out_of_samples(voice) && !(voice.resampling && voice.real && voice.silent < MAX_TAPS))
+	 || (voice.stopping && voice.volume.value == 0.0f)) { //sample has finished
+		voice.stopped = true;
+		bool pushed = finished.push(active[a]);
+		assert(pushed && "finished has room for every voice");
+		(void)pushed;
+		active[a] = active[--active_count];
+		return true;
+	}
+	return false;
+}
+
+//helper: let other threads (or the other half of this core) have a go while spinning:
+inline void spin_pause() {
+	#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+	_mm_pause();
+	#endif
+}
+
+//helper: claim chunks of block number 'number' and mix their voices, until none are left to claim (see 'mixing'):
+template< typename F >
+void mix_chunks(uint32_t number, F const &into) {
+	uint64_t claim = mixing.claim.load(std::memory_order_acquire);
+	while (uint32_t(claim >> 32) == number && uint32_t(claim) > 0) {
+		//(on success, 'claim' is the value just replaced -- and its bottom bits count this chunk)
+		if (!mixing.claim.compare_exchange_weak(claim, claim - 1, std::memory_order_acquire, std::memory_order_acquire)) continue;
+		uint32_t begin = (uint32_t(claim) - 1) * mixing.chunk;
+		uint32_t end = std::min(begin + mixing.chunk, mixing.voice_count);
+		for (uint32_t v = begin; v < end; ++v) {
+			mix_voice(voices[mixing.voices[v]], mixing.block, into);
+		}
+		mixing.mixed_chunks.fetch_add(1, std::memory_order_release);
+		claim = mixing.claim.load(std::memory_order_acquire);
+	}
+}
+
+//helper: pin the calling thread to a core (best effort -- and not at all where there is no way to ask):
+void pin_to_core(uint32_t core) {
+	if (core >= std::thread::hardware_concurrency()) return;
+	#if defined(_WIN32)
+	if (core < 8 * sizeof(DWORD_PTR)) SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+	#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	#else
+	(void)core; //(e.g., macOS only takes affinity hints, and the scheduler does fine on its own)
+	#endif
+}
+
+//A mixer worker -- waits for blocks to mix, and mixes chunks of them into its own buffers:
+void run_mixer_worker(MixerWorker *worker) {
+	pin_to_core(worker->core);
+
+	//wait for the next block by spinning for a little while (when rendering offline, blocks come back to back),
+	// then by parking until the audio thread starts one (a worker that is slow to wake mixes less of the block, or none of it,
+	// since the other threads claim its share):
+	constexpr std::chrono::microseconds const SPIN_FOR(500);
+
+	auto into = [worker](uint32_t b) {
+		if (!worker->busy[b]) {
+			std::fill(&worker->bus_buffers[b][0].l, &worker->bus_buffers[b][0].l + 2 * MIX_SAMPLES, 0.0f);
+			worker->busy[b] = true;
+		}
+		return worker->bus_buffers[b];
+	};
+
+	uint32_t last = 0; //(the audio thread numbers blocks from 1)
+	auto last_worked = std::chrono::steady_clock::now();
+	while (!mixing.quit.load(std::memory_order_acquire)) {
+		uint32_t number = uint32_t(mixing.claim.load(std::memory_order_acquire) >> 32);
+		if (number != last) {
+			last = number;
+			#ifdef SOUND_CHECK_ALLOCATIONS
+			in_mix_block = true;
+			#endif
+			mix_chunks(number, into);
+			#ifdef SOUND_CHECK_ALLOCATIONS
+			in_mix_block = false;
+			#endif
+			last_worked = std::chrono::steady_clock::now();
+		} else if (std::chrono::steady_clock::now() - last_worked < SPIN_FOR) {
+			spin_pause();
+		} else {
+			std::unique_lock< std::mutex > lock(mixing.park_mutex);
+			mixing.parked.fetch_add(1, std::memory_order_seq_cst);
+			mixing.park.wait(lock, [last](){
+				return mixing.quit.load(std::memory_order_acquire)
+				    || uint32_t(mixing.claim.load(std::memory_order_seq_cst) >> 32) != last;
+			});
+			mixing.parked.fetch_sub(1, std::memory_order_relaxed);
+			last_worked = std::chrono::steady_clock::now();
+		}
+	}
+}
 
 //The audio callback -- invoked by SDL when it needs more sound to play:
 void mix_audio(void *, Uint8 *buffer_, int len) {
 	assert(buffer_); //should always have some audio buffer
-
-	struct LR {
-		float l;
-		float r;
-	};
-	static_assert(sizeof(LR) == 8, "Sample is packed");
 	assert(len == MIX_SAMPLES * sizeof(LR)); //should always have the expected number of samples
-	LR *buffer = reinterpret_cast< LR * >(buffer_);
+	(void)len;
+
+	mix_block(reinterpret_cast< LR * >(buffer_));
+}
+
+//The mixer -- doesn't know or care whether it's called from the audio device or Sound::render():
+void mix_block(LR *buffer) {
+	#ifdef SOUND_CHECK_ALLOCATIONS
+	in_mix_block = true;
+	#endif
+
+	//catch up on what the game has asked for since the last block:
+	Command command;
+	while (commands.pop(&command)) {
+		apply_command(command);
+	}
 
 	//zero the output buffer:
 	for (uint32_t s = 0; s < MIX_SAMPLES; ++s) {
@@ -341,98 +1873,215 @@ void mix_audio(void *, Uint8 *buffer_, int len) {
 	glm::vec3 end_position =  Sound::listener.position.value;
 	glm::vec3 end_right =  Sound::listener.right.value;
 
-	//add audio from each playing sample into the buffer:
-	for (auto si = playing_samples.begin(); si != playing_samples.end(); /* later */) {
-		Sound::PlayingSample &playing_sample = **si; //much more convenient than writing ** everywhere.
+	//how much each bus could scale the samples in it this block (buses feed into lower-numbered ones, so parents come first):
+	for (uint32_t b = 0; b < bus_count; ++b) {
+		BusState &bus = buses[b];
+		BusState const &now = bus;
+		Sound::Ramp< float > volume = now.volume;
+		step_value_ramp(volume);
+		bus.reach = std::max(std::abs(bus.volume.value), std::abs(volume.value)) * (b == 0 ? 1.0f : buses[bus.parent].reach);
+		bus.busy = false;
+	}
+
+	//figure out how loud every playing sample could be over this block:
+	// (this is just volume and distance -- panning only ever makes a sample quieter --
+	//  so that voices which don't end up being mixed never pay for the full panning computation)
+	uint32_t audible = 0;
+	for (uint32_t a = 0; a < active_count; ++a) {
+		Voice &voice = voices[active[a]];
+		Voice const &now = voice;
 
-		//Figure out sample panning/volume at start...
-		LR start_pan;
-		if (!(playing_sample.pan.value == playing_sample.pan.value)) {
+		//(stepping copies of the ramps -- the voice's own ramps are stepped when it is mixed or advanced)
+		Sound::Ramp< float > volume = now.volume;
+		step_value_ramp(volume);
+
+		float start_gain, end_gain;
+		if (!(voice.pan.value == voice.pan.value)) {
 			//3D panning
-			compute_pan_from_listener_and_position(
-				start_position, start_right,
-				playing_sample.position.value,
-				playing_sample.half_volume_radius.value,
-				&start_pan.l, &start_pan.r);
-
-			step_position_ramp(playing_sample.position);
-			step_value_ramp(playing_sample.half_volume_radius);
+			start_gain = compute_gain_bound_from_listener_and_position(
+				start_position,
+				voice.position.value,
+				voice.half_volume_radius.value);
+
+			Sound::Ramp< glm::vec3 > position = now.position;
+			Sound::Ramp< float > half_volume_radius = now.half_volume_radius;
+			step_position_ramp(position);
+			step_value_ramp(half_volume_radius);
+
+			end_gain = compute_gain_bound_from_listener_and_position(
+				end_position,
+				position.value,
+				half_volume_radius.value);
 		} else {
 			//2D panning
-			compute_pan_weights(playing_sample.pan.value, &start_pan.l, &start_pan.r);
-
-			step_value_ramp(playing_sample.pan);
+			start_gain = end_gain = 1.0f;
 		}
-		start_pan.l *= start_volume * playing_sample.volume.value;
-		start_pan.r *= start_volume * playing_sample.volume.value;
 
-		step_value_ramp(playing_sample.volume);
+		voice.loudness = std::max(
+			std::abs(start_volume * voice.volume.value) * start_gain,
+			std::abs(end_volume * volume.value) * end_gain) * buses[voice.bus].reach;
 
-		//..and end of the mix period:
-		LR end_pan;
-		if (!(playing_sample.pan.value == playing_sample.pan.value)) {
-			//3D panning
-			compute_pan_from_listener_and_position(
-				end_position, end_right,
-				playing_sample.position.value,
-				playing_sample.half_volume_radius.value,
-				&end_pan.l, &end_pan.r);
-		} else {
-			//2D panning
-			compute_pan_weights(playing_sample.pan.value, &end_pan.l, &end_pan.r);
+		//voices too quiet to hear are never mixed; the rest are candidates for a real voice:
+		voice.mix = false;
+		if (voice.loudness >= INAUDIBLE) {
+			candidates[audible++] = active[a];
 		}
+	}
 
-		end_pan.l *= end_volume * playing_sample.volume.value;
-		end_pan.r *= end_volume * playing_sample.volume.value;
+	//pick which audible voices get mixed -- the highest-priority (then loudest) ones, up to the budget:
+	if (audible > voice_budget) {
+		std::nth_element(candidates, candidates + voice_budget, candidates + audible, [](uint32_t x, uint32_t y) {
+			if (voices[x].priority != voices[y].priority) return voices[x].priority > voices[y].priority;
+			return voices[x].loudness > voices[y].loudness;
+		});
+		for (uint32_t c = voice_budget; c < audible; ++c) {
+			if (voices[candidates[c]].real) voice_stats.steals += 1;
+		}
+		audible = voice_budget;
+	}
+	for (uint32_t c = 0; c < audible; ++c) {
+		voices[candidates[c]].mix = true;
+	}
 
-		//figure out a step to add at each sample so that pan will move smoothly from start to end:
-		LR pan = start_pan;
-		LR pan_step;
-		pan_step.l = (end_pan.l - start_pan.l) / MIX_SAMPLES;
-		pan_step.r = (end_pan.r - start_pan.r) / MIX_SAMPLES;
+	//add audio from each real sample into the buffer, and just advance the virtual ones:
+	BlockValues block;
+	block.start_volume = start_volume;
+	block.end_volume = end_volume;
+	block.start_position = start_position;
+	block.start_right = start_right;
+	block.end_position = end_position;
+	block.end_right = end_right;
+
+	//(voices that were real last block are still mixed this one, to fade them out)
+	uint32_t mixed = 0;
+	for (uint32_t a = 0; a < active_count; ++a) {
+		Voice const &voice = voices[active[a]];
+		if (voice.mix || voice.real) mixing.voices[mixed++] = active[a];
+	}
 
-		assert(playing_sample.i < playing_sample.data.size());
+	auto into = [buffer](uint32_t b) {
+		return bus_input(b, buffer);
+	};
 
-		for (uint32_t i = 0; i < MIX_SAMPLES; ++i) {
-			//mix one sample based on current pan values:
-			buffer[i].l += pan.l * playing_sample.data[playing_sample.i];
-			buffer[i].r += pan.r * playing_sample.data[playing_sample.i];
+	if (!mixing.workers.empty() && mixed >= PARALLEL_VOICES) {
+		//hand the real voices out in chunks (a few per thread, so threads that start late or run slow can be made up for):
+		uint32_t threads = uint32_t(mixing.workers.size()) + 1;
+		mixing.block = block;
+		mixing.voice_count = mixed;
+		mixing.chunk = std::max(2u, mixed / (4 * threads));
+		uint32_t chunks = (mixed + mixing.chunk - 1) / mixing.chunk;
+		mixing.mixed_chunks.store(0, std::memory_order_relaxed);
+		uint32_t number = uint32_t(mixing.claim.load(std::memory_order_relaxed) >> 32) + 1;
+		if (number == 0) number = 1; //(0 is what workers start out having seen)
+		mixing.claim.store((uint64_t(number) << 32) | chunks, std::memory_order_seq_cst);
+
+		//wake any parked workers:
+		// (taking the lock means a worker can't be between checking 'claim' and waiting; it is only ever held briefly)
+		if (mixing.parked.load(std::memory_order_seq_cst) != 0) {
+			{ std::lock_guard< std::mutex > lock(mixing.park_mutex); }
+			mixing.park.notify_all();
+		}
 
-			//update position in sample:
-			playing_sample.i += 1;
-			if (playing_sample.i == playing_sample.data.size()) {
-				if (playing_sample.loop) {
-					playing_sample.i = 0;
-				} else {
-					break;
-				}
+		//advance the virtual voices while the workers get going, then join in:
+		for (uint32_t a = 0; a < active_count; ++a) {
+			Voice &voice = voices[active[a]];
+			if (!(voice.mix || voice.real)) advance_voice(voice, block);
+		}
+		mix_chunks(number, into);
+
+		//wait for the chunks other threads are still mixing:
+		// (this only ever waits on chunks already underway -- never on a worker that hasn't woken up --
+		//  so after a short spin it just yields, in case the thread it's waiting on was preempted)
+		for (uint32_t spins = 0; mixing.mixed_chunks.load(std::memory_order_acquire) != chunks; ++spins) {
+			if (spins < 4096) spin_pause();
+			else std::this_thread::yield();
+		}
+
+		//add up what each worker mixed:
+		for (auto &worker : mixing.workers) {
+			for (uint32_t b = 0; b < bus_count; ++b) {
+				if (!worker->busy[b]) continue;
+				mix_stereo(&bus_input(b, buffer)[0].l, &worker->bus_buffers[b][0].l, MIX_SAMPLES, 1.0f, 0.0f);
+				worker->busy[b] = false;
 			}
+		}
+
+		//hand finished voices back to the game thread:
+		for (uint32_t a = 0; a < active_count; /* later */) {
+			if (!retire_if_finished(a)) ++a;
+		}
+	} else {
+		for (uint32_t a = 0; a < active_count; /* later */) {
+			Voice &voice = voices[active[a]];
+			if (voice.mix || voice.real) mix_voice(voice, block, into);
+			else advance_voice(voice, block);
+			if (!retire_if_finished(a)) ++a;
+		}
+	}
 
-			//update pan values:
-			pan.l += pan_step.l;
-			pan.r += pan_step.r;
+	//run each bus's effects and mix it into its parent (children are higher-numbered, so come first):
+	for (uint32_t b = bus_count; b-- > 0; ) {
+		BusState &bus = buses[b];
+		float start_gain = bus.volume.value;
+		step_value_ramp(bus.volume);
+		float end_gain = bus.volume.value;
+
+		bool last_of_tail = false;
+		if (bus.busy) {
+			bus.tail = bus_tail(bus);
+		} else if (bus.tail > 0) {
+			//no input, but the effects are still ringing:
+			bus_input(b, buffer);
+			bus.tail -= 1;
+			last_of_tail = (bus.tail == 0);
+		} else {
+			continue; //(idle -- nothing to do)
+		}
+
+		LR *mix = (b == 0 ? buffer : bus_buffers[b]);
+		for (uint32_t e = 0; e < bus.effect_count; ++e) {
+			BusEffect &effect = bus.effects[e];
+			if (effect.type == BusEffect::FilterEffect) {
+				effect.filter.process(&mix[0].l, MIX_SAMPLES);
+				if (last_of_tail) effect.filter.reset(); //(so what's left doesn't decay into denormals while the bus is idle)
+			} else if (effect.type == BusEffect::CompressorEffect) {
+				effect.compressor.process(&mix[0].l, MIX_SAMPLES);
+				if (last_of_tail) effect.compressor.reset();
+			} else {
+				//(by the end of its tail, a reverb's history is all silence anyway)
+				effect.reverb->process(&mix[0].l, effect.wet, effect.dry);
+			}
 		}
 
-		if (playing_sample.i >= playing_sample.data.size()
-		 || (playing_sample.stopping && playing_sample.volume.value == 0.0f)) { //sample has finished
-		 	playing_sample.stopped = true;
-			//erase from list:
-			auto old = si;
-			++si;
-			playing_samples.erase(old);
+		if (b == 0) {
+			if (start_gain != 1.0f || end_gain != 1.0f) {
+				float step = (end_gain - start_gain) / MIX_SAMPLES;
+				for (uint32_t s = 0; s < MIX_SAMPLES; ++s) {
+					float gain = start_gain + float(s) * step;
+					mix[s].l *= gain;
+					mix[s].r *= gain;
+				}
+			}
 		} else {
-			++si;
+			mix_stereo(&bus_input(bus.parent, buffer)[0].l, &mix[0].l, MIX_SAMPLES, start_gain, (end_gain - start_gain) / MIX_SAMPLES);
 		}
 	}
 
+	voice_stats.playing = active_count;
+	voice_stats.real = mixed;
+
 	/*//DEBUG: report output power:
 	float max_power = 0.0f;
 	for (uint32_t s = 0; s < MIX_SAMPLES; ++s) {
 		max_power = std::max(max_power, (buffer[s].l * buffer[s].l + buffer[s].r * buffer[s].r));
 	}
-	std::cout << "Max Power: " << std::sqrt(max_power) << "; playing samples: " << playing_samples.size() << std::endl; //DEBUG
+	std::cout << "Max Power: " << std::sqrt(max_power) << "; playing samples: " << active_count << std::endl; //DEBUG
 	*/
 
+	#ifdef SOUND_CHECK_ALLOCATIONS
+	in_mix_block = false;
+	#endif
+
 }
 
 
@@ -2,7 +2,10 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <string>
 #include <cmath>
@@ -12,17 +15,41 @@
 
 namespace Sound {
 
+struct StreamSource; //(defined in Sound.cpp)
+
 //Sample objects hold mono (one-channel) audio.
 struct Sample {
+	//How a sample's audio is kept in memory:
+	enum class Storage {
+		Decoded, //all of it, as floats (about 11MB per minute)
+		Int16, //all of it, as 16-bit integers (half the memory; converted as it is mixed)
+		ADPCM, //all of it, as IMA-ADPCM (about an eighth of the memory, and a little noisier; decoded as it is mixed)
+		Streamed, //('.opus' only) just the compressed file; each playing copy is decoded a little ahead of the mixer by a background thread
+	};
+
 	//Load from a '.wav' or '.opus' file.
-	//  will warn and convert if sound is not already 48kHz mono:
-	Sample(std::string const &filename);
+	//  will warn and convert if sound is not already mono;
+	//  '.wav' files recorded at less than 48kHz keep their own rate (and are resampled as they play), higher ones are converted to 48kHz:
+	//  (use Storage::Streamed for long sounds like music; at most MaxStreams of them can be playing at once)
+	Sample(std::string const &filename, Storage storage = Storage::Decoded);
 	
-	//Directly supply an audio buffer:
-	Sample(std::vector< float > const &data);
+	//Directly supply an audio buffer, recorded at 'rate' samples per second: (storage can't be Streamed)
+	Sample(std::vector< float > const &data, Storage storage = Storage::Decoded, uint32_t rate = 48000);
+
+	Storage storage = Storage::Decoded;
+
+	//samples per second (a sample that isn't at the mixer's 48kHz plays through the resampler):
+	uint32_t rate = 48000;
 
-	//sample data is stored as 48kHz, mono, floating-point:
+	//sample data is stored as mono, floating-point:
 	std::vector< float > data;
+
+	//...unless storage is Int16 or ADPCM, in which case this holds it, encoded:
+	std::vector< uint8_t > encoded;
+	uint32_t encoded_samples = 0;
+
+	//...unless the sample is streamed, in which case this holds the file instead:
+	std::shared_ptr< StreamSource const > stream;
 };
 
 //Ramp<> manages values that should be smoothly interpolated
@@ -48,43 +75,76 @@ struct Ramp {
 	float ramp = 0.0f;
 };
 
-// 'PlayingSample' objects book-keep samples that are currently playing:
+//The mixer keeps a fixed pool of voices (nothing is allocated on the audio thread);
+// this is how many samples can be playing at once:
+constexpr uint32_t MaxVoices = 1024;
+
+//Streamed samples each need a buffer for their decoded audio; this is how many can be playing at once:
+constexpr uint32_t MaxStreams = 32;
+
+//How a playing sample is resampled when it isn't playing at exactly 48kHz (because of its own rate, its pitch, or Doppler shift):
+enum class Resampler : uint8_t {
+	Linear, //straight-line interpolation between samples; cheapest, but dulls highs and adds some aliasing
+	Sinc8, //8-tap windowed sinc (the default; fine for most effects)
+	Sinc32, //32-tap windowed sinc; for music and other samples that are easy to listen closely to
+};
+
+// 'PlayingSample' is a handle to a sample that was started with play/loop/...:
+//  it's a small value, fine to copy around and keep for as long as you like.
+//  once the sample is done playing its handle goes stale, and calls through it are ignored.
 struct PlayingSample {
-	//change the panning or volume of a playing sample (and do proper locking);
+	//change the panning or volume of a playing sample (these queue a command for the mixer, so never wait for it);
 	// value will change over 'ramp' seconds to avoid creating audible artifacts:
-	void set_volume(float new_volume, float ramp = 1.0f / 60.0f);
+	void set_volume(float new_volume, float ramp = 1.0f / 60.0f) const;
 	//set the panning of a sample (use only on samples in "2D" mode; no effect on "3D" samples):
-	void set_pan(float new_pan, float ramp = 1.0f / 60.0f);
+	void set_pan(float new_pan, float ramp = 1.0f / 60.0f) const;
 	//set the position of a sample (use only on samples in "3D" mode; no effect on "2D" samples):
-	void set_position(glm::vec3 const &new_position, float ramp = 1.0f / 60.0f);
+	void set_position(glm::vec3 const &new_position, float ramp = 1.0f / 60.0f) const;
 	//set the half-volume radius (use only on "3D" playing sounds):
-	void set_half_volume_radius(float new_radius, float ramp = 1.0f / 60.0f);
+	void set_half_volume_radius(float new_radius, float ramp = 1.0f / 60.0f) const;
+
+	//change how fast the sample plays (2.0f is an octave up and twice as fast; 0.5f an octave down and half as fast):
+	// (samples never play faster than 4x or slower than 1/64x 48kHz, whatever their rate, pitch, and Doppler shift)
+	void set_pitch(float new_pitch, float ramp = 1.0f / 60.0f) const;
+	//pick the quality (and cost) of resampling for this sample (see Resampler; the default is Sinc8):
+	void set_resampler(Resampler resampler) const;
 
 	//'stop' will fade sample out over 'ramp' seconds and then remove it from the active samples:
-	void stop(float ramp = 1.0f / 60.0f);
+	void stop(float ramp = 1.0f / 60.0f) const;
+
+	//is the sample still playing?
+	// (as of the last time the game thread heard from the mixer, so this may lag by up to a block)
+	bool playing() const;
+
+	//internals:
+	uint32_t voice = -1U; //slot in the voice pool (-1U if play failed / default-constructed)
+	uint32_t generation = 0; //which use of that slot this handle refers to
+};
+
+//Buses group playing samples (say: music, effects, and UI) so each group can have its own volume and effects.
+// Every sample plays into a bus (the master bus, unless play() is given another), and every bus but the master feeds into a 'parent' bus.
+// Effects run once per bus, on the mix of everything in it, so they cost the same however many samples are playing.
+// (a bus with nothing playing into it -- and no reverb tail left to play out -- is skipped entirely)
+constexpr uint32_t MaxBuses = 16;
+constexpr uint32_t MaxBusEffects = 4; //(per bus)
+
+struct Bus {
+	enum class Filter : uint8_t { LowPass, HighPass, BandPass, Notch, Peaking, LowShelf, HighShelf };
+
+	//set the bus's volume (applied after its effects):
+	void set_volume(float new_volume, float ramp = 1.0f / 60.0f) const;
+
+	//effects run in the order they are added; each add_* returns the effect's place in that order
+	// (and throws if the bus already has MaxBusEffects):
+	uint32_t add_filter(Filter type, float frequency, float q = 0.7071f, float gain_db = 0.0f) const; //(gain_db only matters for Peaking and the shelves)
+	uint32_t add_compressor(float threshold_db, float ratio, float attack = 0.005f, float release = 0.1f, float makeup_db = 0.0f) const; //(attack and release in seconds)
+	uint32_t add_reverb(Sample const &impulse_response, float wet = 0.3f, float dry = 1.0f) const; //(impulse response must be a Decoded, 48kHz sample)
+	//change the settings of a filter added with add_filter (gently enough to sweep it, e.g. to muffle everything underwater):
+	void set_filter(uint32_t effect, Filter type, float frequency, float q = 0.7071f, float gain_db = 0.0f) const;
+	void clear_effects() const;
 
 	//internals:
-	//NOTE: PlayingSample is used in a separate thread; so setting these values directly
-	// may result in bad results. Instead, use the functions above, which perform locking!
-	std::vector< float > const &data; //reference to sample data being played
-	uint32_t i = 0; //next data value to read
-	bool loop = false; //should playback loop after data runs out?
-	bool stopping = false; //is playing stopping?
-	bool stopped = false; //was playback stopped (either by running out of sample, or by stop())?
-
-	Ramp< float > volume = Ramp< float >(1.0f);
-
-	//2D playback panning control: ('NaN' if sound played in 3D mode)
-	Ramp< float > pan = Ramp< float >(std::numeric_limits< float >::quiet_NaN());
-
-	//3D playback panning control: ('NaN' if sound played in 2D mode)
-	Ramp< glm::vec3 > position = Ramp< glm::vec3 >(std::numeric_limits< float >::quiet_NaN());
-	Ramp< float > half_volume_radius = std::numeric_limits< float >::quiet_NaN();
-
-	PlayingSample(Sample const &sample_, float volume_, float pan_, bool loop_)
-		: data(sample_.data), loop(loop_), volume(volume_), pan(pan_) { }
-	PlayingSample(Sample const &sample_, float volume_, glm::vec3 const &position_, float half_volume_radius_, bool loop_)
-		: data(sample_.data), loop(loop_), volume(volume_), position(position_), half_volume_radius(half_volume_radius_) { }
+	uint32_t index = 0; //slot in the bus pool (0 is the master bus)
 };
 
 // ------- global functions -------
@@ -93,41 +153,95 @@ void init(); //call Sound::init() from main.cpp before using any member function
 
 void shutdown(); //call Sound::shutdown() from main.cpp to gracefully(-ish) exit
 
+//Running without an audio device (benchmarks, tests, rendering to a file):
+// init_offline() gets the mixer ready as init() would, but nothing plays what it mixes;
+// instead, each call to render() mixes the next 'blocks' * BlockFrames frames of audio into 'out'
+// (48kHz, interleaved left/right floats), and everything else works just as it does with a device.
+// (so, given the same calls, the output is the same every time -- except for streamed samples, which depend on the decoder thread keeping up)
+constexpr uint32_t BlockFrames = 1024; //frames mixed at a time
+void init_offline(); //(instead of init(); call shutdown() when done)
+void render(uint32_t blocks, float *out);
+
+//Make a new bus that feeds into 'parent' (throws if all MaxBuses are in use; buses last until shutdown()):
+Bus add_bus(Bus const &parent = Bus());
+
 //Call 'Sound::play' to play a sample once.
 //  if you hang on to the return value, you can change the panning, volume, or stop playback early.
-std::shared_ptr< PlayingSample > play(
+//  (the sample must stay around until it's done playing)
+//  'priority' matters when more samples are audible than the voice budget (see set_voice_budget),
+//  and 'bus' is where the sample is mixed (see Bus):
+PlayingSample play(
 	Sample const &sample,
 	float volume = 1.0f,
-	float pan = 0.0f //-1.0f == hard left, 1.0f == hard right
+	float pan = 0.0f, //-1.0f == hard left, 1.0f == hard right
+	int32_t priority = 0,
+	Bus const &bus = Bus()
 );
 //The play_3D version will play a sample in '3D' mode (that is, panning determined by listener position):
-std::shared_ptr< PlayingSample > play_3D(
+PlayingSample play_3D(
 	Sample const &sample,
 	float volume,
 	glm::vec3 const &position,
-	float half_volume_radius = std::numeric_limits< float >::infinity()
+	float half_volume_radius = std::numeric_limits< float >::infinity(),
+	int32_t priority = 0,
+	Bus const &bus = Bus()
 );
 
 //Call 'Sound::loop' to play a sample ~forever~.
 //  if you hang on to the return value, you can change the panning, volume, or stop playback.
-std::shared_ptr< PlayingSample > loop(
+PlayingSample loop(
 	Sample const &sample,
 	float volume = 1.0f,
-	float pan = 0.0f //-1.0f == hard left, 1.0f == hard right
+	float pan = 0.0f, //-1.0f == hard left, 1.0f == hard right
+	int32_t priority = 0,
+	Bus const &bus = Bus()
 );
 //The loop_3D version will loop a sample in '3D' mode (that is, panning determined by listener position):
-std::shared_ptr< PlayingSample > loop_3D(
+PlayingSample loop_3D(
 	Sample const &sample,
 	float volume,
 	glm::vec3 const &position,
-	float half_volume_radius = std::numeric_limits< float >::infinity()
+	float half_volume_radius = std::numeric_limits< float >::infinity(),
+	int32_t priority = 0,
+	Bus const &bus = Bus()
 );
 
+//Only so many playing samples ("real" voices) are actually mixed each block, so mixing time stays bounded:
+// samples too quiet to hear (e.g. far-away 3D samples) are never mixed, and if more than the budget
+// are audible, the highest-priority -- then loudest -- ones are mixed.
+// The others are "virtual": they keep their place in the sample (so they come back in sync
+// when they get loud enough / the crowd thins out) but cost next to nothing.
+void set_voice_budget(uint32_t real_voices); //(default: 64)
+
+struct VoiceStats {
+	uint32_t playing = 0; //samples playing (real or virtual)
+	uint32_t real = 0; //samples mixed in the last block
+	uint64_t promotions = 0; //times a virtual voice became real again
+	uint64_t demotions = 0; //times a real voice became virtual (too quiet, or stolen)
+	uint64_t steals = 0; //times an audible voice went virtual to keep within the budget
+	uint64_t underruns = 0; //times a streamed sample ran out of decoded audio (its decoder fell behind) partway through a block
+};
+VoiceStats get_voice_stats();
+
+//With a big voice budget, mixing can be split between threads: the audio thread plus up to MaxMixerThreads - 1 "mixer workers"
+// (each pinned to a core of its own) take voices a few at a time, mix them into buffers of their own, and those get added up.
+// Whether that pays off depends on the machine -- check with 'sound-bench --threads 1,2,4,8' (blocks with fewer than a few dozen voices are always mixed on the audio thread alone).
+// Takes effect at the next init() / init_offline(), capped at the number of cores; the default is 1 (no workers).
+// (with more than one thread, voices are added up in whatever order the threads get to them,
+//  so the output can differ in the last few bits from run to run)
+constexpr uint32_t MaxMixerThreads = 8;
+void set_mixer_threads(uint32_t threads);
+
+//Doppler shift for "3D" samples: they play faster as they approach the listener and slower as they move away,
+// judging by how fast they (and the listener) move as set_position / set_position_right ramp them.
+// 'speed_of_sound' is in position units per second (343.0f if positions are in meters); 0.0f (the default) turns it off:
+void set_doppler(float speed_of_sound);
+
 //Listener controls the panning of "3D" samples (ones played using the "position" version of the play functions):
 struct Listener {
 	void set_position_right(glm::vec3 const &new_position, glm::vec3 const &new_right, float ramp = 1.0f / 60.0f);
 
-	//internals:
+	//internals (belong to the audio thread):
 	Ramp< glm::vec3 > position = Ramp< glm::vec3 >(0.0f); //listener's location
 	Ramp< glm::vec3 > right = Ramp< glm::vec3 >(1.0f, 0.0f, 0.0f); //unit vector pointing to listener's right
 };
@@ -138,11 +252,15 @@ void stop_all_samples();
 
 //set global volume:
 void set_volume(float new_volume, float ramp = 1.0f / 60.0f);
-extern Ramp< float > volume;
+extern Ramp< float > volume; //(belongs to the audio thread)
+
+//the set_*/stop/play/... functions above hand the mixer commands through a wait-free queue,
+// which it picks up at the start of each block it mixes (so within ~21ms).
+// They never wait for the audio thread, so are fine to call from the game loop as often as you like.
+// (only call them from one thread -- the main thread -- though)
 
 //the audio callback doesn't run between Sound::lock() and Sound::unlock()
-// the set_*/stop/play/... functions already use these helpers, so you shouldn't need
-// to call them unless your code is modifying values directly:
+// you shouldn't need these unless your code is modifying the mixer's values directly:
 void lock();
 void unlock();
 
@@ -0,0 +1,137 @@
+#include "SpriteBatch.hpp"
+#include "SpriteProgram.hpp"
+
+#include "gl_errors.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+//All SpriteBatch instances share a vertex array object and a streaming vertex buffer, initialized (lazily) the first time sprites are drawn:
+
+//n.b. declared static so they don't conflict with similarly named global variables elsewhere:
+static GLuint vertex_buffer = 0;
+static GLuint vertex_buffer_for_sprite_program = 0;
+
+static Load< void > setup_buffers(LoadTagDefault, LoadInfo("SpriteBatch buffers", {&sprite_program}, LoadLazy), nullptr, [](){
+	//set up vertex buffer (filled at every flush):
+	glGenBuffers(1, &vertex_buffer);
+
+	//vertex array mapping buffer for sprite_program:
+	glGenVertexArrays(1, &vertex_buffer_for_sprite_program);
+	glBindVertexArray(vertex_buffer_for_sprite_program);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+
+	glVertexAttribPointer(
+		sprite_program->Position_vec4, //attribute
+		2, //size
+		GL_FLOAT, //type
+		GL_FALSE, //normalized
+		sizeof(SpriteBatch::Vertex), //stride
+		(GLbyte *)0 + offsetof(SpriteBatch::Vertex, Position) //offset
+	);
+	glEnableVertexAttribArray(sprite_program->Position_vec4);
+	//[z and w will be filled in with 0.0 and 1.0 automatically]
+
+	glVertexAttribPointer(
+		sprite_program->TexCoord_vec3, //attribute
+		3, //size
+		GL_FLOAT, //type
+		GL_FALSE, //normalized
+		sizeof(SpriteBatch::Vertex), //stride
+		(GLbyte *)0 + offsetof(SpriteBatch::Vertex, TexCoord) //offset
+	);
+	glEnableVertexAttribArray(sprite_program->TexCoord_vec3);
+
+	glVertexAttribPointer(
+		sprite_program->Color_vec4, //attribute
+		4, //size
+		GL_UNSIGNED_BYTE, //type
+		GL_TRUE, //normalized
+		sizeof(SpriteBatch::Vertex), //stride
+		(GLbyte *)0 + offsetof(SpriteBatch::Vertex, Color) //offset
+	);
+	glEnableVertexAttribArray(sprite_program->Color_vec4);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	GL_ERRORS(); //PARANOIA: make sure nothing strange happened during setup
+});
+
+SpriteBatch::SpriteBatch(glm::mat4 const &world_to_clip_) : world_to_clip(world_to_clip_) {
+}
+
+void SpriteBatch::draw(GLuint texture, TextureAtlas::Region const &region, glm::vec2 const &min, glm::vec2 const &max, glm::u8vec4 const &color, int32_t depth) {
+	sprites.emplace_back(Sprite{depth, texture, min, max, region, color});
+}
+
+void SpriteBatch::flush() {
+	if (sprites.empty()) return;
+
+	setup_buffers.finish();
+
+	//group by texture within each depth (stable, so queue order is kept within a group):
+	std::stable_sort(sprites.begin(), sprites.end(), [](Sprite const &a, Sprite const &b) {
+		if (a.depth != b.depth) return a.depth < b.depth;
+		return a.texture < b.texture;
+	});
+
+	//build all the vertices (two triangles per sprite), remembering where each texture's run starts:
+	//(static so its storage is reused from frame to frame)
+	static std::vector< Vertex > attribs;
+	attribs.clear();
+	attribs.reserve(sprites.size() * 6);
+	struct Run {
+		GLuint texture;
+		GLint first;
+		GLsizei count;
+	};
+	std::vector< Run > runs;
+	for (auto const &s : sprites) {
+		if (runs.empty() || runs.back().texture != s.texture) {
+			runs.emplace_back(Run{s.texture, GLint(attribs.size()), 0});
+		}
+		float layer = float(s.region.layer);
+		Vertex v00(glm::vec2(s.min.x, s.min.y), glm::vec3(s.region.min.x, s.region.min.y, layer), s.color);
+		Vertex v10(glm::vec2(s.max.x, s.min.y), glm::vec3(s.region.max.x, s.region.min.y, layer), s.color);
+		Vertex v11(glm::vec2(s.max.x, s.max.y), glm::vec3(s.region.max.x, s.region.max.y, layer), s.color);
+		Vertex v01(glm::vec2(s.min.x, s.max.y), glm::vec3(s.region.min.x, s.region.max.y, layer), s.color);
+		attribs.insert(attribs.end(), {v00, v10, v11, v00, v11, v01});
+		runs.back().count += 6;
+	}
+
+	//upload once (orphaning last frame's storage so there's no wait for it to be drawn):
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, attribs.size() * sizeof(attribs[0]), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, attribs.size() * sizeof(attribs[0]), attribs.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glUseProgram(sprite_program->program);
+	glUniformMatrix4fv(sprite_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+	glBindVertexArray(vertex_buffer_for_sprite_program);
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glActiveTexture(GL_TEXTURE0);
+
+	for (auto const &run : runs) {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, run.texture);
+		glDrawArrays(GL_TRIANGLES, run.first, run.count);
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	GL_ERRORS();
+
+	sprites.clear();
+}
+
+SpriteBatch::~SpriteBatch() {
+	flush();
+}
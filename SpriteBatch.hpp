@@ -0,0 +1,57 @@
+#pragma once
+
+/*
+ * Helper class for batched drawing of textured quads ("sprites").
+ *
+ * Similar usage pattern to DrawLines: make one, queue sprites, and everything
+ * is drawn when it goes out of scope (or when flush() is called).
+ *
+ * Sprites are drawn in order of 'depth' (lowest first) and then in the
+ * order they were queued; within a depth they are grouped by texture, so a
+ * frame costs one draw call per (depth, texture) pair rather than one per quad.
+ * Since textures are arrays (see texture_atlas.hpp), the layer is part of each
+ * vertex and never splits a batch.
+ *
+ * Sprites are drawn with blending on and depth testing off.
+ */
+
+#include "GL.hpp"
+#include "texture_atlas.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct SpriteBatch {
+	//Start drawing; will remember world_to_clip matrix:
+	SpriteBatch(glm::mat4 const &world_to_clip);
+
+	//queue a quad covering [min,max] (in world space) showing 'region' of the GL_TEXTURE_2D_ARRAY 'texture':
+	void draw(GLuint texture, TextureAtlas::Region const &region, glm::vec2 const &min, glm::vec2 const &max, glm::u8vec4 const &color = glm::u8vec4(0xff), int32_t depth = 0);
+
+	//draw everything queued so far (in one upload):
+	void flush();
+
+	//Finish drawing (flushes):
+	~SpriteBatch();
+
+
+	glm::mat4 world_to_clip;
+
+	struct Vertex {
+		Vertex(glm::vec2 const &Position_, glm::vec3 const &TexCoord_, glm::u8vec4 const &Color_) : Position(Position_), TexCoord(TexCoord_), Color(Color_) { }
+		glm::vec2 Position;
+		glm::vec3 TexCoord; //(s, t, layer)
+		glm::u8vec4 Color;
+	};
+	static_assert(sizeof(Vertex) == 4*2 + 4*3 + 4, "SpriteBatch::Vertex is packed.");
+
+	struct Sprite {
+		int32_t depth;
+		GLuint texture;
+		glm::vec2 min, max;
+		TextureAtlas::Region region;
+		glm::u8vec4 color;
+	};
+	std::vector< Sprite > sprites;
+};
@@ -0,0 +1,57 @@
+#include "SpriteProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+//only SpriteBatch uses this, so it is compiled the first time something is drawn:
+Load< SpriteProgram > sprite_program(LoadTagEarly, LoadInfo("SpriteProgram", {}, LoadLazy), nullptr, new_T< SpriteProgram >);
+
+SpriteProgram::SpriteProgram() {
+	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"in vec4 Position;\n"
+		"in vec3 TexCoord;\n"
+		"in vec4 Color;\n"
+		"out vec3 texCoord;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
+		"	texCoord = TexCoord;\n"
+		"	color = Color;\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"uniform sampler2DArray TEX;\n"
+		"in vec3 texCoord;\n"
+		"in vec4 color;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragColor = texture(TEX, texCoord) * color;\n"
+		"}\n"
+	);
+
+	//look up the locations of vertex attributes:
+	Position_vec4 = glGetAttribLocation(program, "Position");
+	TexCoord_vec3 = glGetAttribLocation(program, "TexCoord");
+	Color_vec4 = glGetAttribLocation(program, "Color");
+
+	//look up the locations of uniforms:
+	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+	GLuint TEX_sampler2DArray = glGetUniformLocation(program, "TEX");
+
+	//set TEX to always refer to texture binding zero:
+	glUseProgram(program);
+	glUniform1i(TEX_sampler2DArray, 0);
+	glUseProgram(0);
+
+	GL_ERRORS();
+}
+
+SpriteProgram::~SpriteProgram() {
+	glDeleteProgram(program);
+	program = 0;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Load.hpp"
+
+//Shader program that draws transformed, colored vertices textured from a texture array:
+struct SpriteProgram {
+	SpriteProgram();
+	~SpriteProgram();
+
+	GLuint program = 0;
+	//Attribute (per-vertex variable) locations:
+	GLuint Position_vec4 = -1U;
+	GLuint TexCoord_vec3 = -1U; //(s, t, layer)
+	GLuint Color_vec4 = -1U;
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+	//Textures:
+	//TEXTURE0 - GL_TEXTURE_2D_ARRAY that is accessed by TexCoord
+};
+
+extern Load< SpriteProgram > sprite_program;
@@ -0,0 +1,90 @@
+#include "StreamRing.hpp"
+
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+StreamRing::StreamRing(size_t region_bytes_) : region_bytes(region_bytes_) {
+	assert(region_bytes % Alignment == 0);
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(region_bytes * Frames), nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GL_ERRORS();
+}
+
+StreamRing::~StreamRing() {
+	for (auto &fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = 0;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void *StreamRing::map(size_t bytes, GLintptr *offset) {
+	assert(offset);
+	bytes = (bytes + Alignment - 1) / Alignment * Alignment;
+
+	if (used + bytes > region_bytes) {
+		//grow: re-specifying the storage orphans the old contents (which earlier frames' draws may still be reading),
+		// so the new storage is free to write everywhere and the old fences no longer matter:
+		region_bytes = std::max(region_bytes * 2, (used + bytes + Alignment - 1) / Alignment * Alignment);
+		for (auto &fence : fences) {
+			if (fence) glDeleteSync(fence);
+			fence = 0;
+		}
+		used = 0;
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(region_bytes * Frames), nullptr, GL_STREAM_DRAW);
+		grows += 1;
+	}
+
+	if (fences[frame]) {
+		//first write to this region since it was last drawn from; wait for the GPU to be done with it:
+		// (with Frames regions that is Frames-1 frames ago, so this rarely blocks)
+		GLenum result = glClientWaitSync(fences[frame], 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			waits += 1;
+			result = glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000)); //(1s)
+		}
+		if (result == GL_WAIT_FAILED || result == GL_TIMEOUT_EXPIRED) {
+			throw std::runtime_error("Stream buffer region " + std::to_string(frame) + " was never released by the GPU.");
+		}
+		glDeleteSync(fences[frame]);
+		fences[frame] = 0;
+	}
+
+	*offset = GLintptr(frame * region_bytes + used);
+	used += bytes;
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	void *data = glMapBufferRange(GL_ARRAY_BUFFER, *offset, GLsizeiptr(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (!data) {
+		GL_ERRORS();
+		throw std::runtime_error("Failed to map " + std::to_string(bytes) + " bytes of a stream buffer.");
+	}
+	return data;
+}
+
+void StreamRing::unmap() {
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	GLboolean intact = glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//(if the contents were lost -- e.g. on a display mode change -- this frame just draws garbage once)
+	(void)intact;
+}
+
+void StreamRing::end_frame() {
+	if (used != 0) {
+		assert(!fences[frame]);
+		fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	frame = (frame + 1) % Frames;
+	used = 0;
+	GL_ERRORS();
+}
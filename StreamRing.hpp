@@ -0,0 +1,56 @@
+#pragma once
+
+/*
+ * StreamRing -- one GL buffer for data that is rewritten every frame.
+ *
+ * The buffer is split into Frames regions, used round-robin: each frame
+ * writes into its own region through an unsynchronized map (so writing
+ * never waits for draws from earlier frames), and end_frame() fences the
+ * region so it is only written again once the GPU is done reading it.
+ *
+ * StreamRing ring(1 << 20);
+ * ...
+ * GLintptr offset;
+ * void *data = ring.map(bytes, &offset); //(in this frame's region)
+ * ...fill data...
+ * ring.unmap();
+ * ...draw from ring.buffer, starting at offset...
+ * ring.end_frame();
+ *
+ * Needs a GL context; only use from the thread that has it.
+ */
+
+#include "GL.hpp"
+
+#include <cstddef>
+
+struct StreamRing {
+	static constexpr uint32_t Frames = 3; //(enough that the GPU is almost never still reading a region when it comes around again)
+	static constexpr size_t Alignment = 16; //map() offsets are multiples of this
+
+	explicit StreamRing(size_t region_bytes);
+	~StreamRing();
+	StreamRing(StreamRing const &) = delete;
+	StreamRing &operator=(StreamRing const &) = delete;
+
+	//map 'bytes' of the current frame's region for writing; sets 'offset' to where they are in 'buffer':
+	// if the region is too small it grows, which discards anything already written this frame
+	// -- so write each frame's data with one map(), as DrawLines::submit_frame() does.
+	void *map(size_t bytes, GLintptr *offset);
+	//finish writing (before drawing from the data):
+	void unmap();
+	//done drawing this frame's data; move on to the next region:
+	void end_frame();
+
+	GLuint buffer = 0; //GL_ARRAY_BUFFER
+	size_t region_bytes = 0;
+
+	//---- internals ----
+	uint32_t frame = 0; //current region
+	size_t used = 0; //bytes of the current region handed out so far
+	GLsync fences[Frames] = {}; //set when a region's draws were submitted
+
+	//for stats / tuning:
+	uint64_t waits = 0; //times map() had to wait for the GPU to finish with a region
+	uint64_t grows = 0;
+};
@@ -0,0 +1,325 @@
+#include "TextShaper.hpp"
+
+#include "Load.hpp"
+#include "gl_errors.hpp"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+#include <hb.h>
+#include <hb-ft.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+//runs are cached per (size, text):
+struct RunKey {
+	float size;
+	std::string text;
+	bool operator==(RunKey const &o) const { return size == o.size && text == o.text; }
+};
+struct RunKeyHash {
+	size_t operator()(RunKey const &key) const {
+		return std::hash< std::string >()(key.text) ^ (std::hash< float >()(key.size) * 0x9e3779b97f4a7c15ULL);
+	}
+};
+
+struct AtlasPage {
+	uint64_t last_used = 0; //layout that last used a glyph on this page
+	uint32_t shelf_y = 0, shelf_x = 0, shelf_height = 0; //shelf packing state
+	std::vector< uint32_t > glyphs; //glyph indices placed here
+};
+
+//frees FreeType objects held in std::unique_ptr's:
+struct FTDone {
+	void operator()(FT_Library library) const { FT_Done_FreeType(library); }
+	void operator()(FT_Face face) const { FT_Done_Face(face); }
+};
+
+struct TextShaper::Internals {
+	AssetView file; //(FreeType reads the font from here as needed)
+	//(held so that a constructor that throws part way still frees them; 'face' is declared second so it goes first)
+	std::unique_ptr< FT_LibraryRec_, FTDone > library;
+	std::unique_ptr< FT_FaceRec_, FTDone > face;
+	hb_font_t *font = nullptr;
+	hb_buffer_t *buffer = nullptr;
+
+	std::unordered_map< RunKey, Run, RunKeyHash > runs;
+
+	struct Slot {
+		AtlasGlyph glyph;
+		int32_t page = -1; //-1 for blank glyphs (which take no space)
+	};
+	std::unordered_map< uint32_t, Slot > slots;
+	AtlasPage pages[Pages];
+	uint64_t layout = 1; //(bumped by begin_layout())
+	bool warned_full = false;
+
+	//find room for a width x height box; returns the page (or -1 if all pages are in use by this layout):
+	int32_t allocate(TextShaper const &shaper, uint32_t width, uint32_t height, glm::uvec2 *at);
+	void reuse(TextShaper const &shaper, uint32_t page);
+};
+
+TextShaper::TextShaper(std::string const &filename) : internals(new Internals) {
+	Internals &in = *internals;
+	in.file = asset_view(filename);
+
+	FT_Library library = nullptr;
+	if (FT_Init_FreeType(&library)) throw std::runtime_error("Failed to initialize FreeType.");
+	in.library.reset(library);
+	FT_Int spread = Spread;
+	if (FT_Property_Set(in.library.get(), "sdf", "spread", &spread)) {
+		throw std::runtime_error("FreeType has no SDF renderer (needs 2.11 or newer).");
+	}
+	FT_Face face = nullptr;
+	if (FT_New_Memory_Face(in.library.get(), reinterpret_cast< FT_Byte const * >(in.file.data), FT_Long(in.file.size), 0, &face)) {
+		throw std::runtime_error("Failed to read font '" + filename + "'.");
+	}
+	in.face.reset(face);
+	if (FT_Set_Pixel_Sizes(in.face.get(), 0, RasterSize)) {
+		throw std::runtime_error("Font '" + filename + "' can't be rendered at " + std::to_string(RasterSize) + " pixels.");
+	}
+
+	//(shaping uses HarfBuzz's own, unhinted, metrics, so runs scale with size and don't depend on the face's FreeType size)
+	hb_face_t *hb_face = hb_ft_face_create_referenced(in.face.get());
+	in.font = hb_font_create(hb_face);
+	hb_face_destroy(hb_face);
+	in.buffer = hb_buffer_create();
+
+	float units = float(in.face->units_per_EM);
+	ascender = in.face->ascender / units;
+	descender = in.face->descender / units;
+	line_height = in.face->height / units;
+}
+
+TextShaper::~TextShaper() {
+	if (texture) {
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+	Internals &in = *internals;
+	if (in.buffer) hb_buffer_destroy(in.buffer);
+	if (in.font) hb_font_destroy(in.font);
+	//(the face and library are freed along with 'internals')
+}
+
+void TextShaper::upload() {
+	//(zero is as far outside a glyph as the field goes, so an empty atlas draws nothing)
+	std::vector< uint8_t > zeros(size_t(PageSize) * PageSize * Pages, 0);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, PageSize, PageSize * Pages, 0, GL_RED, GL_UNSIGNED_BYTE, zeros.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GL_ERRORS();
+
+	load_report_gl_bytes(zeros.size());
+}
+
+TextShaper::Run const &TextShaper::shape(std::string const &text, float size) const {
+	Internals &in = *internals;
+	RunKey key{size, text};
+	auto f = in.runs.find(key);
+	if (f != in.runs.end()) {
+		run_hits += 1;
+		return f->second;
+	}
+	run_misses += 1;
+
+	//(dialog is a few dozen lines, so starting over is rare and cheap)
+	if (in.runs.size() >= MaxRuns) in.runs.clear();
+
+	int scale = int(std::round(size * 64.0f)); //(26.6 fixed point pixels)
+	hb_font_set_scale(in.font, scale, scale);
+	hb_buffer_clear_contents(in.buffer);
+	hb_buffer_add_utf8(in.buffer, text.data(), int(text.size()), 0, int(text.size()));
+	hb_buffer_guess_segment_properties(in.buffer);
+	hb_shape(in.font, in.buffer, nullptr, 0);
+
+	unsigned int length = hb_buffer_get_length(in.buffer);
+	hb_glyph_info_t const *info = hb_buffer_get_glyph_infos(in.buffer, nullptr);
+	hb_glyph_position_t const *pos = hb_buffer_get_glyph_positions(in.buffer, nullptr);
+
+	Run run;
+	run.glyphs.reserve(length);
+	glm::vec2 pen = glm::vec2(0.0f);
+	for (unsigned int i = 0; i < length; ++i) {
+		RunGlyph glyph;
+		glyph.index = info[i].codepoint; //(after shaping, this is a glyph index)
+		glyph.cluster = info[i].cluster;
+		glyph.pen = pen + glm::vec2(pos[i].x_offset, pos[i].y_offset) / 64.0f;
+		run.glyphs.emplace_back(glyph);
+		pen += glm::vec2(pos[i].x_advance, pos[i].y_advance) / 64.0f;
+	}
+	run.width = pen.x;
+
+	return in.runs.emplace(std::move(key), std::move(run)).first->second;
+}
+
+void TextShaper::begin_layout() const {
+	internals->layout += 1;
+}
+
+int32_t TextShaper::Internals::allocate(TextShaper const &shaper, uint32_t width, uint32_t height, glm::uvec2 *at) {
+	//first page with room on its current shelf or for a new one:
+	auto fits = [&](AtlasPage &page) {
+		if (page.shelf_x + width > PageSize) {
+			if (page.shelf_y + page.shelf_height + height > PageSize) return false;
+			page.shelf_y += page.shelf_height;
+			page.shelf_x = 0;
+			page.shelf_height = 0;
+		}
+		if (page.shelf_y + height > PageSize) return false;
+		*at = glm::uvec2(page.shelf_x, page.shelf_y);
+		page.shelf_x += width;
+		page.shelf_height = std::max(page.shelf_height, height);
+		return true;
+	};
+	for (uint32_t p = 0; p < Pages; ++p) {
+		if (fits(pages[p])) return int32_t(p);
+	}
+
+	//...otherwise reuse the least recently used page (as long as the current layout isn't using it):
+	uint32_t oldest = 0;
+	for (uint32_t p = 1; p < Pages; ++p) {
+		if (pages[p].last_used < pages[oldest].last_used) oldest = p;
+	}
+	if (pages[oldest].last_used == layout) return -1;
+	reuse(shaper, oldest);
+	if (!fits(pages[oldest])) return -1; //(can't happen: glyphs are checked to be smaller than a page)
+	return int32_t(oldest);
+}
+
+void TextShaper::Internals::reuse(TextShaper const &shaper, uint32_t p) {
+	AtlasPage &page = pages[p];
+	for (uint32_t index : page.glyphs) {
+		slots.erase(index);
+	}
+	page = AtlasPage();
+
+	//clear the page, so nothing old shows through the gaps between new glyphs:
+	std::vector< uint8_t > zeros(size_t(PageSize) * PageSize, 0);
+	glBindTexture(GL_TEXTURE_2D, shaper.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, p * PageSize, PageSize, PageSize, GL_RED, GL_UNSIGNED_BYTE, zeros.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	shaper.atlas_generation += 1;
+	shaper.pages_reused += 1;
+}
+
+TextShaper::AtlasGlyph const *TextShaper::atlas_glyph(uint32_t index) const {
+	assert(texture && "TextShaper::upload() must be called before laying out text.");
+	Internals &in = *internals;
+
+	auto f = in.slots.find(index);
+	if (f != in.slots.end()) {
+		if (f->second.page >= 0) in.pages[f->second.page].last_used = in.layout;
+		return &f->second.glyph;
+	}
+
+	Internals::Slot slot;
+	if (FT_Load_Glyph(in.face.get(), index, FT_LOAD_DEFAULT)) {
+		throw std::runtime_error("Failed to load glyph " + std::to_string(index) + ".");
+	}
+	FT_GlyphSlot ft_glyph = in.face->glyph;
+	if (ft_glyph->format == FT_GLYPH_FORMAT_OUTLINE && ft_glyph->outline.n_points != 0) {
+		if (FT_Render_Glyph(ft_glyph, FT_RENDER_MODE_SDF)) {
+			throw std::runtime_error("Failed to render glyph " + std::to_string(index) + ".");
+		}
+		FT_Bitmap const &bitmap = ft_glyph->bitmap;
+		glm::uvec2 size = glm::uvec2(bitmap.width, bitmap.rows);
+		if (size.x + 1 > PageSize || size.y + 1 > PageSize) {
+			throw std::runtime_error("Glyph " + std::to_string(index) + " is too large for a text atlas page.");
+		}
+
+		//(one texel of gap between glyphs, so linear filtering never bleeds)
+		glm::uvec2 at;
+		slot.page = in.allocate(*this, size.x + 1, size.y + 1, &at);
+		if (slot.page < 0) {
+			if (!in.warned_full) {
+				std::cerr << "WARNING: text atlas is full; some glyphs will be left out." << std::endl;
+				in.warned_full = true;
+			}
+			return nullptr;
+		}
+		at.y += uint32_t(slot.page) * PageSize;
+
+		//(FreeType rows are top first; the atlas, like SdfFont's, is bottom row first)
+		std::vector< uint8_t > texels(size_t(size.x) * size.y);
+		for (uint32_t y = 0; y < size.y; ++y) {
+			std::memcpy(texels.data() + size_t(y) * size.x, bitmap.buffer + ptrdiff_t(size.y - 1 - y) * bitmap.pitch, size.x);
+		}
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, at.x, at.y, size.x, size.y, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		GL_ERRORS();
+
+		glm::vec2 atlas_size = glm::vec2(PageSize, PageSize * Pages);
+		slot.glyph.min = glm::vec2(ft_glyph->bitmap_left, ft_glyph->bitmap_top - int32_t(size.y));
+		slot.glyph.max = slot.glyph.min + glm::vec2(size);
+		slot.glyph.tex_min = glm::vec2(at) / atlas_size;
+		slot.glyph.tex_max = glm::vec2(at + size) / atlas_size;
+
+		AtlasPage &page = in.pages[slot.page];
+		page.glyphs.emplace_back(index);
+		page.last_used = in.layout;
+		glyphs_rendered += 1;
+	}
+
+	return &in.slots.emplace(index, slot).first->second.glyph;
+}
+
+void ShapedText::set(TextShaper const &shaper_, std::string const &text_, float size_, glm::vec2 const &origin_, glm::vec2 const &em_) {
+	shaper = &shaper_;
+	text = text_;
+	size = size_;
+	origin = origin_;
+	em = em_;
+	layout();
+}
+
+void ShapedText::layout() {
+	assert(shaper);
+	TextShaper::Run const &run = shaper->shape(text, size);
+	shaper->begin_layout();
+
+	glm::vec2 scale = em / size; //pixels at 'size' -> units of 'origin'
+	float raster_scale = size / float(TextShaper::RasterSize); //atlas pixels -> pixels at 'size'
+
+	//two triangles per glyph (blank ones too, so the n'th glyph is the n'th quad):
+	std::vector< SdfText::Vertex > attribs;
+	attribs.reserve(run.glyphs.size() * 6);
+	TextShaper::AtlasGlyph const blank;
+	for (auto const &g : run.glyphs) {
+		TextShaper::AtlasGlyph const *glyph = shaper->atlas_glyph(g.index);
+		if (!glyph) glyph = &blank; //(atlas full)
+		glm::vec2 min = origin + (g.pen + glyph->min * raster_scale) * scale;
+		glm::vec2 max = origin + (g.pen + glyph->max * raster_scale) * scale;
+		SdfText::Vertex v00(glm::vec2(min.x, min.y), glm::vec2(glyph->tex_min.x, glyph->tex_min.y));
+		SdfText::Vertex v10(glm::vec2(max.x, min.y), glm::vec2(glyph->tex_max.x, glyph->tex_min.y));
+		SdfText::Vertex v11(glm::vec2(max.x, max.y), glm::vec2(glyph->tex_max.x, glyph->tex_max.y));
+		SdfText::Vertex v01(glm::vec2(min.x, max.y), glm::vec2(glyph->tex_min.x, glyph->tex_max.y));
+		attribs.insert(attribs.end(), {v00, v10, v11, v00, v11, v01});
+	}
+	//(pages reused just now held none of this text's glyphs -- those pages were marked as used by this layout -- so the quads are good)
+	atlas_generation = shaper->atlas_generation;
+	quads.set(shaper->texture, attribs, run.width * scale.x);
+}
+
+void ShapedText::draw(glm::mat4 const &world_to_clip, glm::vec4 const &color, uint32_t first_count) {
+	if (shaper && atlas_generation != shaper->atlas_generation) layout();
+	quads.draw(world_to_clip, color, first_count);
+}
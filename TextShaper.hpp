@@ -0,0 +1,124 @@
+#pragma once
+
+/*
+ * Runtime text shaping: a TextShaper is one font (a .ttf/.otf file) that
+ * shapes UTF-8 strings with HarfBuzz and renders the glyphs they need -- as
+ * signed distance fields, like fontmap --sdf does offline -- into an atlas as
+ * they are first used. So any text the font covers (not just ASCII) can be
+ * drawn without re-running the asset pipeline.
+ *
+ * - Shaped runs are cached by (size, text), so shaping a line again (e.g. a
+ *   repeated dialog line) costs one hash lookup.
+ * - The atlas is split into pages; when every page is full, the page used
+ *   least recently is cleared and reused.
+ *
+ * Load< TextShaper > font(LoadTagDefault, LoadInfo("data/font.ttf"), [](){
+ *     return std::unique_ptr< TextShaper >(new TextShaper(data_path("data/font.ttf")));
+ * }, [](std::unique_ptr< TextShaper > &font) -> TextShaper const * {
+ *     font->upload();
+ *     return font.release();
+ * });
+ * ...
+ * ShapedText text;
+ * text.set(*font, "Déjà vu", 24.0f, origin, em);
+ * text.draw(world_to_clip, color);
+ *
+ * (Shaping and the atlas are caches, so they are updated through a const
+ *  TextShaper; only use one from the thread with the OpenGL context.)
+ */
+
+#include "GL.hpp"
+#include "AssetPack.hpp"
+#include "SdfFont.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TextShaper {
+	//glyphs are rendered at this many pixels per em, with distances reaching 0 / 255 at Spread pixels:
+	static constexpr uint32_t RasterSize = 40;
+	static constexpr uint32_t Spread = 6;
+	//atlas pages are PageSize x PageSize texels, stacked vertically in one GL_R8 texture:
+	static constexpr uint32_t PageSize = 512;
+	static constexpr uint32_t Pages = 4;
+	//once this many runs are cached, the cache starts over:
+	static constexpr size_t MaxRuns = 512;
+
+	//open a font file; throws on error (safe to call from any thread):
+	explicit TextShaper(std::string const &filename);
+	~TextShaper();
+	TextShaper(TextShaper const &) = delete;
+	TextShaper &operator=(TextShaper const &) = delete;
+
+	//(GL thread) make the (empty) atlas texture:
+	void upload();
+
+	//font-wide metrics, in ems:
+	float ascender = 0.0f, descender = 0.0f, line_height = 0.0f;
+
+	//---- shaping ----
+	struct RunGlyph {
+		uint32_t index = 0; //glyph index in the font
+		uint32_t cluster = 0; //byte offset of the text it came from
+		glm::vec2 pen = glm::vec2(0.0f); //where the glyph's origin goes, in pixels from the start of the run
+	};
+	struct Run {
+		std::vector< RunGlyph > glyphs;
+		float width = 0.0f; //total advance, in pixels
+	};
+	//shape 'text' (UTF-8) at 'size' pixels per em:
+	// (the reference is valid until the next call to shape())
+	Run const &shape(std::string const &text, float size) const;
+
+	//---- atlas ----
+	struct AtlasGlyph {
+		glm::vec2 min = glm::vec2(0.0f), max = glm::vec2(0.0f); //box relative to the glyph origin, in pixels at RasterSize (empty for blank glyphs)
+		glm::vec2 tex_min = glm::vec2(0.0f), tex_max = glm::vec2(0.0f); //box in the atlas, in texture coordinates
+	};
+	//start laying out a new piece of text; pages holding glyphs it uses won't be reused until the next one:
+	void begin_layout() const;
+	//find (rendering it first, if needed) glyph 'index' in the atlas;
+	// returns nullptr if every page is in use by the current layout:
+	AtlasGlyph const *atlas_glyph(uint32_t index) const;
+
+	GLuint texture = 0; //GL_TEXTURE_2D, GL_R8, linear filtering
+	//bumped every time a page is reused (so text laid out earlier may need to be laid out again):
+	mutable uint32_t atlas_generation = 0;
+
+	//---- stats ----
+	mutable uint64_t run_hits = 0, run_misses = 0;
+	mutable uint64_t glyphs_rendered = 0, pages_reused = 0;
+
+	//---- internals ----
+	struct Internals;
+	std::unique_ptr< Internals > internals;
+};
+
+//A line of shaped text, laid out in a vertex buffer:
+struct ShapedText {
+	//lay out 'text' (UTF-8) shaped at 'size' pixels per em, with the pen starting at 'origin' (on the baseline);
+	// 'em' is the size of an em in the units of 'origin' (as in SdfText::set):
+	void set(TextShaper const &shaper, std::string const &text, float size, glm::vec2 const &origin, glm::vec2 const &em);
+
+	//draw the first 'first_count' glyphs (all by default) in a single draw call:
+	// (lays the text out again first if the atlas pages it used have been reused since)
+	void draw(glm::mat4 const &world_to_clip, glm::vec4 const &color, uint32_t first_count = -1U);
+
+	uint32_t count() const { return quads.count; } //glyphs (not bytes) in the text
+	float width() const { return quads.width; } //total advance, in the units of 'origin'
+
+	//---- internals ----
+	void layout();
+	SdfText quads;
+	TextShaper const *shaper = nullptr;
+	std::string text;
+	float size = 0.0f;
+	glm::vec2 origin = glm::vec2(0.0f);
+	glm::vec2 em = glm::vec2(0.0f);
+	uint32_t atlas_generation = 0;
+};
@@ -0,0 +1,72 @@
+#include "WideLineProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+//only DrawLines uses this, so it is compiled the first time a wide line is drawn:
+Load< WideLineProgram > wide_line_program(LoadTagEarly, LoadInfo("WideLineProgram", {}, LoadLazy), nullptr, new_T< WideLineProgram >);
+
+WideLineProgram::WideLineProgram() {
+	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"uniform vec2 VIEWPORT_SIZE;\n"
+		"in vec2 Corner;\n"
+		"in vec3 A;\n"
+		"in vec3 B;\n"
+		"in vec4 Color;\n"
+		"in float Width;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	vec4 a = OBJECT_TO_CLIP * vec4(A, 1.0);\n"
+		"	vec4 b = OBJECT_TO_CLIP * vec4(B, 1.0);\n"
+		//the rectangle is built after the perspective divide, so first cut off any part of the segment behind the camera:
+		"	const float Near = 1e-4;\n"
+		"	if (a.w < Near && b.w < Near) {\n"
+		"		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n" //(entirely behind; outside the clip volume, so nothing is drawn)
+		"		color = Color;\n"
+		"		return;\n"
+		"	}\n"
+		"	if (a.w < Near) a = mix(a, b, (Near - a.w) / (b.w - a.w));\n"
+		"	if (b.w < Near) b = mix(b, a, (Near - b.w) / (a.w - b.w));\n"
+		//direction of the segment on screen, in pixels:
+		"	vec2 half_size = 0.5 * VIEWPORT_SIZE;\n"
+		"	vec2 along = b.xy / b.w * half_size - a.xy / a.w * half_size;\n"
+		"	float len = length(along);\n"
+		"	vec2 dir = (len > 1e-6 ? along / len : vec2(1.0, 0.0));\n"
+		//push corners out sideways -- and past the ends, so segments that share an endpoint meet without a notch:
+		"	vec2 offset = 0.5 * Width * (Corner.y * vec2(-dir.y, dir.x) + (2.0 * Corner.x - 1.0) * dir);\n"
+		"	vec4 at = mix(a, b, Corner.x);\n"
+		"	gl_Position = at + vec4(offset / half_size * at.w, 0.0, 0.0);\n"
+		"	color = Color;\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"in vec4 color;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragColor = color;\n"
+		"}\n"
+	);
+
+	//look up the locations of vertex attributes:
+	Corner_vec2 = glGetAttribLocation(program, "Corner");
+	A_vec3 = glGetAttribLocation(program, "A");
+	B_vec3 = glGetAttribLocation(program, "B");
+	Color_vec4 = glGetAttribLocation(program, "Color");
+	Width_float = glGetAttribLocation(program, "Width");
+
+	//look up the locations of uniforms:
+	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+	VIEWPORT_SIZE_vec2 = glGetUniformLocation(program, "VIEWPORT_SIZE");
+
+	GL_ERRORS();
+}
+
+WideLineProgram::~WideLineProgram() {
+	glDeleteProgram(program);
+	program = 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Load.hpp"
+
+//Shader program that draws line segments of any width in pixels (see DrawLines::draw_lines):
+// each instance is a segment; its four vertices are the corners of the screen-space rectangle around it.
+struct WideLineProgram {
+	WideLineProgram();
+	~WideLineProgram();
+
+	GLuint program = 0;
+	//Attribute (per-vertex variable) locations:
+	GLuint Corner_vec2 = -1U; //(x: 0 at A, 1 at B; y: -1 or 1 for which side of the segment)
+	//Attribute (per-instance variable) locations:
+	GLuint A_vec3 = -1U;
+	GLuint B_vec3 = -1U;
+	GLuint Color_vec4 = -1U;
+	GLuint Width_float = -1U; //(in pixels)
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+	GLuint VIEWPORT_SIZE_vec2 = -1U; //(in pixels)
+	//Textures:
+	// none
+};
+
+extern Load< WideLineProgram > wide_line_program;
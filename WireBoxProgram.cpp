@@ -0,0 +1,47 @@
+#include "WireBoxProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+//only DrawLines uses this, so it is compiled the first time a box is drawn:
+Load< WireBoxProgram > wire_box_program(LoadTagEarly, LoadInfo("WireBoxProgram", {}, LoadLazy), nullptr, new_T< WireBoxProgram >);
+
+WireBoxProgram::WireBoxProgram() {
+	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"in vec3 Position;\n"
+		"in mat4x3 Matrix;\n"
+		"in vec4 Color;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	gl_Position = OBJECT_TO_CLIP * vec4(Matrix * vec4(Position, 1.0), 1.0);\n"
+		"	color = Color;\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"in vec4 color;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragColor = color;\n"
+		"}\n"
+	);
+
+	//look up the locations of vertex attributes:
+	Position_vec3 = glGetAttribLocation(program, "Position");
+	Matrix_mat4x3 = glGetAttribLocation(program, "Matrix");
+	Color_vec4 = glGetAttribLocation(program, "Color");
+
+	//look up the locations of uniforms:
+	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+
+	GL_ERRORS();
+}
+
+WireBoxProgram::~WireBoxProgram() {
+	glDeleteProgram(program);
+	program = 0;
+}
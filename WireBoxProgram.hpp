@@ -0,0 +1,24 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Load.hpp"
+
+//Shader program that draws instances of a wireframe box (see DrawLines::draw_boxes):
+// each vertex is a corner of the [-1,1]^3 cube; each instance transforms the cube into place.
+struct WireBoxProgram {
+	WireBoxProgram();
+	~WireBoxProgram();
+
+	GLuint program = 0;
+	//Attribute (per-vertex variable) locations:
+	GLuint Position_vec3 = -1U;
+	//Attribute (per-instance variable) locations:
+	GLuint Matrix_mat4x3 = -1U; //(takes four locations, one per column: Matrix_mat4x3 .. Matrix_mat4x3 + 3)
+	GLuint Color_vec4 = -1U;
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+	//Textures:
+	// none
+};
+
+extern Load< WireBoxProgram > wire_box_program;
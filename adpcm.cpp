@@ -0,0 +1,162 @@
+#include "adpcm.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+//the standard IMA-ADPCM tables:
+static constexpr int32_t step_table[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static constexpr int32_t index_table[8] = {
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+namespace {
+	struct State {
+		int32_t predictor = 0;
+		int32_t index = 0;
+	};
+
+	//how much a code moves the predictor at a given step index (before clamping):
+	constexpr int32_t code_delta(int32_t index, uint32_t code) {
+		int32_t step = step_table[index];
+		int32_t delta = step >> 3;
+		if (code & 4) delta += step;
+		if (code & 2) delta += step >> 1;
+		if (code & 1) delta += step >> 2;
+		return (code & 8) ? -delta : delta;
+	}
+
+	constexpr int32_t next_index(int32_t index, uint32_t code) {
+		return std::max(0, std::min(88, index + index_table[code & 7]));
+	}
+
+	//advance the state by one code (the same for the encoder and the decoder, so they stay in sync):
+	constexpr void advance(State &state, uint32_t code) {
+		state.predictor = std::max(-32768, std::min(32767, state.predictor + code_delta(state.index, code)));
+		state.index = next_index(state.index, code);
+	}
+
+	//the same thing, tabulated (at compile time) for every (index, code) pair, so decoding a sample is one lookup:
+	// each entry is (change in predictor) * 256 + (next index); the predictor is clamped once the change is added,
+	// since clamping the change alone wouldn't match advance() near full scale
+	struct Steps {
+		int32_t entries[89 * 16];
+		constexpr Steps() : entries{} {
+			for (int32_t index = 0; index < 89; ++index) {
+				for (uint32_t code = 0; code < 16; ++code) {
+					entries[index * 16 + code] = code_delta(index, code) * 256 + next_index(index, code);
+				}
+			}
+		}
+	};
+	constexpr Steps steps;
+
+	//decode one code (matches advance()):
+	inline int32_t decode(int32_t &predictor, int32_t &index, uint32_t code) {
+		int32_t entry = steps.entries[index * 16 + code];
+		predictor = std::max(-32768, std::min(32767, predictor + (entry >> 8)));
+		index = entry & 0xff;
+		return predictor;
+	}
+}
+
+void adpcm_encode(float const *samples, uint32_t count, std::vector< uint8_t > *blocks_) {
+	assert(blocks_);
+	auto &blocks = *blocks_;
+	uint32_t block_count = (count + AdpcmBlockSamples - 1) / AdpcmBlockSamples;
+	blocks.assign(size_t(block_count) * AdpcmBlockBytes, 0);
+
+	State state;
+	for (uint32_t b = 0; b < block_count; ++b) {
+		uint8_t *block = blocks.data() + size_t(b) * AdpcmBlockBytes;
+		block[0] = uint8_t(uint16_t(state.predictor) & 0xff);
+		block[1] = uint8_t(uint16_t(state.predictor) >> 8);
+		block[2] = uint8_t(state.index);
+		uint8_t *codes = block + 4;
+		#ifndef NDEBUG
+		int16_t expected[AdpcmBlockSamples]; //(what the decoder should give back, for the check below)
+		#endif
+
+		for (uint32_t k = 0; k < AdpcmBlockSamples; ++k) {
+			uint32_t i = b * AdpcmBlockSamples + k;
+			int32_t sample = 0;
+			if (i < count) {
+				sample = int32_t(std::lround(std::max(-1.0f, std::min(1.0f, samples[i])) * 32767.0f));
+			}
+
+			//pick the code that gets closest to the sample:
+			int32_t diff = sample - state.predictor;
+			uint32_t code = 0;
+			if (diff < 0) {
+				code = 8;
+				diff = -diff;
+			}
+			int32_t step = step_table[state.index];
+			if (diff >= step) { code |= 4; diff -= step; }
+			step >>= 1;
+			if (diff >= step) { code |= 2; diff -= step; }
+			step >>= 1;
+			if (diff >= step) { code |= 1; }
+
+			advance(state, code);
+			codes[k / 2] |= uint8_t(code << ((k & 1) * 4));
+			#ifndef NDEBUG
+			expected[k] = int16_t(state.predictor);
+			#endif
+		}
+
+		#ifndef NDEBUG
+		//round trip: the decoder (with its tabulated steps) must land on exactly the encoder's predictions,
+		// including when they hit the clamp (full-scale content):
+		int16_t decoded[AdpcmBlockSamples];
+		adpcm_decode(blocks.data(), b * AdpcmBlockSamples, AdpcmBlockSamples, decoded);
+		assert(std::equal(decoded, decoded + AdpcmBlockSamples, expected) && "ADPCM decoder matches encoder");
+		#endif
+	}
+}
+
+void adpcm_decode(uint8_t const *blocks, uint32_t begin, uint32_t count, int16_t *out) {
+	assert(blocks);
+	assert(out || count == 0);
+	uint32_t b = begin / AdpcmBlockSamples;
+	uint32_t skip = begin % AdpcmBlockSamples; //samples to decode but not output
+	while (count > 0) {
+		uint8_t const *block = blocks + size_t(b) * AdpcmBlockBytes;
+		int32_t predictor = int16_t(uint16_t(block[0]) | (uint16_t(block[1]) << 8));
+		int32_t index = std::min< int32_t >(88, block[2]);
+		uint8_t const *codes = block + 4;
+
+		uint32_t end = std::min(AdpcmBlockSamples, skip + count);
+		uint32_t k = 0;
+		//samples before 'begin' only update the state:
+		for (; k < skip; ++k) {
+			decode(predictor, index, (codes[k / 2] >> ((k & 1) * 4)) & 0xf);
+		}
+		//(an odd start leaves a high nibble to do by itself)
+		if ((k & 1) && k < end) {
+			*(out++) = int16_t(decode(predictor, index, codes[k / 2] >> 4));
+			++k;
+		}
+		for (; k + 2 <= end; k += 2) {
+			uint32_t byte = codes[k / 2];
+			*(out++) = int16_t(decode(predictor, index, byte & 0xf));
+			*(out++) = int16_t(decode(predictor, index, byte >> 4));
+		}
+		if (k < end) {
+			*(out++) = int16_t(decode(predictor, index, codes[k / 2] & 0xf));
+		}
+		count -= end - skip;
+		skip = 0;
+		b += 1;
+	}
+}
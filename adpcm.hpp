@@ -0,0 +1,25 @@
+#pragma once
+
+/*
+ * IMA-ADPCM: about 4 bits per sample (vs. 32 for float).
+ *
+ * Samples are encoded in fixed-size blocks, each starting with the decoder
+ * state, so any stretch of samples can be decoded without starting from the
+ * beginning (at most AdpcmBlockSamples - 1 extra samples are decoded and
+ * thrown away).
+ *
+ * Block layout: int16 predictor (little-endian), uint8 step index, uint8 padding,
+ *  then AdpcmBlockSamples 4-bit codes (low nibble first).
+ */
+
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t AdpcmBlockSamples = 256;
+constexpr uint32_t AdpcmBlockBytes = 4 + AdpcmBlockSamples / 2;
+
+//encode 'count' samples (in [-1,1]; clamped) into *blocks (replacing its contents):
+void adpcm_encode(float const *samples, uint32_t count, std::vector< uint8_t > *blocks);
+
+//decode samples [begin, begin + count) as 16-bit integers:
+void adpcm_decode(uint8_t const *blocks, uint32_t begin, uint32_t count, int16_t *out);
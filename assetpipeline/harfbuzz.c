@@ -7,17 +7,63 @@
 #include <hb-ft.h>
 #include <cairo.h>
 #include <cairo-ft.h>
+#include <string.h>
+
+#include "sdf.h"
 
 #define FONT_SIZE 100
 #define SPACING (FONT_SIZE * 64.0)
 #define ROW_SIZE 32
 
-// Pass only the font file as an argument
+// Shape every pair of 'chars' and record how much the font's kerning (GPOS or
+// kern table) moves the second character; adjustments are in font units.
+// Returns a malloc'd array of *count pairs.
+static SdfKerning *find_kerning(FT_Face face, const char *chars, size_t *count)
+{
+    hb_face_t *hb_face = hb_ft_face_create_referenced(face);
+    hb_font_t *font = hb_font_create(hb_face);
+    hb_font_set_scale(font, face->units_per_EM, face->units_per_EM); // (unhinted font units)
+    hb_buffer_t *buffer = hb_buffer_create();
+
+    size_t length = strlen(chars);
+    SdfKerning *pairs = malloc(length * length * sizeof(SdfKerning));
+    *count = 0;
+    for (size_t a = 0; a < length; a++)
+    {
+        for (size_t b = 0; b < length; b++)
+        {
+            char pair[2] = {chars[a], chars[b]};
+            hb_buffer_clear_contents(buffer);
+            hb_buffer_add_utf8(buffer, pair, 2, 0, 2);
+            hb_buffer_guess_segment_properties(buffer);
+            hb_shape(font, buffer, NULL, 0);
+            if (hb_buffer_get_length(buffer) != 2)
+                continue; // (a ligature; SdfText draws one glyph per character, so leave it be)
+            hb_glyph_info_t *info = hb_buffer_get_glyph_infos(buffer, NULL);
+            hb_glyph_position_t *pos = hb_buffer_get_glyph_positions(buffer, NULL);
+            hb_position_t adjust = pos[0].x_advance - hb_font_get_glyph_h_advance(font, info[0].codepoint);
+            if (adjust == 0)
+                continue;
+            pairs[*count].left = (unsigned char)chars[a];
+            pairs[*count].right = (unsigned char)chars[b];
+            pairs[*count].adjust = adjust;
+            *count += 1;
+        }
+    }
+
+    hb_buffer_destroy(buffer);
+    hb_font_destroy(font);
+    hb_face_destroy(hb_face);
+    return pairs;
+}
+
+// Pass the font file as an argument; writes font.png
+// (or, with --sdf, a signed distance field atlas + metrics file for SdfFont)
 int main(int argc, char **argv)
 {
-    if (argc < 2)
+    if (!(argc == 2 || (argc == 4 && strcmp(argv[2], "--sdf") == 0)))
     {
-        fprintf(stderr, "usage: fontmap font-file.ttf\n");
+        fprintf(stderr, "usage: fontmap font-file.ttf [--sdf font.sdf]\n");
         exit(1);
     }
 
@@ -35,6 +81,18 @@ int main(int argc, char **argv)
         abort();
     if (FT_New_Face(library, fontFile, 0, &face))
         abort();
+
+    if (argc == 4)
+    {
+        size_t kerning_count;
+        SdfKerning *kerning = find_kerning(face, ascii, &kerning_count);
+        int failed = write_sdf_font(library, face, ascii, kerning, kerning_count, argv[3]);
+        free(kerning);
+        FT_Done_Face(face);
+        FT_Done_FreeType(library);
+        return failed;
+    }
+
     if (FT_Set_Char_Size(face, FONT_SIZE * 64, FONT_SIZE * 64, 0, 0))
         abort();
 
@@ -0,0 +1,281 @@
+// Signed distance field font atlas for the game's text renderer (see SdfFont.hpp).
+//
+// Each glyph is rendered with FreeType's SDF renderer at SDF_SIZE pixels per em.
+// Texel values are distances to the outline: 128 is on the edge, larger is
+// inside, and SDF_SPREAD pixels away is 0 or 255. Because distances
+// interpolate well, the one small atlas can be drawn sharply at any size.
+//
+// Output file layout (all little-endian; keep in sync with SdfFont.hpp):
+//   header:  char magic[4] = "sdf0", uint32 version, uint32 glyph_count,
+//            uint16 atlas_width, uint16 atlas_height,
+//            float em_size, float spread, float ascender, float descender, float line_height,
+//            uint32 kerning_count
+//   glyphs:  glyph_count x { uint32 codepoint, float advance,
+//            int16 left, int16 bottom (box corner relative to the pen position, y up),
+//            uint16 x, uint16 y, uint16 width, uint16 height (box in the atlas, rows counted from the bottom) }
+//   kerning: kerning_count x { uint32 left, uint32 right, float adjust (added to left's advance when right follows) },
+//            sorted by (left, right)
+//   atlas:   atlas_width * atlas_height bytes, bottom row first
+// (lengths are in pixels at em_size)
+
+#include "sdf.h"
+
+#include FT_MODULE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SDF_SIZE 40
+#define SDF_SPREAD 6
+#define SDF_VERSION 2
+#define ATLAS_WIDTH 512
+
+typedef struct {
+    uint32_t codepoint;
+    float advance;
+    int16_t left, bottom;
+    uint16_t x, y, width, height;
+    unsigned char *texels; // width * height, bottom row first
+} Glyph;
+
+static void write_u16(FILE *out, uint16_t v) { unsigned char b[2] = {v & 0xff, v >> 8}; fwrite(b, 1, 2, out); }
+static void write_u32(FILE *out, uint32_t v) { unsigned char b[4] = {v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, v >> 24}; fwrite(b, 1, 4, out); }
+static void write_f32(FILE *out, float f) { uint32_t v; memcpy(&v, &f, 4); write_u32(out, v); }
+
+// A skyline: the top edge of everything packed so far, as runs of equal height
+// from left to right (so the atlas stays as short as it can be).
+typedef struct {
+    unsigned x, y, width;
+} SkylineNode;
+
+// Where the lower left corner of a width x height box would go if placed at
+// node 'i' (returns 0 if it runs off the right edge):
+static int skyline_fit(const SkylineNode *nodes, size_t i, unsigned width, unsigned *y)
+{
+    if (nodes[i].x + width > ATLAS_WIDTH + 1) // (+1: the padding after the last column can hang off the edge)
+        return 0;
+    unsigned top = 0;
+    for (unsigned left = width; left > 0; i++)
+    {
+        if (nodes[i].y > top)
+            top = nodes[i].y;
+        left = (nodes[i].width >= left ? 0 : left - nodes[i].width);
+    }
+    *y = top;
+    return 1;
+}
+
+// Place a width x height box as low (then as far left) as it fits; returns 0 if it is wider than the atlas:
+static int skyline_place(SkylineNode *nodes, size_t *count, unsigned width, unsigned height, unsigned *x, unsigned *y)
+{
+    size_t best = *count;
+    unsigned best_y = 0;
+    for (size_t i = 0; i < *count; i++)
+    {
+        unsigned at;
+        if (skyline_fit(nodes, i, width, &at) && (best == *count || at < best_y))
+        {
+            best = i;
+            best_y = at;
+        }
+    }
+    if (best == *count)
+        return 0;
+    *x = nodes[best].x;
+    *y = best_y;
+
+    // The box's top becomes a new node, covering up the nodes beneath it:
+    memmove(nodes + best + 1, nodes + best, (*count - best) * sizeof(SkylineNode));
+    *count += 1;
+    nodes[best].x = *x;
+    nodes[best].y = best_y + height;
+    nodes[best].width = width;
+    size_t next = best + 1;
+    while (next < *count && nodes[next].x < *x + width)
+    {
+        unsigned covered = *x + width - nodes[next].x;
+        if (covered < nodes[next].width)
+        {
+            nodes[next].x += covered;
+            nodes[next].width -= covered;
+            break;
+        }
+        memmove(nodes + next, nodes + next + 1, (*count - next - 1) * sizeof(SkylineNode));
+        *count -= 1;
+    }
+    // ...and merges with neighbours of the same height:
+    for (size_t i = 0; i + 1 < *count;)
+    {
+        if (nodes[i].y == nodes[i + 1].y)
+        {
+            nodes[i].width += nodes[i + 1].width;
+            memmove(nodes + i + 1, nodes + i + 2, (*count - i - 2) * sizeof(SkylineNode));
+            *count -= 1;
+        }
+        else
+            i++;
+    }
+    return 1;
+}
+
+static int by_pair(const void *a, const void *b)
+{
+    const SdfKerning *ka = a, *kb = b;
+    if (ka->left != kb->left) return ka->left < kb->left ? -1 : 1;
+    if (ka->right != kb->right) return ka->right < kb->right ? -1 : 1;
+    return 0;
+}
+
+// tallest first, so that the skyline stays flat:
+static int by_height(const void *a, const void *b)
+{
+    const Glyph *ga = *(const Glyph * const *)a;
+    const Glyph *gb = *(const Glyph * const *)b;
+    if (ga->height != gb->height) return (int)gb->height - (int)ga->height;
+    return (int)ga->codepoint - (int)gb->codepoint;
+}
+
+int write_sdf_font(FT_Library library, FT_Face face, const char *chars, const SdfKerning *kerning, size_t kerning_count, const char *out_file)
+{
+    FT_Int spread = SDF_SPREAD;
+    if (FT_Property_Set(library, "sdf", "spread", &spread))
+    {
+        fprintf(stderr, "FreeType has no SDF renderer (needs 2.11 or newer)\n");
+        return 1;
+    }
+    if (FT_Set_Pixel_Sizes(face, 0, SDF_SIZE))
+        return 1;
+
+    size_t count = strlen(chars);
+    Glyph *glyphs = calloc(count, sizeof(Glyph));
+
+    // Render:
+    for (size_t i = 0; i < count; i++)
+    {
+        Glyph *g = &glyphs[i];
+        g->codepoint = (unsigned char)chars[i];
+        if (FT_Load_Char(face, g->codepoint, FT_LOAD_DEFAULT))
+        {
+            fprintf(stderr, "Failed to load '%c'\n", chars[i]);
+            return 1;
+        }
+        FT_GlyphSlot slot = face->glyph;
+        g->advance = slot->linearHoriAdvance / 65536.0f; // (unhinted, so it scales)
+
+        if (slot->outline.n_points == 0)
+            continue; // (e.g. space -- nothing to draw)
+
+        if (FT_Render_Glyph(slot, FT_RENDER_MODE_SDF))
+        {
+            fprintf(stderr, "Failed to render '%c'\n", chars[i]);
+            return 1;
+        }
+        FT_Bitmap *bitmap = &slot->bitmap;
+        g->width = bitmap->width;
+        g->height = bitmap->rows;
+        g->left = slot->bitmap_left;
+        g->bottom = slot->bitmap_top - (int)bitmap->rows;
+        g->texels = malloc(g->width * g->height);
+        for (unsigned y = 0; y < g->height; y++)
+        {
+            // (FreeType rows are top first)
+            memcpy(g->texels + y * g->width, bitmap->buffer + (g->height - 1 - y) * bitmap->pitch, g->width);
+        }
+    }
+
+    // Pack on a skyline, leaving a texel between glyphs so sampling never bleeds:
+    Glyph **order = malloc(count * sizeof(Glyph *));
+    for (size_t i = 0; i < count; i++)
+        order[i] = &glyphs[i];
+    qsort(order, count, sizeof(Glyph *), by_height);
+
+    SkylineNode *skyline = malloc((count + 1) * sizeof(SkylineNode));
+    size_t skyline_count = 1;
+    skyline[0].x = 0;
+    skyline[0].y = 0;
+    skyline[0].width = ATLAS_WIDTH + 1;
+    unsigned used_height = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        Glyph *g = order[i];
+        if (g->width == 0)
+            continue;
+        unsigned x, y;
+        if (!skyline_place(skyline, &skyline_count, g->width + 1, g->height + 1, &x, &y))
+        {
+            fprintf(stderr, "Glyph '%c' is wider than the atlas\n", (char)g->codepoint);
+            return 1;
+        }
+        g->x = x;
+        g->y = y;
+        if (y + g->height > used_height)
+            used_height = y + g->height;
+    }
+    unsigned atlas_height = (used_height + 3) / 4 * 4;
+    free(skyline);
+    free(order);
+
+    unsigned char *atlas = calloc(ATLAS_WIDTH, atlas_height); // (0 == far outside)
+    for (size_t i = 0; i < count; i++)
+    {
+        Glyph *g = &glyphs[i];
+        for (unsigned y = 0; y < g->height; y++)
+            memcpy(atlas + (g->y + y) * ATLAS_WIDTH + g->x, g->texels + y * g->width, g->width);
+    }
+
+    // Write:
+    FILE *out = fopen(out_file, "wb");
+    if (!out)
+    {
+        fprintf(stderr, "Failed to open '%s' for writing\n", out_file);
+        return 1;
+    }
+    fwrite("sdf0", 1, 4, out);
+    write_u32(out, SDF_VERSION);
+    write_u32(out, (uint32_t)count);
+    write_u16(out, ATLAS_WIDTH);
+    write_u16(out, (uint16_t)atlas_height);
+    write_f32(out, SDF_SIZE);
+    write_f32(out, SDF_SPREAD);
+    write_f32(out, face->size->metrics.ascender / 64.0f);
+    write_f32(out, face->size->metrics.descender / 64.0f);
+    write_f32(out, face->size->metrics.height / 64.0f);
+    write_u32(out, (uint32_t)kerning_count);
+    for (size_t i = 0; i < count; i++)
+    {
+        Glyph *g = &glyphs[i];
+        write_u32(out, g->codepoint);
+        write_f32(out, g->advance);
+        write_u16(out, (uint16_t)g->left);
+        write_u16(out, (uint16_t)g->bottom);
+        write_u16(out, g->x);
+        write_u16(out, g->y);
+        write_u16(out, g->width);
+        write_u16(out, g->height);
+    }
+    // (font units to pixels at SDF_SIZE)
+    SdfKerning *pairs = malloc((kerning_count + 1) * sizeof(SdfKerning));
+    memcpy(pairs, kerning, kerning_count * sizeof(SdfKerning));
+    qsort(pairs, kerning_count, sizeof(SdfKerning), by_pair);
+    for (size_t i = 0; i < kerning_count; i++)
+    {
+        write_u32(out, pairs[i].left);
+        write_u32(out, pairs[i].right);
+        write_f32(out, pairs[i].adjust * (float)SDF_SIZE / face->units_per_EM);
+    }
+    free(pairs);
+    fwrite(atlas, 1, ATLAS_WIDTH * atlas_height, out);
+    int failed = ferror(out);
+    fclose(out);
+
+    printf("Wrote %u glyphs and %u kerning pairs to %s (%ux%u atlas)\n", (unsigned)count, (unsigned)kerning_count, out_file, ATLAS_WIDTH, atlas_height);
+
+    for (size_t i = 0; i < count; i++)
+        free(glyphs[i].texels);
+    free(glyphs);
+    free(atlas);
+
+    return failed;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Kerning between two characters, in font units (see find_kerning in harfbuzz.c):
+typedef struct {
+    uint32_t left, right;
+    int32_t adjust;
+} SdfKerning;
+
+// Render 'chars' (ASCII) from 'face' as signed distance fields, pack them
+// into one single-channel atlas, and write atlas + metrics (+ the kerning
+// pairs, if any) to 'out_file'. Returns 0 on success.
+int write_sdf_font(FT_Library library, FT_Face face, const char *chars, const SdfKerning *kerning, size_t kerning_count, const char *out_file);
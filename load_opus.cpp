@@ -1,7 +1,9 @@
 #include "load_opus.hpp"
+#include "AssetPack.hpp"
 
 #include <opusfile.h>
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
 #include <cmath>
@@ -15,10 +17,13 @@ void load_opus(std::string const &filename, std::vector< float > *data_) {
 
 	std::cout << "loading '" << filename << "'..."; std::cout.flush();
 
+	//file contents (decoded straight out of the asset pack, if there is one):
+	AssetView view = asset_view(filename);
+
 	//will hold opusfile * int a std::unique_ptr so that it will automatically be deleted:
 	int err = 0;
 	std::unique_ptr< OggOpusFile, decltype(&op_free) > op(
-		op_open_file(filename.c_str(), &err), //pointer to hold
+		op_open_memory(reinterpret_cast< unsigned char const * >(view.data), view.size, &err), //pointer to hold
 		op_free //deletion function
 	);
 	if (err != 0) {
@@ -52,3 +57,43 @@ void load_opus(std::string const &filename, std::vector< float > *data_) {
 
 	std::cout << " done." << std::endl;
 }
+
+//------------------------
+
+OpusReader::OpusReader(char const *data, size_t size, std::string const &filename_) : filename(filename_) {
+	int err = 0;
+	op = op_open_memory(reinterpret_cast< unsigned char const * >(data), size, &err);
+	if (err != 0 || !op) {
+		throw std::runtime_error("opusfile error " + std::to_string(err) + " opening \"" + filename + "\".");
+	}
+	pcm.resize(2*48000/10, 0.0f); //up to 100ms per read
+}
+
+OpusReader::~OpusReader() {
+	if (op) op_free(op);
+}
+
+uint32_t OpusReader::read(float *out, uint32_t count) {
+	assert(out);
+	uint32_t total = 0;
+	while (total < count) {
+		int ret = op_read_float_stereo(op, pcm.data(), int(std::min< size_t >(pcm.size(), 2 * size_t(count - total))));
+		if (ret < 0) {
+			throw std::runtime_error("opusfile read error " + std::to_string(ret) + " reading \"" + filename + "\".");
+		}
+		if (ret == 0) break;
+		//positive return values are the number of samples read per channel; downmix to mono by averaging:
+		for (uint32_t i = 0; i < uint32_t(ret); ++i) {
+			out[total + i] = (pcm[2*i] + pcm[2*i+1]) * 0.5f;
+		}
+		total += uint32_t(ret);
+	}
+	return total;
+}
+
+void OpusReader::rewind() {
+	int err = op_pcm_seek(op, 0);
+	if (err != 0) {
+		throw std::runtime_error("opusfile error " + std::to_string(err) + " seeking in \"" + filename + "\".");
+	}
+}
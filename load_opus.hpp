@@ -1,7 +1,29 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
+struct OggOpusFile;
+
 //Load an opus file as 48kHz floating-point mono; throws on error:
 void load_opus(std::string const &filename, std::vector< float > *data);
+
+//Decode an opus file as 48kHz floating-point mono a piece at a time (for streaming playback):
+// (the file's bytes are not copied, so must stay around as long as the reader does)
+struct OpusReader {
+	OpusReader(char const *data, size_t size, std::string const &filename); //throws on error
+	~OpusReader();
+	OpusReader(OpusReader const &) = delete;
+
+	//decode up to 'count' samples into 'out'; returns the number decoded (0 at the end of the file):
+	uint32_t read(float *out, uint32_t count); //throws on error
+
+	//go back to the start of the file:
+	void rewind(); //throws on error
+
+	std::string filename; //(for error messages)
+	OggOpusFile *op = nullptr;
+	std::vector< float > pcm; //stereo scratch space for decoding
+};
@@ -1,4 +1,5 @@
 #include "load_save_png.hpp"
+#include "AssetPack.hpp"
 
 #include <png.h>
 
@@ -6,24 +7,67 @@
 #include <fstream>
 #include <cassert>
 #include <vector>
+#include <functional>
+#include <cstring>
 
 #define LOG_ERROR( X ) std::cerr << X << std::endl
 
 using std::vector;
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin);
+bool load_png(std::istream &from, std::function< glm::u8vec4 *(glm::uvec2) > const &get_dest, OriginLocation origin);
 void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin);
 
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
 	assert(size);
 
-	std::ifstream file(filename.c_str(), std::ios::binary);
-	if (!file) {
-		throw std::runtime_error("Failed to open PNG image file '" + filename + "'.");
+	AssetStream file(filename);
+	load_png(file, filename, size, data, origin);
+}
+
+void load_png(std::istream &from, std::string const &name, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
+	assert(size);
+	assert(data);
+
+	*size = glm::uvec2(0);
+	data->clear();
+	if (!load_png(from, [&](glm::uvec2 image_size) {
+		*size = image_size;
+		data->resize(size_t(size->x) * size->y);
+		return data->data();
+	}, origin)) {
+		*size = glm::uvec2(0);
+		data->clear();
+		throw std::runtime_error("Failed to read PNG image from '" + name + "'.");
+	}
+}
+
+void load_png(std::istream &from, std::string const &name, glm::uvec2 size, glm::u8vec4 *dest, OriginLocation origin) {
+	assert(dest);
+
+	glm::uvec2 image_size = glm::uvec2(0);
+	if (!load_png(from, [&](glm::uvec2 size_) -> glm::u8vec4 * {
+		image_size = size_;
+		if (image_size != size) return nullptr;
+		return dest;
+	}, origin)) {
+		if (image_size != size) {
+			throw std::runtime_error("PNG image '" + name + "' is " + std::to_string(image_size.x) + "x" + std::to_string(image_size.y) + ", expected " + std::to_string(size.x) + "x" + std::to_string(size.y) + ".");
+		}
+		throw std::runtime_error("Failed to read PNG image from '" + name + "'.");
 	}
-	if (!load_png(file, &size->x, &size->y, data, origin)) {
-		throw std::runtime_error("Failed to read PNG image from '" + filename + "'.");
+}
+
+glm::uvec2 png_size(std::string const &name, char const *data, size_t size) {
+	//signature, then the IHDR chunk (which must come first): length, "IHDR", width, height, ...
+	static unsigned char const signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	unsigned char const *bytes = reinterpret_cast< unsigned char const * >(data);
+	if (size < 8 + 8 + 8 || std::memcmp(bytes, signature, 8) != 0 || std::memcmp(bytes + 12, "IHDR", 4) != 0) {
+		throw std::runtime_error("'" + name + "' doesn't look like a PNG image.");
 	}
+	auto be32 = [](unsigned char const *b) {
+		return (uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) | (uint32_t(b[2]) << 8) | uint32_t(b[3]);
+	};
+	return glm::uvec2(be32(bytes + 16), be32(bytes + 20));
 }
 
 void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin) {
@@ -57,13 +101,8 @@ static void user_flush_data(png_structp png_ptr) {
 }
 
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin) {
-	assert(data);
-	uint32_t local_width, local_height;
-	if (width == nullptr) width = &local_width;
-	if (height == nullptr) height = &local_height;
-	*width = *height = 0;
-	data->clear();
+//decodes into the (w*h texel) buffer returned by get_dest; stops early if that returns nullptr:
+bool load_png(std::istream &from, std::function< glm::u8vec4 *(glm::uvec2) > const &get_dest, OriginLocation origin) {
 	//..... load file ......
 	//Load a png file, as per the libpng docs:
 	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
@@ -85,7 +124,6 @@ bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vec
 		LOG_ERROR("  png interal error.");
 		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
 		if (row_pointers != NULL) delete[] row_pointers;
-		data->clear();
 		return false;
 	}
 	//not needed with custom read/write functions: png_init_io(png, NULL);
@@ -109,21 +147,24 @@ bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vec
 	//Make sure it's the format we think it is...
 	assert(rowbytes == w*sizeof(uint32_t));
 
-	data->resize(w*h);
+	glm::u8vec4 *data = get_dest(glm::uvec2(w, h));
+	if (!data) {
+		png_destroy_read_struct(&png, &info, NULL);
+		return false;
+	}
+	//rows are decoded straight to their final (possibly flipped) place:
 	row_pointers = new png_bytep[h];
 	for (unsigned int r = 0; r < h; ++r) {
 		if (origin == LowerLeftOrigin) {
-			row_pointers[h-1-r] = (png_bytep)(&(*data)[r*w]);
+			row_pointers[h-1-r] = (png_bytep)(&data[size_t(r)*w]);
 		} else {
-			row_pointers[r] = (png_bytep)(&(*data)[r*w]);
+			row_pointers[r] = (png_bytep)(&data[size_t(r)*w]);
 		}
 	}
 	png_read_image(png, row_pointers);
 	png_destroy_read_struct(&png, &info, NULL);
 	delete[] row_pointers;
 
-	*width = w;
-	*height = h;
 	return true;
 }
 
@@ -4,6 +4,7 @@
 
 #include <string>
 #include <vector>
+#include <iosfwd>
 #include <stdint.h>
 
 /*
@@ -17,4 +18,10 @@ enum OriginLocation {
 
 //NOTE: load_png will throw on error
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
+//(same, but reads from an already-open stream; 'name' is only used in error messages)
+void load_png(std::istream &from, std::string const &name, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
+//(same, but decodes into caller-supplied memory -- e.g., a mapped pixel buffer -- that holds exactly size.x * size.y texels)
+void load_png(std::istream &from, std::string const &name, glm::uvec2 size, glm::u8vec4 *dest, OriginLocation origin);
+//size of a PNG image, read from its header ('data' is the start of the file):
+glm::uvec2 png_size(std::string const &name, char const *data, size_t size);
 void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin);
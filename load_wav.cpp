@@ -1,14 +1,18 @@
 #include "load_wav.hpp"
+#include "AssetPack.hpp"
 
 #include <SDL.h>
 
 #include <iostream>
 #include <cassert>
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
 
 constexpr uint32_t AUDIO_RATE = 48000;
 
-void load_wav(std::string const &filename, std::vector< float > *data_) {
+void load_wav(std::string const &filename, std::vector< float > *data_, uint32_t *rate) {
 	assert(data_);
 	auto &data = *data_;
 
@@ -16,16 +20,22 @@ void load_wav(std::string const &filename, std::vector< float > *data_) {
 	Uint8 *audio_buf = nullptr;
 	Uint32 audio_len = 0;
 
-	SDL_AudioSpec *have = SDL_LoadWAV(filename.c_str(), &audio_spec, &audio_buf, &audio_len);
+	AssetView view = asset_view(filename);
+	SDL_AudioSpec *have = SDL_LoadWAV_RW(SDL_RWFromConstMem(view.data, int(view.size)), 1, &audio_spec, &audio_buf, &audio_len);
 	if (!have) {
 		throw std::runtime_error("Failed to load WAV file '" + filename + "'; SDL says \"" + std::string(SDL_GetError()) + "\"");
 	}
 
+	//lower-rate files can stay that way (they take less memory, and the mixer resamples them as they play):
+	int target_rate = AUDIO_RATE;
+	if (rate && have->freq > 0 && have->freq < int(AUDIO_RATE)) target_rate = have->freq;
+	if (rate) *rate = uint32_t(target_rate);
+
 	//based on the SDL_AudioCVT example in the docs: https://wiki.libsdl.org/SDL_AudioCVT
 	SDL_AudioCVT cvt;
-	SDL_BuildAudioCVT(&cvt, have->format, have->channels, have->freq, AUDIO_F32SYS, 1, AUDIO_RATE);
+	SDL_BuildAudioCVT(&cvt, have->format, have->channels, have->freq, AUDIO_F32SYS, 1, target_rate);
 	if (cvt.needed) {
-		std::cout << "WAV file '" + filename + "' didn't load as " + std::to_string(AUDIO_RATE) + " Hz, float32, mono; converting." << std::endl;
+		std::cout << "WAV file '" + filename + "' didn't load as " + std::to_string(target_rate) + " Hz, float32, mono; converting." << std::endl;
 		cvt.len = audio_len;
 		cvt.buf = (Uint8 *)SDL_malloc(cvt.len * cvt.len_mult);
 		SDL_memcpy(cvt.buf, audio_buf, audio_len);
@@ -48,3 +58,48 @@ void load_wav(std::string const &filename, std::vector< float > *data_) {
 	}
 	std::cout << "Range: " << min << ", " << max << std::endl;
 }
+
+void save_wav(std::string const &filename, float const *frames, size_t frame_count) {
+	assert(frames || frame_count == 0);
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open WAV file '" + filename + "' for writing.");
+	}
+
+	//(WAV is little-endian throughout)
+	auto write_u32 = [&file](uint32_t value) {
+		char bytes[4] = { char(value & 0xff), char((value >> 8) & 0xff), char((value >> 16) & 0xff), char((value >> 24) & 0xff) };
+		file.write(bytes, 4);
+	};
+	auto write_u16 = [&file](uint16_t value) {
+		char bytes[2] = { char(value & 0xff), char((value >> 8) & 0xff) };
+		file.write(bytes, 2);
+	};
+
+	uint32_t data_size = uint32_t(frame_count * 2 * sizeof(float));
+	file.write("RIFF", 4);
+	write_u32(4 + (8 + 16) + (8 + data_size));
+	file.write("WAVE", 4);
+
+	file.write("fmt ", 4);
+	write_u32(16);
+	write_u16(3); //IEEE float
+	write_u16(2); //channels
+	write_u32(AUDIO_RATE);
+	write_u32(AUDIO_RATE * 2 * sizeof(float)); //bytes per second
+	write_u16(2 * sizeof(float)); //bytes per frame
+	write_u16(32); //bits per sample
+
+	file.write("data", 4);
+	write_u32(data_size);
+	for (size_t i = 0; i < frame_count * 2; ++i) {
+		uint32_t bits;
+		std::memcpy(&bits, &frames[i], sizeof(bits));
+		write_u32(bits);
+	}
+
+	if (!file) {
+		throw std::runtime_error("Failed to write WAV file '" + filename + "'.");
+	}
+}
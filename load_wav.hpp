@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 //Load a WAV file as 48kHz floating-point mono; throws on error:
-void load_wav(std::string const &filename, std::vector< float > *data);
+// (if 'rate' is given, files recorded at less than 48kHz are left at their own rate, which is stored there)
+void load_wav(std::string const &filename, std::vector< float > *data, uint32_t *rate = nullptr);
+
+//Save 48kHz interleaved stereo floating-point audio as a WAV file; throws on error:
+void save_wav(std::string const &filename, float const *frames, size_t frame_count);
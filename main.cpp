@@ -7,6 +7,9 @@
 //For asset loading:
 #include "Load.hpp"
 
+//For submitting each frame's debug lines:
+#include "DrawLines.hpp"
+
 //For sound init:
 #include "Sound.hpp"
 
@@ -183,8 +186,12 @@ int main(int argc, char **argv) {
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
-		
+			//(first giving background loads a couple of milliseconds to upload whatever has finished decoding)
+			pump_load_functions();
+
 			Mode::current->draw(drawable_size);
+			//...and draw the debug lines it queued, all at once:
+			DrawLines::submit_frame();
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
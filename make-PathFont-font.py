@@ -372,6 +372,10 @@ def end_element(name):
 	glyph_stack.pop()
 
 	if glyph != None and glyph_stack[-1] == None:
+		if glyph.name in glyphs:
+			#(the trie can only map a name to one glyph, so don't silently pick one)
+			print("ERROR: more than one glyph is named '" + glyph.name + "'.")
+			sys.exit(1)
 		glyphs[glyph.name] = glyph
 		#TODO: grab glyph path from accum
 
@@ -514,6 +518,36 @@ for m in range(0x20, 0x7f):
 		missing.append(c)
 print("Font misses: " + ", ".join(map(lambda x: "'" + x + "'", missing)))
 
+#trie over the glyphs' (utf8) names, for allocation-free longest-match lookup;
+# each node's children are stored densely for the range of bytes they cover,
+# so following an edge is a bounds check and an array index:
+trie = [{'glyph':None, 'edges':{}}]
+for index in range(0, out_glyphs):
+	node = 0
+	for byte in out_chars[out_glyph_char_starts[index]:(out_glyph_char_starts + [len(out_chars)])[index+1]]:
+		if byte not in trie[node]['edges']:
+			trie[node]['edges'][byte] = len(trie)
+			trie.append({'glyph':None, 'edges':{}})
+		node = trie[node]['edges'][byte]
+	trie[node]['glyph'] = index
+
+out_trie = []
+out_trie_children = []
+for node in trie:
+	edges = node['edges']
+	glyph = "-1U" if node['glyph'] == None else str(node['glyph'])
+	if len(edges) == 0:
+		out_trie.append("{" + glyph + ", 0, 0, 0}")
+		continue
+	first = min(edges.keys())
+	count = max(edges.keys()) - first + 1
+	out_trie.append("{" + glyph + ", " + str(len(out_trie_children)) + ", " + str(first) + ", " + str(count) + "}")
+	for byte in range(first, first + count):
+		out_trie_children.append(edges.get(byte, 0)) #(0 -- the root -- is never a child, so it means "no child")
+if len(out_trie_children) == 0: out_trie_children = [0]
+
+print("Trie has " + str(len(out_trie)) + " nodes and " + str(len(out_trie_children)) + " child slots.")
+
 print("Writing PathFont '" + fontname + "' to '" + cppname + "'")
 
 cppfile = open(cppname, 'wb')
@@ -553,8 +587,16 @@ w('\tconstexpr const float font_coords[' + str(len(out_coords)) + '] = {\n')
 wd(out_coords, "{:.6f}f", 6)
 w('\t};\n')
 
+w('\tconstexpr const PathFont::TrieNode font_trie[' + str(len(out_trie)) + '] = {\n')
+wd(out_trie, "{}", 4)
+w('\t};\n')
+
+w('\tconstexpr const uint32_t font_trie_children[' + str(len(out_trie_children)) + '] = {\n')
+wd(out_trie_children, "{}", 12)
+w('\t};\n')
+
 
 w('}\n')
-w('PathFont PathFont::font(font_glyphs, font_glyph_widths, font_glyph_char_starts, font_chars, font_glyph_coord_starts, font_coords);\n')
+w('PathFont PathFont::font(font_glyphs, font_glyph_widths, font_glyph_char_starts, font_chars, font_glyph_coord_starts, font_coords, font_trie, font_trie_children);\n')
 
 cppfile.close()
@@ -0,0 +1,238 @@
+#include "mix_effects.hpp"
+#include "mix_kernels.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+//---- Biquad ----
+
+void Biquad::design(Type type, float frequency, float q, float gain_db, float rate) {
+	frequency = std::max(1.0f, std::min(0.49f * rate, frequency));
+	q = std::max(0.01f, q);
+
+	double w0 = 2.0 * 3.14159265358979 * double(frequency) / double(rate);
+	double cos_w0 = std::cos(w0);
+	double alpha = std::sin(w0) / (2.0 * double(q));
+	double A = std::pow(10.0, double(gain_db) / 40.0);
+	double shelf = 2.0 * std::sqrt(A) * alpha;
+
+	double b[3], a[3];
+	switch (type) {
+		case LowPass:
+			b[0] = (1.0 - cos_w0) / 2.0; b[1] = 1.0 - cos_w0; b[2] = (1.0 - cos_w0) / 2.0;
+			a[0] = 1.0 + alpha; a[1] = -2.0 * cos_w0; a[2] = 1.0 - alpha;
+			break;
+		case HighPass:
+			b[0] = (1.0 + cos_w0) / 2.0; b[1] = -(1.0 + cos_w0); b[2] = (1.0 + cos_w0) / 2.0;
+			a[0] = 1.0 + alpha; a[1] = -2.0 * cos_w0; a[2] = 1.0 - alpha;
+			break;
+		case BandPass: //(0dB peak gain)
+			b[0] = alpha; b[1] = 0.0; b[2] = -alpha;
+			a[0] = 1.0 + alpha; a[1] = -2.0 * cos_w0; a[2] = 1.0 - alpha;
+			break;
+		case Notch:
+			b[0] = 1.0; b[1] = -2.0 * cos_w0; b[2] = 1.0;
+			a[0] = 1.0 + alpha; a[1] = -2.0 * cos_w0; a[2] = 1.0 - alpha;
+			break;
+		case Peaking:
+			b[0] = 1.0 + alpha * A; b[1] = -2.0 * cos_w0; b[2] = 1.0 - alpha * A;
+			a[0] = 1.0 + alpha / A; a[1] = -2.0 * cos_w0; a[2] = 1.0 - alpha / A;
+			break;
+		case LowShelf:
+			b[0] = A * ((A + 1.0) - (A - 1.0) * cos_w0 + shelf);
+			b[1] = 2.0 * A * ((A - 1.0) - (A + 1.0) * cos_w0);
+			b[2] = A * ((A + 1.0) - (A - 1.0) * cos_w0 - shelf);
+			a[0] = (A + 1.0) + (A - 1.0) * cos_w0 + shelf;
+			a[1] = -2.0 * ((A - 1.0) + (A + 1.0) * cos_w0);
+			a[2] = (A + 1.0) + (A - 1.0) * cos_w0 - shelf;
+			break;
+		case HighShelf:
+		default:
+			b[0] = A * ((A + 1.0) + (A - 1.0) * cos_w0 + shelf);
+			b[1] = -2.0 * A * ((A - 1.0) + (A + 1.0) * cos_w0);
+			b[2] = A * ((A + 1.0) + (A - 1.0) * cos_w0 - shelf);
+			a[0] = (A + 1.0) - (A - 1.0) * cos_w0 + shelf;
+			a[1] = 2.0 * ((A - 1.0) - (A + 1.0) * cos_w0);
+			a[2] = (A + 1.0) - (A - 1.0) * cos_w0 - shelf;
+			break;
+	}
+
+	b0 = float(b[0] / a[0]);
+	b1 = float(b[1] / a[0]);
+	b2 = float(b[2] / a[0]);
+	a1 = float(a[1] / a[0]);
+	a2 = float(a[2] / a[0]);
+}
+
+void Biquad::process(float *frames, uint32_t count) {
+	for (uint32_t c = 0; c < 2; ++c) {
+		float s1 = z1[c], s2 = z2[c];
+		for (uint32_t k = 0; k < count; ++k) {
+			float x = frames[2*k+c];
+			float y = b0 * x + s1;
+			s1 = b1 * x - a1 * y + s2;
+			s2 = b2 * x - a2 * y;
+			frames[2*k+c] = y;
+		}
+		//(flush state that has decayed to nothing, so it doesn't linger as slow denormals)
+		if (std::abs(s1) < 1e-20f) s1 = 0.0f;
+		if (std::abs(s2) < 1e-20f) s2 = 0.0f;
+		z1[c] = s1;
+		z2[c] = s2;
+	}
+}
+
+void Biquad::reset() {
+	z1[0] = z1[1] = 0.0f;
+	z2[0] = z2[1] = 0.0f;
+}
+
+//---- Compressor ----
+
+void Compressor::configure(float threshold_db, float ratio, float attack, float release, float makeup_db, float rate) {
+	threshold = std::pow(10.0f, threshold_db / 20.0f);
+	slope = 1.0f - 1.0f / std::max(1.0f, ratio);
+	attack_coef = std::exp(-1.0f / (std::max(1e-4f, attack) * rate));
+	release_coef = std::exp(-1.0f / (std::max(1e-4f, release) * rate));
+	makeup = std::pow(10.0f, makeup_db / 20.0f);
+}
+
+void Compressor::process(float *frames, uint32_t count) {
+	float inv_threshold = 1.0f / threshold;
+	for (uint32_t k = 0; k < count; ++k) {
+		float level = std::max(std::abs(frames[2*k+0]), std::abs(frames[2*k+1]));
+		float coef = (level > envelope ? attack_coef : release_coef);
+		envelope = level + coef * (envelope - level);
+
+		//above threshold, the level (in dB) over it is scaled down by the ratio:
+		float gain = makeup;
+		if (envelope > threshold) gain *= std::pow(envelope * inv_threshold, -slope);
+		frames[2*k+0] *= gain;
+		frames[2*k+1] *= gain;
+	}
+}
+
+void Compressor::reset() {
+	envelope = 0.0f;
+}
+
+//---- ConvolutionReverb ----
+
+//in-place radix-2 FFT of 'reverb.size' complex values (unscaled, either way):
+static void fft(float *re, float *im, ConvolutionReverb const &reverb, bool inverse) {
+	uint32_t n = reverb.size;
+	for (uint32_t i = 0; i < n; ++i) {
+		uint32_t j = reverb.reversed[i];
+		if (i < j) {
+			std::swap(re[i], re[j]);
+			std::swap(im[i], im[j]);
+		}
+	}
+	float sign = (inverse ? -1.0f : 1.0f);
+	for (uint32_t half = 1; half < n; half *= 2) {
+		uint32_t stride = n / (2 * half);
+		for (uint32_t start = 0; start < n; start += 2 * half) {
+			for (uint32_t k = 0; k < half; ++k) {
+				float wr = reverb.twiddle_re[k * stride];
+				float wi = sign * reverb.twiddle_im[k * stride];
+				uint32_t a = start + k;
+				uint32_t b = a + half;
+				float tr = re[b] * wr - im[b] * wi;
+				float ti = re[b] * wi + im[b] * wr;
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+}
+
+ConvolutionReverb::ConvolutionReverb(float const *impulse, uint32_t length, uint32_t block_) : block(block_), size(2 * block_) {
+	assert(block > 0 && (block & (block - 1)) == 0 && "block is a power of two");
+	assert(impulse || length == 0);
+	partitions = std::max(1u, (length + block - 1) / block);
+
+	twiddle_re.resize(size / 2);
+	twiddle_im.resize(size / 2);
+	for (uint32_t k = 0; k < size / 2; ++k) {
+		double angle = -2.0 * 3.14159265358979 * double(k) / double(size);
+		twiddle_re[k] = float(std::cos(angle));
+		twiddle_im[k] = float(std::sin(angle));
+	}
+	reversed.resize(size);
+	uint32_t bits = 0;
+	while ((1u << bits) < size) ++bits;
+	for (uint32_t i = 0; i < size; ++i) {
+		uint32_t r = 0;
+		for (uint32_t b = 0; b < bits; ++b) {
+			if (i & (1u << b)) r |= 1u << (bits - 1 - b);
+		}
+		reversed[i] = r;
+	}
+
+	//transform each block of the response (zero-padded to the FFT size):
+	response_re.assign(size_t(partitions) * size, 0.0f);
+	response_im.assign(size_t(partitions) * size, 0.0f);
+	for (uint32_t p = 0; p < partitions; ++p) {
+		float *re = response_re.data() + size_t(p) * size;
+		float *im = response_im.data() + size_t(p) * size;
+		for (uint32_t k = 0; k < block && p * block + k < length; ++k) {
+			re[k] = impulse[p * block + k];
+		}
+		fft(re, im, *this, false);
+	}
+
+	history_re.assign(size_t(partitions) * size, 0.0f);
+	history_im.assign(size_t(partitions) * size, 0.0f);
+	input_re.assign(size, 0.0f);
+	input_im.assign(size, 0.0f);
+	sum_re.assign(size, 0.0f);
+	sum_im.assign(size, 0.0f);
+}
+
+void ConvolutionReverb::process(float *frames, float wet, float dry) {
+	//slide the input along a block ([previous block, this block]), left as real and right as imaginary:
+	std::copy(input_re.begin() + block, input_re.end(), input_re.begin());
+	std::copy(input_im.begin() + block, input_im.end(), input_im.begin());
+	for (uint32_t k = 0; k < block; ++k) {
+		input_re[block + k] = frames[2*k+0];
+		input_im[block + k] = frames[2*k+1];
+	}
+
+	//transform it into the newest spot in the history:
+	newest = (newest + partitions - 1) % partitions;
+	float *new_re = history_re.data() + size_t(newest) * size;
+	float *new_im = history_im.data() + size_t(newest) * size;
+	std::copy(input_re.begin(), input_re.end(), new_re);
+	std::copy(input_im.begin(), input_im.end(), new_im);
+	fft(new_re, new_im, *this, false);
+
+	//multiply each block of the response by the input from that many blocks ago, and add them all up:
+	std::fill(sum_re.begin(), sum_re.end(), 0.0f);
+	std::fill(sum_im.begin(), sum_im.end(), 0.0f);
+	for (uint32_t p = 0; p < partitions; ++p) {
+		uint32_t h = (newest + p) % partitions;
+		complex_multiply_add(sum_re.data(), sum_im.data(),
+			history_re.data() + size_t(h) * size, history_im.data() + size_t(h) * size,
+			response_re.data() + size_t(p) * size, response_im.data() + size_t(p) * size,
+			size);
+	}
+	fft(sum_re.data(), sum_im.data(), *this, true);
+
+	//the second half of the result is the part that didn't wrap around:
+	float scale = wet / float(size);
+	for (uint32_t k = 0; k < block; ++k) {
+		frames[2*k+0] = dry * frames[2*k+0] + scale * sum_re[block + k];
+		frames[2*k+1] = dry * frames[2*k+1] + scale * sum_im[block + k];
+	}
+}
+
+void ConvolutionReverb::reset() {
+	std::fill(history_re.begin(), history_re.end(), 0.0f);
+	std::fill(history_im.begin(), history_im.end(), 0.0f);
+	std::fill(input_re.begin(), input_re.end(), 0.0f);
+	std::fill(input_im.begin(), input_im.end(), 0.0f);
+	newest = 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ * Effects for the mixer's buses (see Sound::Bus in Sound.hpp).
+ *
+ * They all work in place on blocks of interleaved stereo frames ([l0 r0 l1 r1 ...]),
+ * and none of them allocate once they are set up, so they are safe to run on the audio thread.
+ */
+
+#include <cstdint>
+#include <vector>
+
+//Second-order IIR filter, with coefficients from R. Bristow-Johnson's "Audio EQ Cookbook":
+struct Biquad {
+	enum Type : uint8_t { LowPass, HighPass, BandPass, Notch, Peaking, LowShelf, HighShelf };
+
+	//(re)compute the coefficients -- this keeps the filter's state, so settings can be swept as it runs:
+	// ('gain_db' only matters for Peaking and the shelves)
+	void design(Type type, float frequency, float q, float gain_db, float rate);
+
+	void process(float *frames, uint32_t count);
+	void reset(); //forget past input
+
+	float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+	float z1[2] = { 0.0f, 0.0f }; //(transposed direct form II state, per channel)
+	float z2[2] = { 0.0f, 0.0f };
+};
+
+//Feed-forward peak compressor; stereo-linked, so both channels get the same gain (and the image doesn't shift):
+struct Compressor {
+	//'attack' and 'release' are in seconds:
+	void configure(float threshold_db, float ratio, float attack, float release, float makeup_db, float rate);
+
+	void process(float *frames, uint32_t count);
+	void reset();
+
+	float threshold = 1.0f; //(linear)
+	float slope = 0.0f; //how much of the level over threshold to take away (1 - 1 / ratio)
+	float attack_coef = 0.0f;
+	float release_coef = 0.0f;
+	float makeup = 1.0f;
+	float envelope = 0.0f; //detected level
+};
+
+//Convolution with a (mono) impulse response, for reverb:
+// uniformly-partitioned overlap-save, with one FFT each way per block; the two channels
+// are convolved together as the real and imaginary parts of one complex signal.
+struct ConvolutionReverb {
+	//(allocates, so construct it away from the audio thread)
+	ConvolutionReverb(float const *impulse, uint32_t length, uint32_t block);
+
+	//process exactly 'block' frames: out = dry * in + wet * (in convolved with the impulse response)
+	void process(float *frames, float wet, float dry);
+	void reset();
+
+	//how many blocks of output are left after the input goes silent:
+	uint32_t tail_blocks() const { return partitions + 1; }
+
+	uint32_t block; //frames per block
+	uint32_t size; //FFT size (twice the block)
+	uint32_t partitions; //impulse response length, in blocks
+
+	//block-sized pieces of the impulse response, transformed (partitions * size values each):
+	std::vector< float > response_re, response_im;
+	//the last 'partitions' blocks of input, transformed (a ring; history of delay d is at (newest + d) % partitions):
+	std::vector< float > history_re, history_im;
+	uint32_t newest = 0;
+	//the last two blocks of input (overlap-save transforms both), and scratch space:
+	std::vector< float > input_re, input_im;
+	std::vector< float > sum_re, sum_im;
+	//FFT tables:
+	std::vector< float > twiddle_re, twiddle_im;
+	std::vector< uint32_t > reversed;
+};
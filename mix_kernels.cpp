@@ -0,0 +1,317 @@
+#include "mix_kernels.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define MIX_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+//---- plain C++ ----
+
+static void mix_mono_to_stereo_scalar(float *out, float const *in, uint32_t count, float gain_l, float gain_r, float step_l, float step_r) {
+	for (uint32_t k = 0; k < count; ++k) {
+		out[2*k+0] += (gain_l + float(k) * step_l) * in[k];
+		out[2*k+1] += (gain_r + float(k) * step_r) * in[k];
+	}
+}
+
+static void mix_stereo_scalar(float *out, float const *in, uint32_t count, float gain, float step) {
+	for (uint32_t k = 0; k < count; ++k) {
+		out[2*k+0] += (gain + float(k) * step) * in[2*k+0];
+		out[2*k+1] += (gain + float(k) * step) * in[2*k+1];
+	}
+}
+
+static void int16_to_float_scalar(float *out, int16_t const *in, uint32_t count) {
+	for (uint32_t k = 0; k < count; ++k) {
+		out[k] = float(in[k]) * (1.0f / 32767.0f);
+	}
+}
+
+//(the row of the filter bank a fraction is in, and how far along to the next row it is)
+static_assert(ResamplePhases == 256, "fractions are split into 8 bits of row and 24 bits of interpolation");
+static inline float const *resample_row(float const *bank, uint32_t taps, uint64_t position, float *t) {
+	uint32_t fraction = uint32_t(position);
+	*t = float(fraction & 0xffffff) * (1.0f / 16777216.0f);
+	return bank + (fraction >> 24) * taps;
+}
+
+static void resample_scalar(float *out, uint32_t count, float const *window, uint64_t position, uint64_t step, float const *bank, uint32_t taps) {
+	for (uint32_t k = 0; k < count; ++k, position += step) {
+		float const *w = window + (position >> 32);
+		float t;
+		float const *row = resample_row(bank, taps, position, &t);
+		//(filtering with both rows and interpolating the results is the same as interpolating the coefficients)
+		float a = 0.0f, b = 0.0f;
+		for (uint32_t j = 0; j < taps; ++j) {
+			a += w[j] * row[j];
+			b += w[j] * row[taps + j];
+		}
+		out[k] = a + t * (b - a);
+	}
+}
+
+static void complex_multiply_add_scalar(float *sum_re, float *sum_im, float const *x_re, float const *x_im, float const *h_re, float const *h_im, uint32_t count) {
+	for (uint32_t k = 0; k < count; ++k) {
+		sum_re[k] += x_re[k] * h_re[k] - x_im[k] * h_im[k];
+		sum_im[k] += x_re[k] * h_im[k] + x_im[k] * h_re[k];
+	}
+}
+
+#ifdef MIX_KERNELS_X86
+
+//---- SSE2 (four frames at a time) ----
+
+static void mix_mono_to_stereo_sse2(float *out, float const *in, uint32_t count, float gain_l, float gain_r, float step_l, float step_r) {
+	//gains, interleaved like the output, for frames (k, k+1) and (k+2, k+3):
+	__m128 gains01 = _mm_setr_ps(gain_l, gain_r, gain_l + step_l, gain_r + step_r);
+	__m128 gains23 = _mm_add_ps(gains01, _mm_setr_ps(2.0f * step_l, 2.0f * step_r, 2.0f * step_l, 2.0f * step_r));
+	__m128 const steps = _mm_setr_ps(4.0f * step_l, 4.0f * step_r, 4.0f * step_l, 4.0f * step_r);
+
+	uint32_t k = 0;
+	for (; k + 4 <= count; k += 4) {
+		__m128 samples = _mm_loadu_ps(in + k);
+		//each sample goes to both channels: [s0 s0 s1 s1] [s2 s2 s3 s3]
+		float *o = out + 2*k;
+		_mm_storeu_ps(o + 0, _mm_add_ps(_mm_loadu_ps(o + 0), _mm_mul_ps(_mm_unpacklo_ps(samples, samples), gains01)));
+		_mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_mul_ps(_mm_unpackhi_ps(samples, samples), gains23)));
+		gains01 = _mm_add_ps(gains01, steps);
+		gains23 = _mm_add_ps(gains23, steps);
+	}
+	//leftovers:
+	mix_mono_to_stereo_scalar(out + 2*k, in + k, count - k, gain_l + float(k) * step_l, gain_r + float(k) * step_r, step_l, step_r);
+}
+
+static void mix_stereo_sse2(float *out, float const *in, uint32_t count, float gain, float step) {
+	//gains for frames (k, k+1), each twice to match the interleaved channels:
+	__m128 gains = _mm_setr_ps(gain, gain, gain + step, gain + step);
+	__m128 const steps = _mm_set1_ps(2.0f * step);
+
+	uint32_t k = 0;
+	for (; k + 2 <= count; k += 2) {
+		_mm_storeu_ps(out + 2*k, _mm_add_ps(_mm_loadu_ps(out + 2*k), _mm_mul_ps(_mm_loadu_ps(in + 2*k), gains)));
+		gains = _mm_add_ps(gains, steps);
+	}
+	//leftovers:
+	mix_stereo_scalar(out + 2*k, in + 2*k, count - k, gain + float(k) * step, step);
+}
+
+static void int16_to_float_sse2(float *out, int16_t const *in, uint32_t count) {
+	__m128 const scale = _mm_set1_ps(1.0f / 32767.0f);
+	uint32_t k = 0;
+	for (; k + 8 <= count; k += 8) {
+		__m128i samples = _mm_loadu_si128(reinterpret_cast< __m128i const * >(in + k));
+		//sign-extend to 32 bits by putting each value in the high half and shifting back down:
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+		_mm_storeu_ps(out + k + 0, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(out + k + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+	//leftovers:
+	int16_to_float_scalar(out + k, in + k, count - k);
+}
+
+static void resample_sse2(float *out, uint32_t count, float const *window, uint64_t position, uint64_t step, float const *bank, uint32_t taps) {
+	if (taps % 4 != 0) {
+		resample_scalar(out, count, window, position, step, bank, taps);
+		return;
+	}
+	for (uint32_t k = 0; k < count; ++k, position += step) {
+		float const *w = window + (position >> 32);
+		float t;
+		float const *row = resample_row(bank, taps, position, &t);
+		__m128 a = _mm_setzero_ps();
+		__m128 b = _mm_setzero_ps();
+		for (uint32_t j = 0; j < taps; j += 4) {
+			__m128 samples = _mm_loadu_ps(w + j);
+			a = _mm_add_ps(a, _mm_mul_ps(samples, _mm_loadu_ps(row + j)));
+			b = _mm_add_ps(b, _mm_mul_ps(samples, _mm_loadu_ps(row + taps + j)));
+		}
+		__m128 sum = _mm_add_ps(a, _mm_mul_ps(_mm_set1_ps(t), _mm_sub_ps(b, a)));
+		//add up the four lanes:
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		out[k] = _mm_cvtss_f32(sum);
+	}
+}
+
+static void complex_multiply_add_sse2(float *sum_re, float *sum_im, float const *x_re, float const *x_im, float const *h_re, float const *h_im, uint32_t count) {
+	uint32_t k = 0;
+	for (; k + 4 <= count; k += 4) {
+		__m128 xr = _mm_loadu_ps(x_re + k), xi = _mm_loadu_ps(x_im + k);
+		__m128 hr = _mm_loadu_ps(h_re + k), hi = _mm_loadu_ps(h_im + k);
+		_mm_storeu_ps(sum_re + k, _mm_add_ps(_mm_loadu_ps(sum_re + k), _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi))));
+		_mm_storeu_ps(sum_im + k, _mm_add_ps(_mm_loadu_ps(sum_im + k), _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr))));
+	}
+	//leftovers:
+	complex_multiply_add_scalar(sum_re + k, sum_im + k, x_re + k, x_im + k, h_re + k, h_im + k, count - k);
+}
+
+//---- AVX2 (eight frames at a time) ----
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MIX_KERNELS_AVX2 1
+#define MIX_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+//(MSVC only emits AVX2 code when building with /arch:AVX2)
+#define MIX_KERNELS_AVX2 1
+#define MIX_KERNELS_TARGET_AVX2
+#endif
+
+#ifdef MIX_KERNELS_AVX2
+MIX_KERNELS_TARGET_AVX2
+static void mix_mono_to_stereo_avx2(float *out, float const *in, uint32_t count, float gain_l, float gain_r, float step_l, float step_r) {
+	//gains, interleaved like the output, for frames k .. k+3 and k+4 .. k+7:
+	__m256 gains0 = _mm256_setr_ps(
+		gain_l, gain_r,
+		gain_l + 1.0f * step_l, gain_r + 1.0f * step_r,
+		gain_l + 2.0f * step_l, gain_r + 2.0f * step_r,
+		gain_l + 3.0f * step_l, gain_r + 3.0f * step_r);
+	__m256 gains1 = _mm256_add_ps(gains0, _mm256_setr_ps(
+		4.0f * step_l, 4.0f * step_r, 4.0f * step_l, 4.0f * step_r,
+		4.0f * step_l, 4.0f * step_r, 4.0f * step_l, 4.0f * step_r));
+	__m256 const steps = _mm256_setr_ps(
+		8.0f * step_l, 8.0f * step_r, 8.0f * step_l, 8.0f * step_r,
+		8.0f * step_l, 8.0f * step_r, 8.0f * step_l, 8.0f * step_r);
+	__m256i const dup0 = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+	__m256i const dup1 = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+
+	uint32_t k = 0;
+	for (; k + 8 <= count; k += 8) {
+		__m256 samples = _mm256_loadu_ps(in + k);
+		//each sample goes to both channels: [s0 s0 s1 s1 s2 s2 s3 s3] [s4 s4 ... s7 s7]
+		float *o = out + 2*k;
+		_mm256_storeu_ps(o + 0, _mm256_add_ps(_mm256_loadu_ps(o + 0), _mm256_mul_ps(_mm256_permutevar8x32_ps(samples, dup0), gains0)));
+		_mm256_storeu_ps(o + 8, _mm256_add_ps(_mm256_loadu_ps(o + 8), _mm256_mul_ps(_mm256_permutevar8x32_ps(samples, dup1), gains1)));
+		gains0 = _mm256_add_ps(gains0, steps);
+		gains1 = _mm256_add_ps(gains1, steps);
+	}
+	//leftovers:
+	mix_mono_to_stereo_sse2(out + 2*k, in + k, count - k, gain_l + float(k) * step_l, gain_r + float(k) * step_r, step_l, step_r);
+}
+
+MIX_KERNELS_TARGET_AVX2
+static void mix_stereo_avx2(float *out, float const *in, uint32_t count, float gain, float step) {
+	//gains for frames k .. k+3, each twice to match the interleaved channels:
+	__m256 gains = _mm256_setr_ps(
+		gain, gain,
+		gain + 1.0f * step, gain + 1.0f * step,
+		gain + 2.0f * step, gain + 2.0f * step,
+		gain + 3.0f * step, gain + 3.0f * step);
+	__m256 const steps = _mm256_set1_ps(4.0f * step);
+
+	uint32_t k = 0;
+	for (; k + 4 <= count; k += 4) {
+		_mm256_storeu_ps(out + 2*k, _mm256_add_ps(_mm256_loadu_ps(out + 2*k), _mm256_mul_ps(_mm256_loadu_ps(in + 2*k), gains)));
+		gains = _mm256_add_ps(gains, steps);
+	}
+	//leftovers:
+	mix_stereo_sse2(out + 2*k, in + 2*k, count - k, gain + float(k) * step, step);
+}
+
+MIX_KERNELS_TARGET_AVX2
+static void int16_to_float_avx2(float *out, int16_t const *in, uint32_t count) {
+	__m256 const scale = _mm256_set1_ps(1.0f / 32767.0f);
+	uint32_t k = 0;
+	for (; k + 16 <= count; k += 16) {
+		__m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast< __m128i const * >(in + k + 0)));
+		__m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast< __m128i const * >(in + k + 8)));
+		_mm256_storeu_ps(out + k + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+		_mm256_storeu_ps(out + k + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+	}
+	//leftovers:
+	int16_to_float_sse2(out + k, in + k, count - k);
+}
+MIX_KERNELS_TARGET_AVX2
+static void resample_avx2(float *out, uint32_t count, float const *window, uint64_t position, uint64_t step, float const *bank, uint32_t taps) {
+	if (taps % 8 != 0) {
+		resample_sse2(out, count, window, position, step, bank, taps);
+		return;
+	}
+	for (uint32_t k = 0; k < count; ++k, position += step) {
+		float const *w = window + (position >> 32);
+		float t;
+		float const *row = resample_row(bank, taps, position, &t);
+		__m256 a = _mm256_setzero_ps();
+		__m256 b = _mm256_setzero_ps();
+		for (uint32_t j = 0; j < taps; j += 8) {
+			__m256 samples = _mm256_loadu_ps(w + j);
+			a = _mm256_add_ps(a, _mm256_mul_ps(samples, _mm256_loadu_ps(row + j)));
+			b = _mm256_add_ps(b, _mm256_mul_ps(samples, _mm256_loadu_ps(row + taps + j)));
+		}
+		__m256 sum8 = _mm256_add_ps(a, _mm256_mul_ps(_mm256_set1_ps(t), _mm256_sub_ps(b, a)));
+		//add up the eight lanes:
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		out[k] = _mm_cvtss_f32(sum);
+	}
+}
+
+MIX_KERNELS_TARGET_AVX2
+static void complex_multiply_add_avx2(float *sum_re, float *sum_im, float const *x_re, float const *x_im, float const *h_re, float const *h_im, uint32_t count) {
+	uint32_t k = 0;
+	for (; k + 8 <= count; k += 8) {
+		__m256 xr = _mm256_loadu_ps(x_re + k), xi = _mm256_loadu_ps(x_im + k);
+		__m256 hr = _mm256_loadu_ps(h_re + k), hi = _mm256_loadu_ps(h_im + k);
+		_mm256_storeu_ps(sum_re + k, _mm256_add_ps(_mm256_loadu_ps(sum_re + k), _mm256_sub_ps(_mm256_mul_ps(xr, hr), _mm256_mul_ps(xi, hi))));
+		_mm256_storeu_ps(sum_im + k, _mm256_add_ps(_mm256_loadu_ps(sum_im + k), _mm256_add_ps(_mm256_mul_ps(xr, hi), _mm256_mul_ps(xi, hr))));
+	}
+	//leftovers:
+	complex_multiply_add_sse2(sum_re + k, sum_im + k, x_re + k, x_im + k, h_re + k, h_im + k, count - k);
+}
+#endif //MIX_KERNELS_AVX2
+
+#endif //MIX_KERNELS_X86
+
+//---- picking a version ----
+
+namespace {
+	struct Kernels {
+		char const *name;
+		void (*mix_mono_to_stereo)(float *, float const *, uint32_t, float, float, float, float);
+		void (*mix_stereo)(float *, float const *, uint32_t, float, float);
+		void (*int16_to_float)(float *, int16_t const *, uint32_t);
+		void (*resample)(float *, uint32_t, float const *, uint64_t, uint64_t, float const *, uint32_t);
+		void (*complex_multiply_add)(float *, float *, float const *, float const *, float const *, float const *, uint32_t);
+	};
+
+	Kernels const &kernels() {
+		static Kernels const picked = [](){
+			#if defined(MIX_KERNELS_AVX2) && (defined(__GNUC__) || defined(__clang__))
+			if (__builtin_cpu_supports("avx2")) return Kernels{"avx2", mix_mono_to_stereo_avx2, mix_stereo_avx2, int16_to_float_avx2, resample_avx2, complex_multiply_add_avx2};
+			return Kernels{"sse2", mix_mono_to_stereo_sse2, mix_stereo_sse2, int16_to_float_sse2, resample_sse2, complex_multiply_add_sse2};
+			#elif defined(MIX_KERNELS_AVX2)
+			return Kernels{"avx2", mix_mono_to_stereo_avx2, mix_stereo_avx2, int16_to_float_avx2, resample_avx2, complex_multiply_add_avx2}; //(built for AVX2, so the CPU had better have it)
+			#elif defined(MIX_KERNELS_X86)
+			return Kernels{"sse2", mix_mono_to_stereo_sse2, mix_stereo_sse2, int16_to_float_sse2, resample_sse2, complex_multiply_add_sse2}; //(every x86-64 CPU has SSE2)
+			#else
+			return Kernels{"scalar", mix_mono_to_stereo_scalar, mix_stereo_scalar, int16_to_float_scalar, resample_scalar, complex_multiply_add_scalar};
+			#endif
+		}();
+		return picked;
+	}
+}
+
+void mix_mono_to_stereo(float *out, float const *in, uint32_t count, float gain_l, float gain_r, float step_l, float step_r) {
+	kernels().mix_mono_to_stereo(out, in, count, gain_l, gain_r, step_l, step_r);
+}
+
+void mix_stereo(float *out, float const *in, uint32_t count, float gain, float step) {
+	kernels().mix_stereo(out, in, count, gain, step);
+}
+
+void int16_to_float(float *out, int16_t const *in, uint32_t count) {
+	kernels().int16_to_float(out, in, count);
+}
+
+void resample(float *out, uint32_t count, float const *window, uint64_t position, uint64_t step, float const *bank, uint32_t taps) {
+	kernels().resample(out, count, window, position, step, bank, taps);
+}
+
+void complex_multiply_add(float *sum_re, float *sum_im, float const *x_re, float const *x_im, float const *h_re, float const *h_im, uint32_t count) {
+	kernels().complex_multiply_add(sum_re, sum_im, x_re, x_im, h_re, h_im, count);
+}
+
+char const *mix_kernels_name() {
+	return kernels().name;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+/*
+ * Inner loops of the audio mixer (see mix_audio in Sound.cpp).
+ *
+ * Each kernel is written three ways -- AVX2, SSE2, and plain C++ -- and the
+ * best one the CPU supports is picked the first time it is called.
+ * All of them work on any alignment and any count.
+ */
+
+#include <cstdint>
+
+//add 'count' mono samples from 'in' to the interleaved stereo frames in 'out' ([l0 r0 l1 r1 ...]),
+// scaling sample k by gains that ramp linearly: (gain_l + k * step_l, gain_r + k * step_r)
+void mix_mono_to_stereo(float *out, float const *in, uint32_t count, float gain_l, float gain_r, float step_l, float step_r);
+
+//add 'count' interleaved stereo frames from 'in' to those in 'out', scaling frame k by a gain that ramps linearly: gain + k * step
+void mix_stereo(float *out, float const *in, uint32_t count, float gain, float step);
+
+//convert 16-bit samples to floats in [-1,1] (the inverse of the Int16 sample storage's encoding):
+void int16_to_float(float *out, int16_t const *in, uint32_t count);
+
+//resample with a polyphase filter bank: for k < count, with p = position + k * step (32.32 fixed point),
+// out[k] = sum over j < taps of window[(p >> 32) + j] * c[j], where the coefficients c for the fraction of p
+// are interpolated between the rows of 'bank' ((ResamplePhases + 1) rows of 'taps' floats; row r is for a fraction of r / ResamplePhases):
+constexpr uint32_t ResamplePhases = 256;
+void resample(float *out, uint32_t count, float const *window, uint64_t position, uint64_t step, float const *bank, uint32_t taps);
+
+//multiply-accumulate complex values kept as separate real and imaginary arrays: sum[k] += x[k] * h[k]
+// (the inner loop of the bus reverb's convolution -- see mix_effects.hpp)
+void complex_multiply_add(float *sum_re, float *sum_im, float const *x_re, float const *x_im, float const *h_re, float const *h_im, uint32_t count);
+
+//which version of the kernels is in use ("avx2", "sse2", or "scalar"):
+char const *mix_kernels_name();
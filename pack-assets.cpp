@@ -0,0 +1,152 @@
+//pack-assets bundles loose data files into an asset pack (see AssetPack.hpp)
+// usage: pack-assets <out.pack> <root> <path> [<path> ...]
+// each <path> is a file or directory (searched recursively) relative to <root>,
+// and is stored under its name relative to <root> (e.g. "data/scene1.png")
+//
+// typical use: ./pack-assets dist/data.pack dist data
+
+#include "AssetPack.hpp"
+
+#include <zlib.h>
+
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try {
+#endif
+	if (argc < 4) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <out.pack> <root> <path> [<path> ...]" << std::endl;
+		return 1;
+	}
+	std::string out_file = argv[1];
+	fs::path root = argv[2];
+
+	//----- gather files -----
+	std::vector< std::string > names;
+	for (int a = 3; a < argc; ++a) {
+		fs::path path = root / argv[a];
+		if (fs::is_directory(path)) {
+			for (auto const &entry : fs::recursive_directory_iterator(path)) {
+				if (entry.is_regular_file()) names.emplace_back(fs::relative(entry.path(), root).generic_string());
+			}
+		} else if (fs::is_regular_file(path)) {
+			names.emplace_back(fs::relative(path, root).generic_string());
+		} else {
+			throw std::runtime_error("'" + path.string() + "' is not a file or directory.");
+		}
+	}
+	//sorted so that packs are reproducible:
+	std::sort(names.begin(), names.end());
+	names.erase(std::unique(names.begin(), names.end()), names.end());
+
+	//----- write entries -----
+	std::ofstream out(out_file, std::ios::binary);
+	if (!out) throw std::runtime_error("Failed to open '" + out_file + "' for writing.");
+
+	AssetPackHeader header;
+	out.write(reinterpret_cast< char const * >(&header), sizeof(header));
+	uint64_t at = sizeof(header);
+
+	auto pad_to = [&out, &at](uint64_t align) {
+		static char const zeros[AssetPackAlign] = {};
+		uint64_t pad = (align - at % align) % align;
+		out.write(zeros, std::streamsize(pad));
+		at += pad;
+	};
+
+	std::vector< AssetPackEntry > entries;
+	std::string all_names;
+	uint64_t total_size = 0;
+	for (auto const &name : names) {
+		std::ifstream file(root / name, std::ios::binary);
+		std::vector< char > data(size_t(fs::file_size(root / name)));
+		if (!file.read(data.data(), std::streamsize(data.size()))) {
+			throw std::runtime_error("Failed to read '" + (root / name).string() + "'.");
+		}
+
+		AssetPackEntry entry;
+		entry.hash = asset_pack_hash(name.data(), name.data() + name.size());
+		entry.size = data.size();
+		entry.name_begin = uint32_t(all_names.size());
+		all_names += name;
+		entry.name_end = uint32_t(all_names.size());
+
+		//compress if it's worth it (already-compressed formats like .png usually aren't):
+		std::vector< char > compressed(compressBound(uLong(data.size())));
+		uLongf compressed_size = uLongf(compressed.size());
+		if (compress2(reinterpret_cast< Bytef * >(compressed.data()), &compressed_size,
+			reinterpret_cast< Bytef const * >(data.data()), uLong(data.size()), Z_BEST_COMPRESSION) == Z_OK
+		 && compressed_size < data.size() - data.size() / 8) {
+			entry.flags |= AssetPackDeflate;
+			compressed.resize(compressed_size);
+			data.swap(compressed);
+		}
+		entry.stored_size = data.size();
+
+		pad_to(AssetPackAlign);
+		entry.offset = at;
+		out.write(data.data(), std::streamsize(data.size()));
+		at += data.size();
+		total_size += entry.size;
+
+		std::cout << "  " << name << ": " << entry.size << " bytes";
+		if (entry.flags & AssetPackDeflate) std::cout << " (deflated to " << entry.stored_size << ")";
+		std::cout << "\n";
+
+		entries.emplace_back(entry);
+	}
+
+	//----- write index -----
+	header.entry_count = uint32_t(entries.size());
+	header.bucket_count = 1;
+	while (header.bucket_count < 2 * header.entry_count) header.bucket_count *= 2;
+	if (header.bucket_count <= header.entry_count) header.bucket_count *= 2;
+
+	std::vector< uint32_t > buckets(header.bucket_count, AssetPackEmptyBucket);
+	uint32_t mask = header.bucket_count - 1;
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		uint32_t b = uint32_t(entries[i].hash) & mask;
+		while (buckets[b] != AssetPackEmptyBucket) b = (b + 1) & mask;
+		buckets[b] = i;
+	}
+
+	pad_to(AssetPackAlign);
+	header.entries_offset = at;
+	out.write(reinterpret_cast< char const * >(entries.data()), std::streamsize(entries.size() * sizeof(AssetPackEntry)));
+	at += entries.size() * sizeof(AssetPackEntry);
+
+	header.buckets_offset = at;
+	out.write(reinterpret_cast< char const * >(buckets.data()), std::streamsize(buckets.size() * sizeof(uint32_t)));
+	at += buckets.size() * sizeof(uint32_t);
+
+	header.names_offset = at;
+	header.names_size = all_names.size();
+	out.write(all_names.data(), std::streamsize(all_names.size()));
+	at += all_names.size();
+
+	out.seekp(0);
+	out.write(reinterpret_cast< char const * >(&header), sizeof(header));
+	if (!out) throw std::runtime_error("Failed to write '" + out_file + "'.");
+
+	std::cout << "Packed " << entries.size() << " files (" << total_size << " bytes) into '" << out_file << "' (" << at << " bytes)." << std::endl;
+
+	return 0;
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
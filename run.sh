@@ -1,3 +1,4 @@
 node Maekfile.js
+./pack-assets dist/data.pack dist data
 cd dist
-./game
\ No newline at end of file
+./game
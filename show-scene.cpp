@@ -2,6 +2,7 @@
 #include "ShowSceneMode.hpp"
 #include "Load.hpp"
 #include "GL.hpp"
+#include "DrawLines.hpp"
 #include "load_save_png.hpp"
 #include "ShowSceneProgram.hpp"
 
@@ -214,6 +215,8 @@ int main(int argc, char **argv) {
 		{ //(3) call the current mode's "draw" function to produce output:
 		
 			Mode::current->draw(drawable_size);
+			//...and draw the debug lines it queued, all at once:
+			DrawLines::submit_frame();
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
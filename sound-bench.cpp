@@ -0,0 +1,211 @@
+//sound-bench times the mixer with no audio device (so it runs anywhere, including headless CI boxes):
+// for each combination of voice count, 2D/3D panning, and loop density (the fraction of voices that are looping
+// rather than one-shots, which are restarted as soon as they finish) it renders a few seconds of audio offline
+// and reports the time per output frame along with a checksum of the output.
+// Checksums are the same from run to run (for a given build and kernel), so they double as a regression test.
+// usage: sound-bench [--blocks N] [--voices N,N,...] [--budget N] [--storage float|int16|adpcm] [--pitch P] [--resampler linear|sinc8|sinc32] [--threads N,N,...] [--wav file.wav]
+// (--pitch plays every voice at a slightly different pitch around P, so they all go through the resampler;
+//  --threads runs every combination with each of the given numbers of mixer threads, to compare against the serial mixer -- e.g. '--threads 1,2,4,8';
+//   'speedup' is against the first count given, and 'worst us' is the slowest block, which is what has to beat the audio device's deadline;
+//  --wav saves the output of the first combination)
+
+#include "Sound.hpp"
+#include "load_wav.hpp"
+#include "mix_kernels.hpp"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+//64-bit FNV-1a over the bits of the output:
+static uint64_t checksum(std::vector< float > const &frames) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	unsigned char const *bytes = reinterpret_cast< unsigned char const * >(frames.data());
+	for (size_t i = 0; i < frames.size() * sizeof(float); ++i) {
+		hash = (hash ^ uint64_t(bytes[i])) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+//deterministic noise-ish test signal (a few partials plus a little LCG noise):
+static std::vector< float > make_signal(uint32_t length, uint32_t seed) {
+	std::vector< float > data(length);
+	uint32_t state = seed * 747796405u + 2891336453u;
+	float f = 110.0f * float(1 + seed % 7);
+	for (uint32_t i = 0; i < length; ++i) {
+		state = state * 1664525u + 1013904223u;
+		float noise = float(state >> 8) / float(1 << 24) - 0.5f;
+		float t = float(i) / 48000.0f;
+		data[i] = 0.3f * std::sin(2.0f * 3.1415926f * f * t) + 0.1f * std::sin(2.0f * 3.1415926f * 2.01f * f * t) + 0.05f * noise;
+	}
+	//fade the ends so that one-shots don't click:
+	for (uint32_t i = 0; i < std::min(length / 2, 64u); ++i) {
+		float amt = float(i) / 64.0f;
+		data[i] *= amt;
+		data[length - 1 - i] *= amt;
+	}
+	return data;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try {
+#endif
+	uint32_t blocks = 200; //(about 4.3 seconds of audio)
+	std::vector< uint32_t > voice_counts{ 1, 16, 64, 256, 1024 };
+	uint32_t budget = Sound::MaxVoices;
+	Sound::Sample::Storage storage = Sound::Sample::Storage::Decoded;
+	float pitch = 1.0f;
+	Sound::Resampler resampler = Sound::Resampler::Sinc8;
+	std::vector< uint32_t > thread_counts{ 1 };
+	std::string wav;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--blocks" && argi + 1 < argc) {
+			blocks = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--voices" && argi + 1 < argc) {
+			voice_counts.clear();
+			std::istringstream list(argv[++argi]);
+			std::string count;
+			while (std::getline(list, count, ',')) {
+				voice_counts.emplace_back(uint32_t(std::stoul(count)));
+			}
+		} else if (arg == "--budget" && argi + 1 < argc) {
+			budget = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--storage" && argi + 1 < argc) {
+			std::string name = argv[++argi];
+			if (name == "float") storage = Sound::Sample::Storage::Decoded;
+			else if (name == "int16") storage = Sound::Sample::Storage::Int16;
+			else if (name == "adpcm") storage = Sound::Sample::Storage::ADPCM;
+			else throw std::runtime_error("Unknown storage '" + name + "'; expecting float, int16, or adpcm.");
+		} else if (arg == "--pitch" && argi + 1 < argc) {
+			pitch = std::stof(argv[++argi]);
+		} else if (arg == "--resampler" && argi + 1 < argc) {
+			std::string name = argv[++argi];
+			if (name == "linear") resampler = Sound::Resampler::Linear;
+			else if (name == "sinc8") resampler = Sound::Resampler::Sinc8;
+			else if (name == "sinc32") resampler = Sound::Resampler::Sinc32;
+			else throw std::runtime_error("Unknown resampler '" + name + "'; expecting linear, sinc8, or sinc32.");
+		} else if (arg == "--threads" && argi + 1 < argc) {
+			thread_counts.clear();
+			std::istringstream list(argv[++argi]);
+			std::string count;
+			while (std::getline(list, count, ',')) {
+				thread_counts.emplace_back(uint32_t(std::stoul(count)));
+			}
+		} else if (arg == "--wav" && argi + 1 < argc) {
+			wav = argv[++argi];
+		} else {
+			throw std::runtime_error("Unrecognized argument '" + arg + "'; usage: sound-bench [--blocks N] [--voices N,N,...] [--budget N] [--storage float|int16|adpcm] [--pitch P] [--resampler linear|sinc8|sinc32] [--threads N,N,...] [--wav file.wav]");
+		}
+	}
+
+	//a few looping sounds (about a second each) and a few one-shots (about a tenth of a second each):
+	std::vector< Sound::Sample > loops, shots;
+	for (uint32_t s = 0; s < 4; ++s) {
+		loops.emplace_back(make_signal(48000 + 1000 * s, s), storage);
+		shots.emplace_back(make_signal(4800 + 300 * s, 10 + s), storage);
+	}
+
+	std::cout << "Rendering " << blocks << " blocks (" << blocks * Sound::BlockFrames << " frames) per run; voice budget " << budget << "; mixing with " << mix_kernels_name()
+		<< (pitch != 1.0f ? "; resampling every voice" : "") << "." << std::endl;
+	if (thread_counts != std::vector< uint32_t >{ 1 }) {
+		std::cout << "(" << std::thread::hardware_concurrency() << " cores; mixer threads are capped at that.)" << std::endl;
+	}
+	std::cout << std::setw(7) << "voices" << std::setw(7) << "pan" << std::setw(7) << "loops" << std::setw(9) << "threads"
+		<< std::setw(14) << "ns/frame" << std::setw(10) << "worst us" << std::setw(9) << "speedup" << std::setw(10) << "real" << std::setw(20) << "checksum" << std::endl;
+
+	bool first = true;
+	for (uint32_t voices : voice_counts) {
+		for (bool in_3D : { false, true }) {
+			for (float density : { 0.0f, 0.5f, 1.0f }) {
+				double baseline_ns = 0.0; //(time per frame with thread_counts[0] threads)
+				for (uint32_t threads : thread_counts) {
+					Sound::set_mixer_threads(threads);
+					Sound::init_offline();
+					Sound::set_voice_budget(budget);
+					Sound::listener.set_position_right(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 0.0f);
+
+					//voice v gets a fixed position / pan, and loops if it falls under the loop density:
+					uint32_t looping = uint32_t(std::round(density * float(voices)));
+					std::vector< Sound::PlayingSample > playing(voices);
+					auto start = [&](uint32_t v) {
+						float angle = float(v) * 2.39996f; //(golden angle, to spread voices around)
+						float pan = std::sin(angle);
+						glm::vec3 position = float(1 + v % 10) * glm::vec3(std::cos(angle), std::sin(angle), 0.0f);
+						float volume = 1.0f / float(voices);
+						Sound::Sample const &sample = (v < looping ? loops[v % loops.size()] : shots[v % shots.size()]);
+						if (v < looping) {
+							playing[v] = (in_3D ? Sound::loop_3D(sample, volume, position, 5.0f) : Sound::loop(sample, volume, pan));
+						} else {
+							playing[v] = (in_3D ? Sound::play_3D(sample, volume, position, 5.0f) : Sound::play(sample, volume, pan));
+						}
+						if (pitch != 1.0f) {
+							playing[v].set_resampler(resampler);
+							playing[v].set_pitch(pitch * (1.0f + 0.001f * float(v % 16)), 0.0f);
+						}
+					};
+					for (uint32_t v = 0; v < voices; ++v) {
+						start(v);
+					}
+
+					std::vector< float > frames(size_t(blocks) * Sound::BlockFrames * 2);
+					std::chrono::duration< double > elapsed(0.0);
+					std::chrono::duration< double > worst(0.0);
+					uint32_t real = 0;
+					for (uint32_t b = 0; b < blocks; ++b) {
+						//restart one-shots that have finished:
+						for (uint32_t v = looping; v < voices; ++v) {
+							if (!playing[v].playing()) start(v);
+						}
+						auto before = std::chrono::high_resolution_clock::now();
+						Sound::render(1, frames.data() + size_t(b) * Sound::BlockFrames * 2);
+						std::chrono::duration< double > took = std::chrono::high_resolution_clock::now() - before;
+						elapsed += took;
+						worst = std::max(worst, took);
+						real = std::max(real, Sound::get_voice_stats().real);
+					}
+
+					Sound::shutdown();
+
+					double ns_per_frame = elapsed.count() * 1e9 / double(size_t(blocks) * Sound::BlockFrames);
+					if (threads == thread_counts[0]) baseline_ns = ns_per_frame;
+					std::cout << std::setw(7) << voices << std::setw(7) << (in_3D ? "3D" : "2D") << std::setw(6) << uint32_t(density * 100.0f) << "%" << std::setw(9) << threads
+						<< std::setw(14) << std::fixed << std::setprecision(2) << ns_per_frame
+						<< std::setw(10) << std::setprecision(0) << worst.count() * 1e6
+						<< std::setw(8) << std::setprecision(2) << baseline_ns / ns_per_frame << "x"
+						<< std::setw(10) << real
+						<< "    " << std::hex << std::setw(16) << std::setfill('0') << checksum(frames) << std::dec << std::setfill(' ')
+						<< std::endl;
+
+					if (first && !wav.empty()) {
+						save_wav(wav, frames.data(), frames.size() / 2);
+						std::cout << "  (wrote '" << wav << "')" << std::endl;
+					}
+					first = false;
+				}
+			}
+		}
+	}
+
+	return 0;
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
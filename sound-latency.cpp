@@ -0,0 +1,145 @@
+//sound-latency checks that the game thread never waits on the audio thread:
+// it keeps a few hundred looping samples playing (so every mix_audio call has real work to do),
+// then hammers the game-side Sound calls -- play / set_volume / set_position / stop / listener updates --
+// timing every single call, and reports the worst of them.
+// For comparison it also times Sound::lock() + Sound::unlock() pairs, which is what each of those calls used to cost.
+// Exits with status 1 if any kind of game-side call has a p99.9 over --p999-us (default 20us) or a max over --max-us (default 1000us):
+//  a call that waits on the mixer waits for (part of) a whole mix, which shows up in the p99.9;
+//  the max only catches the worst stalls, since on a busy machine any call can be preempted for a while.
+// usage: sound-latency [--seconds S] [--voices N] [--p999-us US] [--max-us US]
+// (uses SDL's "dummy" audio driver unless SDL_AUDIODRIVER is set, so it runs without a sound card)
+
+#include "Sound.hpp"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//summarize a set of call durations (in nanoseconds); returns false if its p99.9 or max is over the given limit:
+static bool report(std::string const &name, std::vector< uint64_t > &ns, uint64_t p999_limit = -1ULL, uint64_t max_limit = -1ULL) {
+	if (ns.empty()) return true;
+	std::sort(ns.begin(), ns.end());
+	auto at = [&ns](double p) {
+		return ns[std::min(ns.size() - 1, size_t(p * ns.size()))];
+	};
+	size_t over_100us = ns.end() - std::upper_bound(ns.begin(), ns.end(), uint64_t(100000));
+	std::cout << "  " << std::setw(16) << std::left << name << std::right
+		<< std::setw(10) << ns.size() << " calls"
+		<< "  median " << std::setw(7) << at(0.5) << "ns"
+		<< "  p99.9 " << std::setw(8) << at(0.999) << "ns"
+		<< "  max " << std::setw(9) << ns.back() << "ns"
+		<< "  >100us: " << over_100us;
+	bool ok = (at(0.999) <= p999_limit && ns.back() <= max_limit);
+	if (!ok) std::cout << "  <-- too slow";
+	std::cout << std::endl;
+	return ok;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try {
+#endif
+	float seconds = 5.0f;
+	uint32_t voices = 300;
+	uint64_t p999_limit = 20000; //(ns)
+	uint64_t max_limit = 1000000; //(ns)
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--seconds" && argi + 1 < argc) {
+			seconds = std::stof(argv[++argi]);
+		} else if (arg == "--voices" && argi + 1 < argc) {
+			voices = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--p999-us" && argi + 1 < argc) {
+			p999_limit = uint64_t(std::stod(argv[++argi]) * 1000.0);
+		} else if (arg == "--max-us" && argi + 1 < argc) {
+			max_limit = uint64_t(std::stod(argv[++argi]) * 1000.0);
+		} else {
+			throw std::runtime_error("Unrecognized argument '" + arg + "'; usage: sound-latency [--seconds S] [--voices N] [--p999-us US] [--max-us US]");
+		}
+	}
+
+	if (!SDL_getenv("SDL_AUDIODRIVER")) SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+
+	Sound::init();
+
+	//a second of tone to play:
+	std::vector< float > tone(48000);
+	for (uint32_t i = 0; i < tone.size(); ++i) {
+		tone[i] = 0.1f * std::sin(float(i) * (2.0f * 3.1415926f * 440.0f / 48000.0f));
+	}
+	Sound::Sample sample(tone);
+
+	std::vector< Sound::PlayingSample > loops;
+	for (uint32_t v = 0; v < voices; ++v) {
+		loops.emplace_back(Sound::loop_3D(sample, 0.01f, glm::vec3(float(v % 20), float(v / 20), 0.0f), 10.0f));
+	}
+
+	std::vector< uint64_t > play_ns, set_ns, stop_ns, listener_ns, lock_ns;
+
+	using clock = std::chrono::high_resolution_clock;
+	auto time = [](std::vector< uint64_t > &into, auto &&fn) {
+		auto before = clock::now();
+		fn();
+		auto after = clock::now();
+		into.emplace_back(uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(after - before).count()));
+	};
+
+	std::cout << "Mixing " << voices << " looping voices for " << seconds << "s; timing game-thread calls..." << std::endl;
+
+	auto start = clock::now();
+	uint32_t step = 0;
+	while (std::chrono::duration< float >(clock::now() - start).count() < seconds) {
+		//roughly what a busy frame might do, all at once:
+		for (uint32_t i = 0; i < 50; ++i, ++step) {
+			auto &loop = loops[step % loops.size()];
+			time(set_ns, [&](){ loop.set_volume(0.005f + 0.005f * float(step % 3)); });
+			time(set_ns, [&](){ loop.set_position(glm::vec3(float(step % 17), float(step % 13), 0.0f)); });
+		}
+		time(listener_ns, [&](){ Sound::listener.set_position_right(glm::vec3(float(step % 7), 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)); });
+		Sound::PlayingSample shot;
+		time(play_ns, [&](){ shot = Sound::play(sample, 0.01f, 0.0f); });
+		time(stop_ns, [&](){ shot.stop(); });
+
+		//the old way -- every call took the audio device lock:
+		time(lock_ns, [&](){ Sound::lock(); Sound::unlock(); });
+
+		SDL_Delay(1);
+	}
+
+	std::cout << "Game-thread Sound calls (limits: p99.9 " << p999_limit / 1000.0 << "us, max " << max_limit / 1000.0 << "us):" << std::endl;
+	bool ok = true;
+	ok = report("play", play_ns, p999_limit, max_limit) && ok;
+	ok = report("set_*", set_ns, p999_limit, max_limit) && ok;
+	ok = report("stop", stop_ns, p999_limit, max_limit) && ok;
+	ok = report("listener", listener_ns, p999_limit, max_limit) && ok;
+	std::cout << "For comparison, locking the audio device (as each call used to):" << std::endl;
+	report("lock + unlock", lock_ns);
+
+	loops.clear();
+	Sound::shutdown();
+	SDL_Quit();
+
+	if (!ok) {
+		std::cout << "FAILED: some game-thread Sound calls stalled." << std::endl;
+		return 1;
+	}
+	std::cout << "Passed." << std::endl;
+	return 0;
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+/*
+ * SPSCRing -- fixed-capacity, wait-free queue between exactly one producer
+ * thread and exactly one consumer thread.
+ *
+ * push() (producer only) and pop() (consumer only) never block, never
+ * allocate, and never fail except when the ring is full / empty.
+ *
+ * Entries are copied in and out, so T should be a small, trivially copyable
+ * record (e.g. a command).
+ *
+ * The ring also counts entries: writes() and reads() are the number of
+ * entries pushed / popped so far (mod 2^32), which lets a producer tell when
+ * the consumer has seen everything up to some point.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+template< typename T, uint32_t Capacity >
+struct SPSCRing {
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity is a power of two, so indices can wrap.");
+	static_assert(std::is_trivially_copyable< T >::value, "Entries are plain data.");
+
+	//producer: add an entry; returns false (and does nothing) if the ring is full:
+	bool push(T const &value) {
+		uint32_t w = write.load(std::memory_order_relaxed);
+		if (w - read.load(std::memory_order_acquire) == Capacity) return false;
+		slots[w & (Capacity - 1)] = value;
+		write.store(w + 1, std::memory_order_release);
+		return true;
+	}
+
+	//consumer: remove the oldest entry into *value; returns false if the ring is empty:
+	bool pop(T *value) {
+		uint32_t r = read.load(std::memory_order_relaxed);
+		if (r == write.load(std::memory_order_acquire)) return false;
+		*value = slots[r & (Capacity - 1)];
+		read.store(r + 1, std::memory_order_release);
+		return true;
+	}
+
+	uint32_t writes() const { return write.load(std::memory_order_acquire); }
+	uint32_t reads() const { return read.load(std::memory_order_acquire); }
+
+	//(indices on separate cache lines so the two threads don't fight over one line)
+	alignas(64) std::atomic< uint32_t > write{0};
+	alignas(64) std::atomic< uint32_t > read{0};
+	alignas(64) T slots[Capacity];
+};
@@ -0,0 +1,185 @@
+//texture-bench times loading the game's textures three ways:
+//  serial:       decode into memory then glTexImage2D, one texture at a time (the old PlayMode path)
+//  staged:       the texture_upload.hpp path (decode into mapped pixel buffers), one thread
+//  parallel:     the texture_upload.hpp path with decoding spread across worker threads
+// usage: texture-bench [--runs N] [--threads N] [--cache] [file.png ...]
+// (defaults to the nine textures PlayMode loads; texture cache is off unless --cache is given)
+
+#include "texture_upload.hpp"
+#include "load_save_png.hpp"
+#include "data_path.hpp"
+#include "GL.hpp"
+#include "gl_errors.hpp"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+//run fn(0) ... fn(count-1) on up to 'threads' threads:
+static void parallel_for(uint32_t count, uint32_t threads, std::function< void(uint32_t) > const &fn) {
+	std::atomic< uint32_t > next(0);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	auto work = [&]() {
+		for (uint32_t i = next++; i < count; i = next++) {
+			try {
+				fn(i);
+			} catch (...) {
+				std::unique_lock< std::mutex > lock(error_mutex);
+				if (!error) error = std::current_exception();
+			}
+		}
+	};
+	std::vector< std::thread > pool;
+	for (uint32_t t = 1; t < std::min(threads, count); ++t) {
+		pool.emplace_back(work);
+	}
+	work(); //(this thread helps too)
+	for (auto &t : pool) t.join();
+	if (error) std::rethrow_exception(error);
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try {
+#endif
+	uint32_t runs = 5;
+	uint32_t threads = std::max(2u, std::thread::hardware_concurrency());
+	bool use_cache = false;
+	std::vector< std::string > files;
+	for (int a = 1; a < argc; ++a) {
+		std::string arg = argv[a];
+		if (arg == "--runs" && a + 1 < argc) {
+			runs = std::max(1, std::stoi(argv[++a]));
+		} else if (arg == "--threads" && a + 1 < argc) {
+			threads = std::max(1, std::stoi(argv[++a]));
+		} else if (arg == "--cache") {
+			use_cache = true;
+		} else if (arg.substr(0, 2) == "--") {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--runs N] [--threads N] [--cache] [file.png ...]" << std::endl;
+			return 1;
+		} else {
+			files.emplace_back(arg);
+		}
+	}
+	if (files.empty()) {
+		for (std::string name : {"dialog", "scene1", "scene2", "scene3", "scene4", "scene5", "scene6", "scene7", "scene8"}) {
+			files.emplace_back(data_path("dist/data/" + name + ".png"));
+		}
+	}
+
+	//----- GL context (hidden window) -----
+	SDL_Init(SDL_INIT_VIDEO);
+	SDL_GL_ResetAttributes();
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_Window *window = SDL_CreateWindow("texture-bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	if (!window) {
+		std::cerr << "Error creating SDL window: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+	SDL_GLContext context = SDL_GL_CreateContext(window);
+	if (!context) {
+		SDL_DestroyWindow(window);
+		std::cerr << "Error creating OpenGL context: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+	init_GL();
+
+	//----- methods -----
+	std::vector< GLuint > textures(files.size(), 0);
+
+	auto serial = [&]() {
+		for (uint32_t i = 0; i < files.size(); ++i) {
+			glm::uvec2 size;
+			std::vector< glm::u8vec4 > data;
+			if (use_cache) {
+				Texels texels = load_png_cached(files[i], LowerLeftOrigin);
+				size = texels.size;
+				data.assign(texels.data, texels.data + size_t(size.x) * size.y);
+			} else {
+				load_png(files[i], &size, &data, LowerLeftOrigin);
+			}
+			glGenTextures(1, &textures[i]);
+			glBindTexture(GL_TEXTURE_2D, textures[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	};
+
+	auto staged = [&](uint32_t thread_count) {
+		std::vector< TextureSource > sources(files.size());
+		std::vector< TextureStaging > stagings(files.size());
+		parallel_for(uint32_t(files.size()), thread_count, [&](uint32_t i) {
+			sources[i] = open_texture_source(files[i], LowerLeftOrigin, use_cache);
+		});
+		for (uint32_t i = 0; i < files.size(); ++i) {
+			stagings[i] = map_staging(sources[i].size);
+		}
+		parallel_for(uint32_t(files.size()), thread_count, [&](uint32_t i) {
+			fill_staging(&sources[i], stagings[i]);
+		});
+		for (uint32_t i = 0; i < files.size(); ++i) {
+			textures[i] = upload_staging(&stagings[i]);
+		}
+	};
+
+	std::vector< std::pair< std::string, std::function< void() > > > methods = {
+		{"serial", serial},
+		{"staged", [&](){ staged(1); }},
+		{"parallel x" + std::to_string(threads), [&](){ staged(threads); }},
+	};
+
+	//----- run -----
+	std::cout << "Loading " << files.size() << " textures, " << runs << " runs each" << (use_cache ? " (texture cache on)" : "") << ":" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	for (auto const &method : methods) {
+		method.second(); //warm up (file cache, driver, texture cache)
+		glFinish();
+		glDeleteTextures(GLsizei(textures.size()), textures.data());
+
+		std::vector< double > times;
+		for (uint32_t r = 0; r < runs; ++r) {
+			auto before = std::chrono::steady_clock::now();
+			method.second();
+			glFinish(); //(includes the time the uploads take to land)
+			auto after = std::chrono::steady_clock::now();
+			times.emplace_back(std::chrono::duration< double, std::milli >(after - before).count());
+			glDeleteTextures(GLsizei(textures.size()), textures.data());
+		}
+		std::sort(times.begin(), times.end());
+		std::cout << "  " << std::left << std::setw(16) << method.first << std::right
+		          << " min " << std::setw(8) << times.front() << "ms"
+		          << "  median " << std::setw(8) << times[times.size() / 2] << "ms" << std::endl;
+	}
+	GL_ERRORS();
+
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+
+	return 0;
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
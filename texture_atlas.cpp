@@ -0,0 +1,234 @@
+#include "texture_atlas.hpp"
+#include "texture_upload.hpp"
+#include "data_path.hpp"
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <stdexcept>
+
+//one rectangle of an image, and where it goes in the atlas:
+struct TextureAtlasCell {
+	std::string name;
+	glm::uvec2 from = glm::uvec2(0); //lower left corner in the (lower-left origin) image
+	glm::uvec2 size = glm::uvec2(0);
+	uint32_t layer = 0;
+	glm::uvec2 to = glm::uvec2(0); //lower left corner in the layer
+};
+
+struct TextureAtlas::Image {
+	TextureAtlasImage info;
+	glm::uvec2 size = glm::uvec2(0); //(as found during layout)
+	std::vector< TextureAtlasCell > cells;
+
+	TextureSource source;
+	TextureStaging staging;
+	std::exception_ptr fill_error; //decoding failed; kept for the gl phase, which has to free 'staging' before rethrowing it
+	bool uploaded = false; //(only touched on the OpenGL thread)
+};
+
+TextureAtlas::Entry const &TextureAtlas::lookup(std::string const &name) const {
+	auto f = regions.find(name);
+	if (f == regions.end()) {
+		throw std::runtime_error("Texture atlas has no region named '" + name + "'.");
+	}
+	return f->second;
+}
+
+TextureAtlas::Region const &TextureAtlas::get(std::string const &name) const {
+	Entry const &entry = lookup(name);
+	if (!entry.image->uploaded) finish_load_function(entry.image);
+	return entry.region;
+}
+
+void TextureAtlas::prefetch(std::string const &name) const {
+	Entry const &entry = lookup(name);
+	if (!entry.image->uploaded) prefetch_load_function(entry.image);
+}
+
+//Split images into cells and shelf-pack the cells into layers; returns the number of layers used:
+static uint32_t pack_cells(glm::uvec2 layer_size, std::vector< TextureAtlasCell * > const &cells_) {
+	//tallest first, so shelves waste less height:
+	std::vector< TextureAtlasCell * > cells = cells_;
+	std::stable_sort(cells.begin(), cells.end(), [](TextureAtlasCell const *a, TextureAtlasCell const *b) {
+		return a->size.y > b->size.y;
+	});
+
+	struct Shelf {
+		uint32_t layer, y, height, used;
+	};
+	std::vector< Shelf > shelves;
+	std::vector< uint32_t > layer_used; //height of all the shelves in each layer
+
+	for (TextureAtlasCell *cell : cells) {
+		if (cell->size.x > layer_size.x || cell->size.y > layer_size.y) {
+			throw std::runtime_error("Texture atlas cell '" + cell->name + "' (" + std::to_string(cell->size.x) + "x" + std::to_string(cell->size.y) + ") is larger than a layer.");
+		}
+		//first shelf it fits on:
+		Shelf *shelf = nullptr;
+		for (auto &s : shelves) {
+			if (cell->size.y <= s.height && s.used + cell->size.x <= layer_size.x) {
+				shelf = &s;
+				break;
+			}
+		}
+		//...or a new shelf in the first layer with room for one:
+		if (!shelf) {
+			uint32_t layer = 0;
+			while (layer < layer_used.size() && layer_used[layer] + cell->size.y > layer_size.y) ++layer;
+			if (layer == layer_used.size()) layer_used.emplace_back(0);
+			shelves.emplace_back(Shelf{layer, layer_used[layer], cell->size.y, 0});
+			layer_used[layer] += cell->size.y;
+			shelf = &shelves.back();
+		}
+		cell->layer = shelf->layer;
+		cell->to = glm::uvec2(shelf->used, shelf->y);
+		shelf->used += cell->size.x;
+	}
+
+	return uint32_t(layer_used.size());
+}
+
+Load< TextureAtlas > load_texture_atlas(LoadTag tag, std::string const &name, glm::uvec2 layer_size, std::vector< TextureAtlasImage > const &images) {
+	assert(layer_size.x > 0 && layer_size.y > 0);
+
+	//(like every Load<>'d value, this is never freed)
+	TextureAtlas *atlas = new TextureAtlas;
+	atlas->layer_size = layer_size;
+	for (auto const &info : images) {
+		atlas->images.emplace_back(std::make_shared< TextureAtlas::Image >());
+		atlas->images.back()->info = info;
+	}
+
+	//layout: read image sizes (from png headers) and pack; then allocate the texture:
+	void const *layout_key = atlas;
+	add_load_function(tag, layout_key, LoadInfo(name + " (layout)"), [atlas]() {
+		std::vector< TextureAtlasCell * > cells;
+		for (auto &image : atlas->images) {
+			TextureAtlasImage const &info = image->info;
+			AssetView png = asset_view(data_path(info.filename));
+			image->size = png_size(info.filename, png.data, png.size);
+
+			glm::uvec2 grid = glm::max(info.grid, glm::uvec2(1));
+			if (image->size.x % grid.x != 0 || image->size.y % grid.y != 0) {
+				throw std::runtime_error("Image '" + info.filename + "' (" + std::to_string(image->size.x) + "x" + std::to_string(image->size.y) + ") doesn't divide into a " + std::to_string(grid.x) + "x" + std::to_string(grid.y) + " grid.");
+			}
+			uint32_t count = grid.x * grid.y;
+			if (info.cells != 0) count = std::min(count, info.cells);
+
+			glm::uvec2 cell_size = image->size / grid;
+			image->cells.resize(count);
+			for (uint32_t i = 0; i < count; ++i) {
+				TextureAtlasCell &cell = image->cells[i];
+				cell.name = (grid == glm::uvec2(1) ? info.name : info.name + "/" + std::to_string(i));
+				cell.size = cell_size;
+				//(cells count from the top, but the image is stored bottom row first)
+				cell.from = glm::uvec2((i % grid.x) * cell_size.x, image->size.y - (i / grid.x + 1) * cell_size.y);
+				cells.emplace_back(&cell);
+			}
+		}
+
+		atlas->layers = pack_cells(atlas->layer_size, cells);
+
+		for (auto &image : atlas->images) {
+			for (auto const &cell : image->cells) {
+				TextureAtlas::Entry entry;
+				entry.image = image.get();
+				entry.region.layer = cell.layer;
+				entry.region.min = glm::vec2(cell.to) / glm::vec2(atlas->layer_size);
+				entry.region.max = glm::vec2(cell.to + cell.size) / glm::vec2(atlas->layer_size);
+				if (!atlas->regions.emplace(cell.name, entry).second) {
+					throw std::runtime_error("Texture atlas has two regions named '" + cell.name + "'.");
+				}
+			}
+		}
+	}, [atlas]() {
+		GLint max_layers = 0;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+		if (atlas->layers > uint32_t(max_layers)) {
+			throw std::runtime_error("Texture atlas needs " + std::to_string(atlas->layers) + " layers, but only " + std::to_string(max_layers) + " are supported.");
+		}
+
+		glGenTextures(1, &atlas->texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, atlas->texture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, atlas->layer_size.x, atlas->layer_size.y, atlas->layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		GL_ERRORS();
+	});
+
+	//each image then loads like a stand-alone texture (see texture_upload.hpp), but uploads into its cells:
+	std::vector< void const * > eager = {layout_key};
+	for (auto &image_ : atlas->images) {
+		TextureAtlas::Image *image = image_.get();
+		TextureAtlasImage const &info = image->info;
+
+		void const *staging_key = &image->staging;
+		add_load_function(tag, staging_key, LoadInfo(info.filename + " (staging)", {}, info.policy), [image]() {
+			image->source = open_texture_source(data_path(image->info.filename), LowerLeftOrigin);
+		}, [image]() {
+			image->staging = map_staging(image->source.size);
+		});
+
+		add_load_function(tag, image, LoadInfo(info.filename, {staging_key, layout_key}, info.policy), [image]() {
+			try {
+				if (image->source.size != image->size) {
+					throw std::runtime_error("Image '" + image->info.filename + "' changed size while loading.");
+				}
+				fill_staging(&image->source, image->staging);
+			} catch (...) {
+				image->fill_error = std::current_exception();
+			}
+		}, [atlas, image]() {
+			TextureStaging &staging = image->staging;
+			if (image->fill_error) {
+				discard_staging(&staging);
+				image->source = TextureSource();
+				std::rethrow_exception(image->fill_error);
+			}
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+			GLboolean intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			staging.texels = nullptr;
+
+			if (intact) {
+				//copy each cell's rectangle of the pixel buffer into place:
+				glBindTexture(GL_TEXTURE_2D_ARRAY, atlas->texture);
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, staging.size.x);
+				for (auto const &cell : image->cells) {
+					glPixelStorei(GL_UNPACK_SKIP_PIXELS, cell.from.x);
+					glPixelStorei(GL_UNPACK_SKIP_ROWS, cell.from.y);
+					glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, cell.to.x, cell.to.y, cell.layer, cell.size.x, cell.size.y, 1, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+					load_report_gl_bytes(size_t(cell.size.x) * cell.size.y * sizeof(glm::u8vec4));
+				}
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+				glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+				glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+				glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+			}
+
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glDeleteBuffers(1, &staging.buffer);
+			staging.buffer = 0;
+			image->source = TextureSource();
+
+			GL_ERRORS();
+
+			if (!intact) {
+				throw std::runtime_error("Pixel buffer contents for '" + image->info.filename + "' were lost before upload.");
+			}
+			image->uploaded = true;
+		});
+
+		if (info.policy == LoadEager) eager.emplace_back(image);
+	}
+
+	//the atlas itself is ready once it is laid out and its eager images are in:
+	return Load< TextureAtlas >(tag, LoadInfo(name, eager), nullptr, [atlas]() -> TextureAtlas const * {
+		return atlas;
+	});
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ * Texture atlas: many images in one GL_TEXTURE_2D_ARRAY, so drawing a whole
+ * frame needs only a single texture binding.
+ *
+ * Images the same size as a layer get a layer each; smaller images (and the
+ * cells of images that are split into a grid, like a tile sheet) are
+ * shelf-packed into the remaining layers. Each packed piece becomes a named
+ * Region (layer + texture coordinate rectangle):
+ *
+ * Load< TextureAtlas > atlas = load_texture_atlas(LoadTagDefault, "ui atlas", glm::uvec2(1280, 720), {
+ *     {"level1", "data/level1.png", LoadLazy},
+ *     {"tiles", "data/tiles.png", LoadEager, glm::uvec2(16, 8)}, //regions "tiles/0" ... "tiles/127"
+ * });
+ * ...
+ * glBindTexture(GL_TEXTURE_2D_ARRAY, atlas->texture);
+ * TextureAtlas::Region const &r = atlas->get("level1"); //(finishes loading "level1" if it is lazy)
+ *
+ * Layout only needs the images' sizes, so it is done up front; each image is
+ * then decoded and uploaded (via texture_upload.hpp) by its own load function,
+ * and lazy images load on first get() or prefetch() (which needs
+ * pump_load_functions() to be called every frame to finish in the background).
+ */
+
+#include "GL.hpp"
+#include "Load.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TextureAtlasImage {
+	std::string name; //region name (or prefix of the cell region names, if split into a grid)
+	std::string filename; //png, relative to data_path()
+	LoadPolicy policy = LoadEager;
+	glm::uvec2 grid = glm::uvec2(1); //split into grid.x by grid.y cells, named "name/0", "name/1", ... (row-major from the upper left)
+	uint32_t cells = 0; //only keep the first 'cells' cells (0 means all of them)
+};
+
+struct TextureAtlas {
+	struct Region {
+		uint32_t layer = 0;
+		glm::vec2 min = glm::vec2(0.0f); //texture coordinates of the lower left corner
+		glm::vec2 max = glm::vec2(1.0f); //...and of the upper right corner
+	};
+
+	GLuint texture = 0; //GL_TEXTURE_2D_ARRAY (GL_NEAREST filtering, GL_CLAMP_TO_EDGE wrapping)
+	glm::uvec2 layer_size = glm::uvec2(0);
+	uint32_t layers = 0;
+
+	//look up a region, finishing its image's load if needed; throws if there is no such region:
+	// (only call from the thread with the OpenGL context)
+	Region const &get(std::string const &name) const;
+	//start loading a (lazy) region's image in the background:
+	// (it decodes on a worker; pump_load_functions() maps and uploads it, freeing its pixel buffer -- see Load.hpp)
+	void prefetch(std::string const &name) const;
+
+	//---- internals ----
+	struct Image;
+	std::vector< std::shared_ptr< Image > > images;
+	struct Entry {
+		Region region;
+		Image *image = nullptr;
+	};
+	std::unordered_map< std::string, Entry > regions;
+	Entry const &lookup(std::string const &name) const;
+};
+
+//Register load functions for an atlas with 'layer_size' layers holding 'images':
+Load< TextureAtlas > load_texture_atlas(LoadTag tag, std::string const &name, glm::uvec2 layer_size, std::vector< TextureAtlasImage > const &images);
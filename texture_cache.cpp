@@ -0,0 +1,161 @@
+#include "texture_cache.hpp"
+#include "data_path.hpp"
+#include "Load.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <istream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+	//bump when the decode or file layout changes, so old cache files are ignored:
+	constexpr uint32_t TexelCacheVersion = 1;
+
+	struct TexelCacheHeader {
+		char magic[4] = {'t','e','x','0'};
+		uint32_t version = TexelCacheVersion;
+		uint64_t source_hash = 0; //hash of the png's bytes
+		uint64_t source_size = 0; //size of the png
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t origin = 0; //OriginLocation used when decoding
+		uint32_t padding = 0;
+		//followed by width * height RGBA8 texels
+	};
+	static_assert(sizeof(TexelCacheHeader) == 4 + 4 + 8 + 8 + 4 * 4, "TexelCacheHeader is packed.");
+
+	//cache directory (with trailing '/'), or "" if caching is disabled:
+	std::string const &cache_dir() {
+		static std::string dir = [](){
+			std::string ret = data_path("texture-cache");
+			if (char const *env = std::getenv("TEXTURE_CACHE")) ret = env;
+			if (ret == "") return ret;
+			#if defined(_WIN32)
+			_mkdir(ret.c_str());
+			#else
+			mkdir(ret.c_str(), 0755);
+			#endif
+			return ret + "/";
+		}();
+		return dir;
+	}
+
+	//write 'texels' to 'filename' (via a temporary file, so readers never see half a file):
+	void write_cache(std::string const &filename, TexelCacheHeader const &header, glm::u8vec4 const *texels) {
+		std::string temp = filename + "." + std::to_string(std::hash< std::thread::id >()(std::this_thread::get_id())) + ".tmp";
+		{
+			std::ofstream out(temp, std::ios::binary);
+			out.write(reinterpret_cast< char const * >(&header), sizeof(header));
+			out.write(reinterpret_cast< char const * >(texels), std::streamsize(size_t(header.width) * header.height * sizeof(glm::u8vec4)));
+			if (!out) {
+				out.close();
+				std::remove(temp.c_str());
+				throw std::runtime_error("Failed to write texture cache file '" + temp + "'.");
+			}
+		}
+		if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+			//(probably someone else cached the same image first)
+			std::remove(temp.c_str());
+		}
+	}
+
+	//cache file for png contents 'source' (also fills in the parts of the header that come from the source):
+	std::string cache_file(AssetView const &source, OriginLocation origin, TexelCacheHeader *header) {
+		header->source_hash = asset_pack_hash(source.data, source.data + source.size);
+		header->source_size = source.size;
+		header->origin = uint32_t(origin);
+
+		if (cache_dir().empty()) return "";
+
+		//key covers contents and decode options:
+		uint64_t key = header->source_hash;
+		key = (key ^ header->origin) * 0x100000001b3ULL;
+		key = (key ^ TexelCacheVersion) * 0x100000001b3ULL;
+		char hex[17];
+		std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)key);
+		return cache_dir() + hex + ".texels";
+	}
+}
+
+bool texture_cache_enabled() {
+	return !cache_dir().empty();
+}
+
+bool find_cached_texels(AssetView const &source, OriginLocation origin, Texels *texels) {
+	assert(texels);
+
+	TexelCacheHeader expected;
+	std::string filename = cache_file(source, origin, &expected);
+	if (filename.empty()) return false;
+
+	std::shared_ptr< MappedFile > mapped;
+	try {
+		mapped = MappedFile::open(filename);
+	} catch (std::runtime_error &e) {
+		std::cerr << "WARNING: " << e.what() << std::endl;
+	}
+	if (!mapped || mapped->size < sizeof(TexelCacheHeader)) return false;
+
+	TexelCacheHeader header;
+	std::memcpy(&header, mapped->data, sizeof(header));
+	if (std::memcmp(header.magic, expected.magic, 4) != 0
+	 || header.version != expected.version
+	 || header.source_hash != expected.source_hash
+	 || header.source_size != expected.source_size
+	 || header.origin != expected.origin
+	 || mapped->size != sizeof(header) + size_t(header.width) * header.height * sizeof(glm::u8vec4)) {
+		return false;
+	}
+
+	load_report_bytes_read(mapped->size);
+	texels->size = glm::uvec2(header.width, header.height);
+	texels->data = reinterpret_cast< glm::u8vec4 const * >(mapped->data + sizeof(header));
+	texels->decoded.clear();
+	texels->mapped = mapped;
+	return true;
+}
+
+void store_cached_texels(AssetView const &source, OriginLocation origin, glm::uvec2 size, glm::u8vec4 const *data) {
+	TexelCacheHeader header;
+	std::string filename = cache_file(source, origin, &header);
+	if (filename.empty()) return;
+	header.width = size.x;
+	header.height = size.y;
+	try {
+		write_cache(filename, header, data);
+	} catch (std::runtime_error &e) {
+		//(a read-only install shouldn't stop the game; just warn once)
+		static std::atomic_flag warned = ATOMIC_FLAG_INIT;
+		if (!warned.test_and_set()) std::cerr << "WARNING: " << e.what() << " Textures will not be cached." << std::endl;
+	}
+}
+
+Texels load_png_cached(std::string const &filename, OriginLocation origin) {
+	AssetView source = asset_view(filename);
+
+	Texels ret;
+	if (find_cached_texels(source, origin, &ret)) return ret;
+
+	//miss: decode (from the bytes already in hand) and save for next time:
+	AssetStreamBuf buf(source);
+	std::istream from(&buf);
+	load_png(from, filename, &ret.size, &ret.decoded, origin);
+	ret.data = ret.decoded.data();
+
+	store_cached_texels(source, origin, ret.size, ret.data);
+
+	return ret;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+/*
+ * Decoded texture cache: load_png_cached() keeps GPU-ready RGBA8 texels on disk,
+ * keyed by a hash of the png's contents (and the decode options), so that
+ * later runs can map the texels and upload them without running libpng.
+ *
+ * Changing a png changes its hash, so stale entries are simply never hit again.
+ *
+ * Cache files live in data_path("texture-cache/"); set TEXTURE_CACHE to use a
+ * different directory (or to "" to disable the cache).
+ */
+
+#include "load_save_png.hpp"
+#include "AssetPack.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+//RGBA8 texels ready for glTexImage2D:
+struct Texels {
+	Texels() = default;
+	Texels(Texels &&) = default;
+	Texels &operator=(Texels &&) = default;
+	Texels(Texels const &) = delete; //(copying would leave 'data' pointing at the original)
+
+	glm::uvec2 size = glm::uvec2(0);
+	glm::u8vec4 const *data = nullptr; //size.x * size.y texels
+
+	//one of these owns 'data':
+	std::vector< glm::u8vec4 > decoded; //miss: freshly decoded
+	std::shared_ptr< MappedFile > mapped; //hit: mapped cache file
+};
+
+//Load a png (like load_png), going through the cache; throws on error:
+Texels load_png_cached(std::string const &filename, OriginLocation origin);
+
+//The pieces of load_png_cached, for code that wants to decode somewhere else on a miss:
+// 'source' is the png file's contents.
+//look up texels decoded from 'source'; returns false on a miss (or if the cache is disabled):
+bool find_cached_texels(AssetView const &source, OriginLocation origin, Texels *texels);
+//save texels decoded from 'source' for next time (warns -- once -- rather than throwing if that fails):
+void store_cached_texels(AssetView const &source, OriginLocation origin, glm::uvec2 size, glm::u8vec4 const *data);
+//is the cache enabled?
+bool texture_cache_enabled();
@@ -0,0 +1,143 @@
+#include "texture_upload.hpp"
+#include "Load.hpp"
+#include "gl_errors.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+
+TextureSource open_texture_source(std::string const &filename, OriginLocation origin, bool use_cache) {
+	TextureSource source;
+	source.name = filename;
+	source.origin = origin;
+	source.use_cache = use_cache;
+	source.png = asset_view(filename);
+
+	if (use_cache && find_cached_texels(source.png, origin, &source.cached)) {
+		source.size = source.cached.size;
+		source.png = AssetView(); //(no longer needed)
+	} else {
+		source.size = png_size(filename, source.png.data, source.png.size);
+	}
+
+	if (source.size.x == 0 || source.size.y == 0) {
+		throw std::runtime_error("Texture '" + filename + "' is empty.");
+	}
+	return source;
+}
+
+TextureStaging map_staging(glm::uvec2 size) {
+	assert(size.x > 0 && size.y > 0);
+
+	TextureStaging staging;
+	staging.size = size;
+
+	GLsizeiptr bytes = GLsizeiptr(size_t(size.x) * size.y * sizeof(glm::u8vec4));
+	glGenBuffers(1, &staging.buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+	staging.texels = reinterpret_cast< glm::u8vec4 * >(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	GL_ERRORS();
+
+	if (!staging.texels) {
+		glDeleteBuffers(1, &staging.buffer);
+		throw std::runtime_error("Failed to map a " + std::to_string(bytes) + "-byte pixel buffer.");
+	}
+
+	return staging;
+}
+
+void fill_staging(TextureSource *source_, TextureStaging const &staging) {
+	assert(source_);
+	TextureSource &source = *source_;
+	assert(staging.texels && staging.size == source.size);
+
+	if (source.cached.data) {
+		//texture cache hit: already decoded, just copy:
+		std::memcpy(staging.texels, source.cached.data, size_t(source.size.x) * source.size.y * sizeof(glm::u8vec4));
+	} else {
+		AssetStreamBuf buf(source.png);
+		std::istream from(&buf);
+		if (source.use_cache && texture_cache_enabled()) {
+			//miss: decode to memory that can be read back (the mapping is write-only) so it can be cached for next time:
+			glm::uvec2 size;
+			std::vector< glm::u8vec4 > texels;
+			load_png(from, source.name, &size, &texels, source.origin);
+			if (size != staging.size) {
+				throw std::runtime_error("PNG image '" + source.name + "' changed size while loading.");
+			}
+			store_cached_texels(source.png, source.origin, size, texels.data());
+			std::memcpy(staging.texels, texels.data(), texels.size() * sizeof(glm::u8vec4));
+		} else {
+			load_png(from, source.name, staging.size, staging.texels, source.origin);
+		}
+	}
+
+	source.png = AssetView();
+	source.cached = Texels();
+}
+
+GLuint upload_staging(TextureStaging *staging_) {
+	assert(staging_);
+	TextureStaging &staging = *staging_;
+	assert(staging.buffer);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+	GLboolean intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	staging.texels = nullptr;
+
+	GLuint tex = 0;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+
+	if (intact) {
+		//allocate storage (with nothing bound, so the null pointer means "no data")...
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, staging.size.x, staging.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		//...then copy from the pixel buffer (offset 0); this returns without waiting for the copy:
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, staging.size.x, staging.size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		load_report_gl_bytes(size_t(staging.size.x) * staging.size.y * sizeof(glm::u8vec4));
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//(the driver keeps the buffer's storage alive until the copy is done)
+	glDeleteBuffers(1, &staging.buffer);
+	staging.buffer = 0;
+
+	GL_ERRORS();
+
+	if (!intact) {
+		glDeleteTextures(1, &tex);
+		//(can happen if, e.g., the display mode changes while the buffer is mapped)
+		throw std::runtime_error("Pixel buffer contents were lost before upload.");
+	}
+
+	return tex;
+}
+
+void discard_staging(TextureStaging *staging_) {
+	assert(staging_);
+	TextureStaging &staging = *staging_;
+	if (!staging.buffer) return;
+
+	if (staging.texels) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		staging.texels = nullptr;
+	}
+	glDeleteBuffers(1, &staging.buffer);
+	staging.buffer = 0;
+
+	GL_ERRORS();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+/*
+ * Staged texture loading, so that png decoding can run on worker threads and
+ * write straight into memory the GPU pulls from:
+ *
+ *  1. (any thread) TextureSource source = open_texture_source(path, origin);
+ *     reads the file and its size (and checks the texture cache)
+ *  2. (GL thread)  TextureStaging staging = map_staging(source.size);
+ *     makes a pixel unpack buffer and maps it for writing
+ *  3. (any thread) fill_staging(&source, staging);
+ *     decodes (or copies cached texels) into the mapped buffer; rows are flipped as they are decoded
+ *  4. (GL thread)  GLuint tex = upload_staging(&staging);
+ *     unmaps and issues glTexSubImage2D from the buffer, which doesn't wait for the copy to finish
+ *
+ * Loads for different textures can overlap freely, so many textures can be
+ * decoding at once while the GL thread only does quick map/unmap work.
+ */
+
+#include "GL.hpp"
+#include "texture_cache.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+
+struct TextureSource {
+	std::string name; //for error messages
+	OriginLocation origin = LowerLeftOrigin;
+	glm::uvec2 size = glm::uvec2(0);
+	bool use_cache = true;
+
+	AssetView png; //file contents (if not cached)
+	Texels cached; //already-decoded texels (on a texture cache hit)
+};
+
+//throws if the file can't be read or isn't a png:
+TextureSource open_texture_source(std::string const &filename, OriginLocation origin, bool use_cache = true);
+
+struct TextureStaging {
+	glm::uvec2 size = glm::uvec2(0);
+	GLuint buffer = 0; //GL_PIXEL_UNPACK_BUFFER
+	glm::u8vec4 *texels = nullptr; //mapped, write-only; size.x * size.y texels
+};
+
+//(GL thread) make a mapped pixel buffer big enough for 'size' texels:
+TextureStaging map_staging(glm::uvec2 size);
+
+//(any thread) fill 'staging' from 'source'; releases source's data when done:
+// (throws if decoding fails -- in which case the buffer is still mapped; see discard_staging)
+void fill_staging(TextureSource *source, TextureStaging const &staging);
+
+//(GL thread) make a texture (GL_NEAREST filtering, GL_REPEAT wrapping) from 'staging'; frees the staging buffer:
+GLuint upload_staging(TextureStaging *staging);
+
+//(GL thread) unmap and free 'staging' without uploading it (e.g., because fill_staging threw):
+void discard_staging(TextureStaging *staging);